@@ -1,6 +1,11 @@
 #include "image_processing.h"
-#include "string_art_generator.h"
+#include "string_art_api.h"
 #include "svg_generator.h"
+#include "live_preview.h"
+#include "output_writer.h"
+#include "job_server.h"
+#include "sweep.h"
+#include "sequence_optimizer.h"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
@@ -8,6 +13,207 @@
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <memory>
+
+// Write the live preview's last frame and report
+void finishLivePreview(std::unique_ptr<LivePreview>& livePreview) {
+    if (!livePreview) return;
+    
+    livePreview->finish();
+    std::cout << "Live preview: " << livePreview->framesWritten() << " frames written, "
+              << livePreview->framesSkipped() << " skipped" << std::endl;
+    livePreview.reset();
+}
+
+// Palette thread as listed in the instructions: its name and hex code, or just the hex code
+std::string threadName(const ThreadColor& color) {
+    return color.name.empty() ? color.hex() : color.name + " (" + color.hex() + ")";
+}
+
+// Compare a result file with its golden copy line by line. The txt "Generated:" line carries the
+// run's timestamp and is skipped; everything else, including every nail of the sequence, must match.
+bool matchesGolden(const std::string& filename, const std::string& goldenFilename, std::string& detail) {
+    std::ifstream file(filename);
+    std::ifstream golden(goldenFilename);
+    if (!golden.is_open()) {
+        detail = "no golden file " + goldenFilename;
+        return false;
+    }
+    if (!file.is_open()) {
+        detail = "not written";
+        return false;
+    }
+    
+    std::string line, goldenLine;
+    int lineNumber = 0;
+    while (true) {
+        bool more = (bool)std::getline(file, line);
+        bool goldenMore = (bool)std::getline(golden, goldenLine);
+        lineNumber++;
+        if (!more || !goldenMore) {
+            if (more != goldenMore) {
+                detail = "length differs at line " + std::to_string(lineNumber);
+                return false;
+            }
+            return true;
+        }
+        if (line != goldenLine && !(line.rfind("Generated: ", 0) == 0 && goldenLine.rfind("Generated: ", 0) == 0)) {
+            detail = "line " + std::to_string(lineNumber) + " differs";
+            return false;
+        }
+    }
+}
+
+// Grayscale nail connection list: the full run's instructions and each --strings snapshot's
+bool writeInstructions(const std::string& txtFilename, const std::vector<int>& nailSequence, const NailLayout& layout,
+                       const std::string& timestamp, const std::string& inputFile, double contrastFactor,
+                       const std::string& threadThickness) {
+    std::ofstream txtFile(txtFilename);
+    if (!txtFile.is_open()) {
+        return false;
+    }
+    int layoutNails = layout.size();
+    
+    txtFile << "String Art Generator - Nail Connection List\n";
+    txtFile << "===========================================\n";
+    txtFile << "Generated: " << timestamp << "\n";
+    txtFile << "Input image: " << inputFile << "\n";
+    txtFile << "Layout: " << layout.displayName() << "\n";
+    txtFile << "Total nails: " << layoutNails << "\n";
+    txtFile << "Number of connections: " << nailSequence.size() << "\n";
+    txtFile << "Contrast factor: " << contrastFactor << "\n";
+    txtFile << "Thread thickness: " << threadThickness << "\n";
+    txtFile << "\n";
+    txtFile << "Nail sequence (follow this order to create string art):\n";
+    
+    for (size_t i = 0; i < nailSequence.size(); i++) {
+        txtFile << nailSequence[i];
+        if (i < nailSequence.size() - 1) txtFile << ",";
+        if ((i + 1) % 20 == 0) txtFile << "\n";
+    }
+    
+    txtFile << "\n\n";
+    txtFile << "Instructions:\n";
+    txtFile << "1. Arrange " << layoutNails << " nails in a " << layout.shapeNoun() << "\n";
+    txtFile << "2. Number them 0 to " << (layoutNails-1) << " going clockwise\n";
+    txtFile << "3. Connect the nails with BLACK thread in the sequence shown above\n";
+    txtFile << "4. Pull thread tight between each connection\n";
+    txtFile << "5. Use OPAQUE thread - threads are NOT transparent!\n";
+    
+    txtFile.close();
+    if (txtFile.fail()) {
+        return false;
+    }
+    std::cout << "[+] Text instructions saved to: " << txtFilename << std::endl;
+    return true;
+}
+
+// File name parameters (including defaults) - CONCISE FORMAT
+std::string outputSuffix(const StringArtRequest& request) {
+    std::stringstream suffix;
+    
+    // Always show nail count
+    suffix << "-n" << request.numNails;
+    
+    // Always show string count (0 = unlimited)
+    suffix << "-s" << request.maxStrings;
+    
+    // Always show layout type (c=circular, r=rectangular, e=ellipse, p<sides>=polygon, csv=custom)
+    suffix << "-" << NailLayout::specShortCode(request.layoutSpec);
+    
+    // Always show contrast factor
+    suffix << "-" << std::fixed << std::setprecision(1) << request.contrastFactor;
+    
+    // Always show thread thickness (remove "mm" suffix)
+    // Remove "mm" from thickness values like "0.2mm" -> "0.2"
+    std::string thickness = request.threadThickness;
+    if (thickness.size() > 2 && thickness.substr(thickness.size()-2) == "mm") {
+        thickness = thickness.substr(0, thickness.size()-2);
+    }
+    suffix << "-t" << thickness;
+    
+    // Color mode vs Grayscale mode in filename
+    if (request.colorMode) {
+        // Color mode: show strings-per-color and color order instead of coverage strategy
+        suffix << "-spc" << request.stringsPerColor << "-";
+        if (request.palette.empty()) {
+            suffix << request.colorOrder;
+        } else {
+            // The palette replaces the order: auto<N>, or the colors' hex codes
+            std::vector<ThreadColor> colors;
+            int autoColors = 0;
+            parsePalette(request.palette, colors, autoColors);
+            suffix << "pal";
+            if (autoColors > 0) {
+                suffix << "auto" << autoColors;
+            }
+            for (size_t c = 0; c < colors.size(); c++) {
+                suffix << (c == 0 ? "" : "_") << colors[c].hex().substr(1);
+            }
+        }
+    } else {
+        // Grayscale mode: show the coverage strategy that actually runs
+        suffix << "-cs" << request.effectiveCoverageStrategy();
+    
+        // Multi-start runs only show up in the name when enabled
+        if (request.restarts > 1) {
+            suffix << "-ms" << request.restarts;
+        }
+    }
+    
+    // A non-default processing resolution changes every coordinate in the output
+    if (request.workSize != DEFAULT_WORK_SIZE) {
+        suffix << "-w" << request.workSize;
+    }
+    
+    // The physical coverage model changes the sequence too
+    if (request.supersample >= 0) {
+        suffix << "-ss" << (request.supersample == 0 ? std::string("auto") : std::to_string(request.supersample));
+    }
+    if (request.fixedPoint) {
+        suffix << "-fx";
+    }
+    if (request.residual) {
+        suffix << "-res";
+    }
+    
+    // So does a region of interest: "-roiauto", or "-roi" and the mask file's name
+    if (!request.roi.empty()) {
+        suffix << "-roi" << (request.roi == "auto" ? std::string("auto") : std::filesystem::path(request.roi).stem().string());
+    }
+    
+    // A --strings list solves on an open-ended schedule, so its sequences differ from single-count runs
+    if (request.scheduleHorizon() > 0) {
+        suffix << "-h" << request.scheduleHorizon();
+    }
+    
+    // Refinement changes the sequence, so it is part of the name when enabled
+    if (request.refineMoves > 0) {
+        suffix << "-rm" << request.refineMoves;
+    }
+    if (request.refineSeconds > 0.0) {
+        suffix << "-rf" << request.refineSeconds;
+    }
+    
+    // So can a time budget, if the solve hits it
+    if (request.timeBudgetSeconds > 0.0) {
+        suffix << "-tb" << request.timeBudgetSeconds;
+    }
+    return suffix.str();
+}
+
+// Output file name before the parameter suffix
+std::string outputBase(const std::string& inputFile, const std::string& outputFile, bool batch) {
+    if (outputFile.empty()) {
+        // Use full input filename (including extension)
+        return inputFile;
+    }
+    if (batch) {
+        // A batch shares -o as a prefix; the input name keeps the results apart
+        return outputFile + "-" + std::filesystem::path(inputFile).filename().string();
+    }
+    return outputFile;
+}
 
 std::string generateTimestamp() {
     auto now = std::chrono::system_clock::now();
@@ -26,28 +232,167 @@ std::string generateTimestamp() {
     return ss.str();
 }
 
+// --sweep: each image is decoded once and every combination of the grids is solved on the thread
+// pool. The table of results and the best combination's files are written.
+int runSweepMode(const std::vector<std::string>& inputFiles, const std::string& outputFile, const StringArtRequest& request,
+                 const std::vector<SweepAxis>& axes, bool writePreview, const std::string& previewFormat,
+                 FsyncPolicy fsyncPolicy, const std::string& timestamp) {
+    std::vector<StringArtRequest> requests = expandSweep(request, axes);
+    StringArtEngine engine;
+    OutputWriter writer(fsyncPolicy);
+    int failedImages = 0;
+    
+    for (const std::string& inputFile : inputFiles) {
+        std::string baseFilename = outputBase(inputFile, outputFile, inputFiles.size() > 1);
+        std::cout << "Sweep: " << inputFile << ", " << requests.size() << " combinations" << std::endl;
+        
+        auto loadStart = std::chrono::steady_clock::now();
+        ImageData img;
+        if (!engine.loadImage(inputFile, request, img)) {
+            std::cout << "Error: Cannot load image: " << inputFile << std::endl;
+            failedImages++;
+            continue;
+        }
+        double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+        std::cout << "Image decoded once: " << img.width << "x" << img.height << " pixels in " << loadSeconds << "s" << std::endl;
+        
+        auto sweepStart = std::chrono::steady_clock::now();
+        std::vector<StringArtResponse> responses = runSweep(img, requests, request.numThreads);
+        double sweepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sweepStart).count();
+        int best = bestSweepPoint(responses);
+        
+        std::ostringstream table;
+        writeSweepTable(table, axes, requests, responses, best);
+        std::cout << std::endl << table.str();
+        std::cout << "Sweep: " << requests.size() << " combinations in " << sweepSeconds << "s (* = lowest RMSE)" << std::endl;
+        
+        std::string tableFilename = baseFilename + "-sweep.txt";
+        writer.submit(tableFilename, [tableFilename, inputFile, timestamp, table = table.str()]() {
+            std::ofstream file(tableFilename);
+            if (!file.is_open()) {
+                return false;
+            }
+            file << "String Art Generator - Parameter Sweep\n";
+            file << "Generated: " << timestamp << "\n";
+            file << "Input image: " << inputFile << "\n\n";
+            file << table;
+            file.close();
+            if (file.fail()) {
+                return false;
+            }
+            std::cout << "[+] Sweep table saved to: " << tableFilename << std::endl;
+            return true;
+        });
+        
+        if (best < 0) {
+            std::cout << "Error: Every combination failed: " << responses[0].error << std::endl;
+            failedImages++;
+            continue;
+        }
+        
+        // The best combination's files are named exactly like a run with its parameters
+        const StringArtRequest& bestRequest = requests[best];
+        const StringArtResponse& bestResult = responses[best];
+        std::string bestBase = baseFilename + outputSuffix(bestRequest);
+        std::string txtFilename = bestBase + ".txt";
+        std::string svgFilename = bestBase + ".svg";
+        std::vector<int> nailSequence = bestResult.sequence;
+        NailLayout layout = bestResult.layout;
+        double contrastFactor = bestRequest.contrastFactor;
+        std::string threadThickness = bestRequest.threadThickness;
+        
+        writer.submit(txtFilename, [=]() {
+            return writeInstructions(txtFilename, nailSequence, layout, timestamp, inputFile, contrastFactor, threadThickness);
+        });
+        writer.submit(svgFilename, [=, width = img.width, height = img.height, paperWidth = bestRequest.paperWidth,
+                                    paperHeight = bestRequest.paperHeight]() {
+            return generateSVG(svgFilename, nailSequence, layout, width, height, threadThickness, paperWidth, paperHeight);
+        });
+        if (writePreview) {
+            std::string previewFilename = bestBase + "-preview." + (previewFormat == "png" ? "png" : "pgm");
+            std::string metricsFilename = bestBase + "-metrics.txt";
+            writer.submit(previewFilename, [previewFilename, preview = bestResult.preview, width = img.width, height = img.height]() {
+                if (!writePreviewImage(previewFilename, preview, width, height, 1)) {
+                    return false;
+                }
+                std::cout << "[+] Preview saved to: " << previewFilename << std::endl;
+                return true;
+            });
+            writer.submit(metricsFilename, [metricsFilename, metrics = bestResult.metrics, numStrings = (int)nailSequence.size(),
+                                            threadOpacity = bestResult.threadOpacity]() {
+                return writeMetricsFile(metricsFilename, metrics, numStrings, threadOpacity);
+            });
+        }
+        std::cout << "Best: #" << (best + 1) << ", RMSE " << bestResult.metrics.rmse << " -> " << txtFilename << std::endl;
+        std::cout << std::endl;
+    }
+    
+    bool outputOk = writer.finish();
+    std::cout << "Output: " << writer.filesWritten() << " files written (fsync: " << OutputWriter::policyName(fsyncPolicy) << ")" << std::endl;
+    if (!outputOk) {
+        std::cout << "Error: Could not write:" << std::endl;
+        for (const std::string& filename : writer.failures()) {
+            std::cout << "  " << filename << std::endl;
+        }
+    }
+    return (outputOk && failedImages == 0) ? 0 : 1;
+}
+
 void printUsage(const char* programName) {
     std::cout << "String Art Generator - Convert images to nail-and-string art instructions" << std::endl;
     std::cout << "========================================================================" << std::endl;
     std::cout << std::endl;
-    std::cout << "Usage: " << programName << " <image_file> [options]" << std::endl;
+    std::cout << "Usage: " << programName << " <image_file> [image_file...] [options]" << std::endl;
     std::cout << std::endl;
     std::cout << "Arguments:" << std::endl;
-    std::cout << "  image_file               Input image file (PNG, JPG/JPEG, BMP)" << std::endl;
+    std::cout << "  image_file               Input image file (PNG, JPG/JPEG, BMP); several run as a batch" << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -n, --nails <num>        Number of nails (50-1000, default: 400)" << std::endl;
     std::cout << "  -s, --strings <num>      Maximum number of strings (0=unlimited, default: 0)" << std::endl;
+    std::cout << "                           A list (1000,2000,4000) writes every count from one run" << std::endl;
     std::cout << "  -o, --output <file>      Output filename base (parameters added automatically)" << std::endl;
     std::cout << "  -c, --circular           Use circular layout (default)" << std::endl;
     std::cout << "  -r, --rectangular        Use rectangular layout" << std::endl;
+    std::cout << "  --layout <shape>         Nail layout: circle, rectangle, ellipse, polygon[:sides], csv:<file>" << std::endl;
+    std::cout << "                           (csv: one normalized x,y per line; nail count comes from the file)" << std::endl;
     std::cout << "  --contrast <factor>      Contrast adjustment (0.0-2.0, default: 0.5)" << std::endl;
     std::cout << "  --thread <thickness>     Thread thickness (0.1mm,0.2mm,0.3mm,0.5mm, default: 0.1mm)" << std::endl;
     std::cout << "  --coverage-strategy <n>  Coverage strategy (0=default, 1=adaptive, 2=dynamic, 3=exploration, default: 0)" << std::endl;
     std::cout << "  --color [order]          Generate color string art with CMYK separation (default order: CMYK)" << std::endl;
     std::cout << "                           Optional order: CMYK, MYKC, YKCM, etc. (default: grayscale mode)" << std::endl;
     std::cout << "  --strings-per-color <n>  Strings per color channel in color mode (default: 2500, max: 2500)" << std::endl;
+    std::cout << "  --palette <spec>         Color with your own threads instead of CMYK: auto[:N] (N colors from the image)" << std::endl;
+    std::cout << "                           or a list like ff0000,name=1e3a8a,#000000 (wound and layered in that order)" << std::endl;
+    std::cout << "  --roi <auto|mask>        Spend the strings on the subject: auto (detected against the background) or a" << std::endl;
+    std::cout << "                           mask image (white = important, black = ignore, gray = in between)" << std::endl;
     std::cout << "  --paper-size <wxh>       Paper size in mm (default: 609.6x914.4mm, A4: 210x297, A3: 297x420)" << std::endl;
+    std::cout << "  --restarts <n>           Grayscale: run n solves from different start nails, keep the best (default: 1)" << std::endl;
+    std::cout << "  --threads <n>            Worker threads for parallel modes (0=all cores, default: 0)" << std::endl;
+    std::cout << "  --refine <seconds>       Local-search refinement of the finished sequence, capped at this long" << std::endl;
+    std::cout << "  --refine-moves <count>   Refinement length in moves (default " << DEFAULT_REFINE_MOVES_PER_STRING << " per string); the same count gives the same result" << std::endl;
+    std::cout << "  --time-budget <seconds>  Stop each image's solve (and refinement) after this long, keeping the strings so far" << std::endl;
+    std::cout << "  --preview [format]       Write a rendered preview and metrics file (png or pgm, default: png)" << std::endl;
+    std::cout << "  --chord-cache <dir>      Keep rasterized chord geometry in <dir> and reuse it on later runs" << std::endl;
+    std::cout << "  --result-cache <dir>     Reuse finished sequences for the same image and settings (skips solving)" << std::endl;
+    std::cout << "  --result-cache-size <MB> Size bound of the result cache; least recently used entries go first (default: 256)" << std::endl;
+    std::cout << "  --max-memory <MB>        Memory budget for chord geometry; above it chords are traced on demand" << std::endl;
+    std::cout << "  --live <n>               Update a live preview image every n strings while generating" << std::endl;
+    std::cout << "  --live-file <path>       Live preview target: .png, .pgm or a named pipe (default: <output>-live.png)" << std::endl;
+    std::cout << "  --work-size <px>         Short side of the processing image (100-2000, default: 400)" << std::endl;
+    std::cout << "  --resample <filter>      Downscaling filter: box (area average) or lanczos (default: box)" << std::endl;
+    std::cout << "  --supersample [factor]   Physical coverage model on a subpixel grid (1, 2, 4, 8, default: auto from thread/paper)" << std::endl;
+    std::cout << "  --fixed-point            Integer scoring: identical sequences on every machine and thread count" << std::endl;
+    std::cout << "  --residual               Residual-image model: one integer plane of missing darkness, each string subtracts its own" << std::endl;
+    std::cout << "  --joint-color            Solve all four CMYK threads together, interleaving them in winding order" << std::endl;
+    std::cout << "  --lazy                   Lazy candidate selection: same sequence, most chords never re-scored" << std::endl;
+    std::cout << "  --verify <dir>           Compare the .txt and .svg results with golden copies in <dir>; exit 1 on any difference" << std::endl;
+    std::cout << "  --max-seconds <s>        Fail any image whose run (solve, refine, render) takes longer than this" << std::endl;
+    std::cout << "  --fsync <policy>         Force output files to disk: none, file (each file) or end (once, at exit)" << std::endl;
+    std::cout << "  --sweep <name=v1,v2,...> Solve every combination of parameter grids on one decoded image, in parallel;" << std::endl;
+    std::cout << "                           repeatable (contrast, strategy, nails, strings). Writes a table and the best result" << std::endl;
+    std::cout << "  --serve [socket]         Job server: JSON requests, one per line, on stdin (or a Unix socket); other options" << std::endl;
+    std::cout << "                           are job defaults and --threads sets the number of workers" << std::endl;
     std::cout << "  -h, --help               Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "Output Files:" << std::endl;
@@ -61,6 +406,7 @@ void printUsage(const char* programName) {
     std::cout << "  " << programName << " image.png -n 400 -s 2000                # Grayscale with 2000 strings" << std::endl;
     std::cout << "  " << programName << " photo.png --color MYKC --strings-per-color 1500  # Color with custom order, 1500 per color" << std::endl;
     std::cout << "  " << programName << " portrait.png --color                            # Color with default CMYK order, 2500 per color" << std::endl;
+    std::cout << "  " << programName << " portrait.png --palette red=c0392b,navy=1e3a8a,000000  # Color with the threads you stock" << std::endl;
     std::cout << std::endl;
     std::cout << "Note: Always use PNG files for testing! BMP files are natively supported." << std::endl;
     std::cout << "      For PNG/JPEG support, ensure appropriate image libraries are available." << std::endl;
@@ -69,11 +415,13 @@ void printUsage(const char* programName) {
 int main(int argc, char* argv[]) {
     std::string timestamp = generateTimestamp();
     
-    std::string inputFile = "";
+    std::vector<std::string> inputFiles;  // Several images run as a batch
     std::string outputFile = "";
     int numNails = 400;
     int maxStrings = 0;
+    std::vector<int> snapshotStrings;  // Smaller counts of a --strings list, written from the same run
     bool isCircular = true;
+    std::string layoutSpec = "";  // Empty = from -c/-r
     double contrastFactor = 0.5;
     std::string threadThickness = "0.1mm";
     int coverageStrategy = 0; // 0=current/default, 1=adaptive_coverage, 2=dynamic_threshold, 3=exploration_boost
@@ -87,13 +435,83 @@ int main(int argc, char* argv[]) {
     double paperWidth = 609.6;   // Default: 24x36 banana units
     double paperHeight = 914.4;
     
+    // Multi-start options
+    int restarts = 1;
+    int numThreads = 0;  // 0 = hardware concurrency
+    
+    // Preview options (metrics are always printed)
+    bool writePreview = false;
+    std::string previewFormat = "png";
+    
+    // Post-optimization: wall-clock cap in seconds (0 = none) and move count (0 = default per string);
+    // refinement runs when either is set
+    double refineSeconds = 0.0;
+    long long refineMoves = 0;
+    
+    // Wall-clock limit per image for solving and refinement in seconds (0 = none)
+    double timeBudgetSeconds = 0.0;
+    
+    // Regression checks: golden output directory (empty = off) and per-image time limit (0 = off)
+    std::string verifyDir;
+    double maxSeconds = 0.0;
+    
+    // Persistent chord geometry cache directory (empty = off)
+    std::string chordCacheDir;
+    
+    // Chord geometry memory budget in MB (0 = unlimited)
+    double maxMemoryMB = 0.0;
+    
+    // Content-addressed result cache directory (empty = off) and its size bound in MB
+    std::string resultCacheDir;
+    double resultCacheMB = ResultCache::DEFAULT_MAX_BYTES / (1024.0 * 1024.0);
+    
+    // Live preview: strings between frames (0 = off) and target file
+    int liveInterval = 0;
+    std::string liveFilename;
+    
+    // Processing resolution and downscaling filter
+    int workSize = DEFAULT_WORK_SIZE;
+    ResampleFilter resampleFilter = RESAMPLE_BOX;
+    
+    // Physical coverage model: -1 = off, 0 = factor from thread width and paper size
+    int supersample = -1;
+    
+    // Integer scoring for reproducible sequences
+    bool fixedPoint = false;
+    
+    // Residual-image scoring model
+    bool residual = false;
+    
+    // Lazy (bound-based) candidate selection
+    bool lazyEvaluation = false;
+    
+    // Color: one joint engine for the four threads
+    bool jointColor = false;
+    
+    // Color: thread palette instead of CMYK (empty = CMYK)
+    std::string paletteSpec;
+    
+    // Region of interest: empty = whole image, "auto" or a mask file
+    std::string roiSpec;
+    
+    // When result files are forced to disk
+    FsyncPolicy fsyncPolicy = FSYNC_NONE;
+    
+    // Parameter grids for --sweep (empty = a single run per image)
+    std::vector<SweepAxis> sweepAxes;
+    
+    // Job server mode: requests on stdin, or on a Unix socket when a path is given
+    bool serveMode = false;
+    std::string serveSocket;
+    
     // Parse command line arguments
-    // First argument (if not an option) is the input file
-    if (argc > 1 && argv[1][0] != '-') {
-        inputFile = argv[1];
+    // Leading arguments (if not options) are the input files
+    int firstOption = 1;
+    while (firstOption < argc && argv[firstOption][0] != '-') {
+        inputFiles.push_back(argv[firstOption++]);
     }
     
-    for (int i = (inputFile.empty() ? 1 : 2); i < argc; i++) {
+    for (int i = firstOption; i < argc; i++) {
         std::string arg = argv[i];
         
         if (arg == "-h" || arg == "--help") {
@@ -110,7 +528,21 @@ int main(int argc, char* argv[]) {
         }
         else if (arg == "-s" || arg == "--strings") {
             if (i + 1 < argc) {
-                maxStrings = std::atoi(argv[++i]);
+                // A comma list solves once to the largest count; the others are snapshots on the way
+                std::stringstream list(argv[++i]);
+                std::string item;
+                std::vector<int> counts;
+                while (std::getline(list, item, ',')) {
+                    counts.push_back(std::atoi(item.c_str()));
+                }
+                std::sort(counts.begin(), counts.end());
+                counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+                if (counts.size() > 1 && counts.front() <= 0) {
+                    std::cout << "Error: Every count in a --strings list must be positive" << std::endl;
+                    return 1;
+                }
+                maxStrings = counts.empty() ? 0 : counts.back();
+                snapshotStrings.assign(counts.begin(), counts.end() - (counts.empty() ? 0 : 1));
             } else {
                 std::cout << "Error: --strings requires a number" << std::endl;
                 return 1;
@@ -130,6 +562,18 @@ int main(int argc, char* argv[]) {
         else if (arg == "-r" || arg == "--rectangular") {
             isCircular = false;
         }
+        else if (arg == "--layout") {
+            if (i + 1 < argc) {
+                layoutSpec = argv[++i];
+                if (!NailLayout::isValidSpec(layoutSpec)) {
+                    std::cout << "Error: --layout must be circle, rectangle, ellipse, polygon[:3-32] or csv:<file>" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --layout requires a shape" << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "--contrast") {
             if (i + 1 < argc) {
                 contrastFactor = std::atof(argv[++i]);
@@ -212,6 +656,270 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
         }
+        else if (arg == "--restarts") {
+            if (i + 1 < argc) {
+                restarts = std::atoi(argv[++i]);
+                if (restarts < 1 || restarts > 1000) {
+                    std::cout << "Error: --restarts must be between 1 and 1000" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --restarts requires a number" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--threads") {
+            if (i + 1 < argc) {
+                numThreads = std::atoi(argv[++i]);
+                if (numThreads < 0) {
+                    std::cout << "Error: --threads must be 0 or positive" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --threads requires a number" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--refine") {
+            if (i + 1 < argc) {
+                refineSeconds = std::atof(argv[++i]);
+                if (refineSeconds < 0.0) {
+                    std::cout << "Error: --refine must be 0 or positive" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --refine requires a time budget in seconds" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--refine-moves") {
+            if (i + 1 < argc) {
+                refineMoves = std::atoll(argv[++i]);
+                if (refineMoves <= 0) {
+                    std::cout << "Error: --refine-moves must be positive" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --refine-moves requires a number of moves" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--time-budget") {
+            if (i + 1 < argc) {
+                timeBudgetSeconds = std::atof(argv[++i]);
+                if (timeBudgetSeconds < 0.0) {
+                    std::cout << "Error: --time-budget must be 0 or positive" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --time-budget requires a number of seconds" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--verify") {
+            if (i + 1 < argc) {
+                verifyDir = argv[++i];
+            } else {
+                std::cout << "Error: --verify requires a directory of golden files" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--max-seconds") {
+            if (i + 1 < argc) {
+                maxSeconds = std::atof(argv[++i]);
+                if (maxSeconds < 0.0) {
+                    std::cout << "Error: --max-seconds must be 0 or positive" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --max-seconds requires a number of seconds" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--preview") {
+            writePreview = true;
+            // Optional format argument, like --color
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                previewFormat = argv[++i];
+                std::transform(previewFormat.begin(), previewFormat.end(), previewFormat.begin(), ::tolower);
+                if (previewFormat != "png" && previewFormat != "pgm") {
+                    std::cout << "Error: --preview format must be png or pgm" << std::endl;
+                    return 1;
+                }
+            }
+        }
+        else if (arg == "--chord-cache") {
+            if (i + 1 < argc) {
+                chordCacheDir = argv[++i];
+            } else {
+                std::cout << "Error: --chord-cache requires a directory" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--result-cache") {
+            if (i + 1 < argc) {
+                resultCacheDir = argv[++i];
+            } else {
+                std::cout << "Error: --result-cache requires a directory" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--result-cache-size") {
+            if (i + 1 < argc) {
+                resultCacheMB = std::atof(argv[++i]);
+                if (resultCacheMB <= 0.0) {
+                    std::cout << "Error: --result-cache-size must be positive" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --result-cache-size requires a size in MB" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--live") {
+            if (i + 1 < argc) {
+                liveInterval = std::atoi(argv[++i]);
+                if (liveInterval < 1) {
+                    std::cout << "Error: --live must be at least 1" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --live requires a number of strings" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--live-file") {
+            if (i + 1 < argc) {
+                liveFilename = argv[++i];
+            } else {
+                std::cout << "Error: --live-file requires a path" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--work-size") {
+            if (i + 1 < argc) {
+                workSize = std::atoi(argv[++i]);
+                if (workSize < 100 || workSize > 2000) {
+                    std::cout << "Error: --work-size must be between 100 and 2000" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --work-size requires a size in pixels" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--resample") {
+            if (i + 1 < argc) {
+                std::string filterName = argv[++i];
+                if (filterName == "box") {
+                    resampleFilter = RESAMPLE_BOX;
+                } else if (filterName == "lanczos") {
+                    resampleFilter = RESAMPLE_LANCZOS;
+                } else {
+                    std::cout << "Error: --resample must be box or lanczos" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --resample requires a filter name" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--supersample") {
+            supersample = 0;
+            // Optional factor argument, like --preview
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                std::string factorStr = argv[++i];
+                if (factorStr != "auto") {
+                    supersample = std::atoi(factorStr.c_str());
+                    if (supersample != 1 && supersample != 2 && supersample != 4 && supersample != 8) {
+                        std::cout << "Error: --supersample factor must be auto, 1, 2, 4 or 8" << std::endl;
+                        return 1;
+                    }
+                }
+            }
+        }
+        else if (arg == "--fixed-point") {
+            fixedPoint = true;
+        }
+        else if (arg == "--residual") {
+            residual = true;
+        }
+        else if (arg == "--lazy") {
+            lazyEvaluation = true;
+        }
+        else if (arg == "--joint-color") {
+            jointColor = true;
+        }
+        else if (arg == "--palette") {
+            if (i + 1 < argc) {
+                paletteSpec = argv[++i];
+                std::vector<ThreadColor> colors;
+                int autoColors = 0;
+                if (!parsePalette(paletteSpec, colors, autoColors)) {
+                    std::cout << "Error: --palette takes auto[:N] (N 1-16) or up to 16 colors like ff0000,name=00ff00" << std::endl;
+                    return 1;
+                }
+                colorMode = true;
+            } else {
+                std::cout << "Error: --palette requires auto[:N] or a list of colors" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--roi") {
+            if (i + 1 < argc) {
+                roiSpec = argv[++i];
+                if (roiSpec != "auto" && !std::filesystem::exists(roiSpec)) {
+                    std::cout << "Error: --roi mask file not found: " << roiSpec << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --roi requires auto or a mask image file" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--max-memory") {
+            if (i + 1 < argc) {
+                maxMemoryMB = std::atof(argv[++i]);
+                if (maxMemoryMB < 0.0) {
+                    std::cout << "Error: --max-memory must be 0 or positive" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --max-memory requires a size in MB" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--sweep") {
+            if (i + 1 < argc) {
+                SweepAxis axis;
+                std::string error;
+                if (!parseSweepAxis(argv[++i], axis, error)) {
+                    std::cout << "Error: --sweep: " << error << std::endl;
+                    return 1;
+                }
+                sweepAxes.push_back(axis);
+            } else {
+                std::cout << "Error: --sweep requires name=value,value,..." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--serve") {
+            serveMode = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                serveSocket = argv[++i];
+            }
+        }
+        else if (arg == "--fsync") {
+            if (i + 1 < argc) {
+                if (!OutputWriter::parsePolicy(argv[++i], fsyncPolicy)) {
+                    std::cout << "Error: --fsync must be none, file or end" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cout << "Error: --fsync requires a policy" << std::endl;
+                return 1;
+            }
+        }
         else {
             std::cout << "Error: Unknown option: " << arg << std::endl;
             printUsage(argv[0]);
@@ -219,28 +927,36 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    if (inputFile.empty()) {
+    if (inputFiles.empty() && !serveMode) {
         std::cout << "Error: Image file needed" << std::endl;
         std::cout << "Usage: " << argv[0] << " <image_file> [options]" << std::endl;
         std::cout << "Use --help for more information" << std::endl;
         return 1;
     }
     
-    // Check if file exists
-    if (!std::filesystem::exists(inputFile)) {
-        std::cout << "Error: Image could not be found: " << inputFile << std::endl;
-        return 1;
+    // Every input is checked up front so a batch does not fail halfway through
+    for (const std::string& inputFile : inputFiles) {
+        // Check if file exists
+        if (!std::filesystem::exists(inputFile)) {
+            std::cout << "Error: Image could not be found: " << inputFile << std::endl;
+            return 1;
+        }
+        
+        // Check if file has valid image extension
+        std::string ext = inputFile.substr(inputFile.find_last_of(".") + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext != "png" && ext != "jpg" && ext != "jpeg" && ext != "bmp") {
+            std::cout << "Error: Filename is not an image (png, jpg, jpeg, bmp): " << inputFile << std::endl;
+            return 1;
+        }
     }
     
-    // Check if file has valid image extension
-    std::string ext = inputFile.substr(inputFile.find_last_of(".") + 1);
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-    if (ext != "png" && ext != "jpg" && ext != "jpeg" && ext != "bmp") {
-        std::cout << "Error: Filename is not an image (png, jpg, jpeg, bmp): " << inputFile << std::endl;
-        return 1;
+    if (layoutSpec.empty()) {
+        layoutSpec = isCircular ? "circle" : "rectangle";
     }
+    bool customLayout = layoutSpec.rfind("csv:", 0) == 0;
     
-    if (numNails < 50 || numNails > 1000) {
+    if (!customLayout && (numNails < 50 || numNails > 1000)) {
         std::cout << "Error: Number of nails must be between 50 and 1000" << std::endl;
         return 1;
     }
@@ -250,255 +966,530 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    std::cout << "================== String Art Generator ==================" << std::endl;
-    std::cout << "Converting image to nail-and-string art instructions..." << std::endl;
-    std::cout << std::endl;
-    std::cout << "Session Details:" << std::endl;
-    std::cout << "  Timestamp: " << timestamp << std::endl;
-    std::cout << "  Input image: " << inputFile << std::endl;
-    
-    // Generate descriptive filename based on parameters
-    std::string baseFilename;
-    if (outputFile.empty()) {
-        // Use full input filename (including extension)
-        baseFilename = inputFile;
-    } else {
-        baseFilename = outputFile;
+    if (!snapshotStrings.empty() && colorMode) {
+        std::cout << "Error: A --strings list is for grayscale; color mode uses --strings-per-color" << std::endl;
+        return 1;
     }
     
-    // Add ALL parameter suffixes (including defaults) - CONCISE FORMAT
-    std::stringstream suffix;
-    
-    // Always show nail count
-    suffix << "-n" << numNails;
-    
-    // Always show string count (0 = unlimited)
-    suffix << "-s" << maxStrings;
-    
-    // Always show layout type (c=circular, r=rectangular)
-    if (isCircular) {
-        suffix << "-c";
-    } else {
-        suffix << "-r";
+    if (!snapshotStrings.empty() && (refineSeconds > 0.0 || refineMoves > 0)) {
+        std::cout << "Error: --refine works on a single string count, not a --strings list" << std::endl;
+        return 1;
     }
     
-    // Always show contrast factor
-    suffix << "-" << std::fixed << std::setprecision(1) << contrastFactor;
-    
-    // Always show thread thickness (remove "mm" suffix)
-    // Remove "mm" from thickness values like "0.2mm" -> "0.2"
-    std::string thickness = threadThickness;
-    if (thickness.size() > 2 && thickness.substr(thickness.size()-2) == "mm") {
-        thickness = thickness.substr(0, thickness.size()-2);
+    if (!sweepAxes.empty() && (colorMode || !snapshotStrings.empty() || serveMode)) {
+        std::cout << "Error: --sweep is for single grayscale runs (not color, a --strings list or --serve)" << std::endl;
+        return 1;
     }
-    suffix << "-t" << thickness;
     
-    // Color mode vs Grayscale mode in filename
-    if (colorMode) {
-        // Color mode: show strings-per-color and color order instead of coverage strategy
-        suffix << "-spc" << stringsPerColor << "-" << colorOrder;
-    } else {
-        // Grayscale mode: show coverage strategy
-        int filenameStrategy = coverageStrategy;
-        if (maxStrings == 0 && coverageStrategy != 0) {
-            filenameStrategy = 0; // Unlimited strings force strategy 0
-        } else if (maxStrings > 0 && coverageStrategy == 0) {
-            filenameStrategy = 1; // Limited strings default to strategy 1
-        }
-        suffix << "-cs" << filenameStrategy;
+    if (fixedPoint && supersample >= 0) {
+        std::cout << "Error: --fixed-point and --supersample cannot be combined" << std::endl;
+        return 1;
+    }
+    if (residual && (fixedPoint || supersample >= 0)) {
+        std::cout << "Error: --residual cannot be combined with --fixed-point or --supersample" << std::endl;
+        return 1;
     }
     
-    outputFile = baseFilename + suffix.str() + ".txt";
-    std::string svgFilename = baseFilename + suffix.str() + ".svg";
+    // Serving on stdin: replies own stdout, and everything else the tool prints goes to stderr
+    std::ostream replies(std::cout.rdbuf());
+    if (serveMode && serveSocket.empty()) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
     
-    std::cout << "  Output files: " << outputFile << std::endl;
-    std::cout << "                " << svgFilename << std::endl;
-    std::cout << "  Layout type: " << (isCircular ? "Circular" : "Rectangular") << std::endl;
-    std::cout << "  Number of nails: " << numNails << std::endl;
-    std::cout << "  Max strings: " << (maxStrings > 0 ? std::to_string(maxStrings) : "unlimited") << std::endl;
-    std::cout << "  Contrast factor: " << contrastFactor << std::endl;
-    std::cout << "  Thread thickness: " << threadThickness << std::endl;
+    std::cout << "================== String Art Generator ==================" << std::endl;
+    std::cout << "Converting image to nail-and-string art instructions..." << std::endl;
     std::cout << std::endl;
     
-    // Load and process image
-    StringArtGenerator generator(contrastFactor);
-    ImageData img;
+    // Every image runs the same request through one engine, which keeps chord geometry warm between images
+    StringArtRequest request;
+    request.layoutSpec = layoutSpec;
+    request.numNails = numNails;
+    request.maxStrings = maxStrings;
+    request.snapshotStrings = snapshotStrings;
+    request.coverageStrategy = coverageStrategy;
+    request.contrastFactor = contrastFactor;
+    request.threadThickness = threadThickness;
+    request.paperWidth = paperWidth;
+    request.paperHeight = paperHeight;
+    request.colorMode = colorMode;
+    request.stringsPerColor = stringsPerColor;
+    request.colorOrder = colorOrder;
+    request.restarts = restarts;
+    request.numThreads = numThreads;
+    request.refineSeconds = refineSeconds;
+    request.refineMoves = refineMoves;
+    request.timeBudgetSeconds = timeBudgetSeconds;
+    request.supersample = supersample;
+    request.fixedPoint = fixedPoint;
+    request.residual = residual;
+    request.lazyEvaluation = lazyEvaluation;
+    request.jointColor = jointColor;
+    request.palette = paletteSpec;
+    request.roi = roiSpec;
+    request.workSize = workSize;
+    request.resampleFilter = resampleFilter;
+    request.chordCacheDir = chordCacheDir;
+    request.maxMemoryBytes = (size_t)(maxMemoryMB * 1024 * 1024);
+    request.resultCacheDir = resultCacheDir;
+    request.resultCacheBytes = (size_t)(resultCacheMB * 1024 * 1024);
+    request.progressInterval = liveInterval;
+    request.verbose = true;
     
-    std::cout << "Loading and processing image..." << std::endl;
-    if (colorMode) {
-        std::cout << "Color mode enabled - performing CMYK separation" << std::endl;
+    if (serveMode) {
+        int status;
+        {
+            JobServer server(request, numThreads);
+            status = serveSocket.empty() ? server.serveStream(std::cin, replies) : server.serveSocket(serveSocket);
+        }
+        std::cout.rdbuf(replies.rdbuf());
+        return status;
     }
-    if (!generator.loadImage(inputFile, img, colorMode)) {
-        std::cout << "Error: Cannot load image: " << inputFile << std::endl;
-        std::cout << "Make sure the file exists and is a supported format." << std::endl;
-        std::cout << "For PNG/JPEG files, ensure appropriate image libraries are available." << std::endl;
-        return 1;
+    
+    if (!sweepAxes.empty()) {
+        return runSweepMode(inputFiles, outputFile, request, sweepAxes, writePreview, previewFormat, fsyncPolicy, timestamp);
     }
     
-    std::cout << "Image loaded successfully: " << img.width << "x" << img.height << " pixels" << std::endl;
-    std::cout << std::endl;
+    StringArtEngine engine;
     
-    // Generate string art
-    std::cout << "Processing..." << std::endl;
+    // Result files are written on the I/O thread while the next image is decoded and solved
+    OutputWriter writer(fsyncPolicy);
+    int failedImages = 0;
     
-    if (colorMode) {
-        // Color mode: generate separate sequences for each CMYK channel
-        std::cout << "Color mode: Generating " << stringsPerColor << " strings per channel" << std::endl;
+    // Results to check against the golden directory once they are on disk
+    std::vector<std::string> verifyFiles;
+    int slowImages = 0;
+    
+    for (size_t imageIndex = 0; imageIndex < inputFiles.size(); imageIndex++) {
+        const std::string& inputFile = inputFiles[imageIndex];
+        if (inputFiles.size() > 1) {
+            std::cout << "[Image " << (imageIndex + 1) << "/" << inputFiles.size() << "]" << std::endl;
+        }
+        std::cout << "Session Details:" << std::endl;
+        std::cout << "  Timestamp: " << timestamp << std::endl;
+        std::cout << "  Input image: " << inputFile << std::endl;
         
-        StringArtGenerator::ColorStringSequences colorSequences = generator.generateColorStringArt(img, numNails, isCircular, stringsPerColor);
+        // Generate descriptive filename based on parameters
+        std::string baseFilename = outputBase(inputFile, outputFile, inputFiles.size() > 1);
         
-        if (colorSequences.totalStrings == 0) {
-            std::cout << "Error: Failed to generate color string art" << std::endl;
-            return 1;
-        }
+        std::string suffix = outputSuffix(request);
+        std::string txtFilename = baseFilename + suffix + ".txt";
+        std::string svgFilename = baseFilename + suffix + ".svg";
+        // PGM holds grayscale only; color previews use its RGB sibling PPM
+        std::string previewFilename = baseFilename + suffix + "-preview." + (previewFormat == "png" ? "png" : (colorMode ? "ppm" : "pgm"));
+        std::string metricsFilename = baseFilename + suffix + "-metrics.txt";
+        std::string imageLiveFilename = liveFilename.empty() ? baseFilename + suffix + "-live.png" : liveFilename;
         
-        // Generate color text instructions
-        std::ofstream txtFile(outputFile);
-        if (txtFile.is_open()) {
-            txtFile << "Color String Art Generator - CMYK Nail Connection Instructions\n";
-            txtFile << "===================================================================\n";
-            txtFile << "Generated: " << timestamp << "\n";
-            txtFile << "Input image: " << inputFile << "\n";
-            txtFile << "Mode: Color (CMYK separation)\n";
-            txtFile << "Layout: " << (isCircular ? "Circular" : "Rectangular") << "\n";
-            txtFile << "Total nails: " << numNails << "\n";
-            txtFile << "Strings per color: " << stringsPerColor << "\n";
-            txtFile << "Color order: " << colorOrder << "\n";
-            txtFile << "Total connections: " << colorSequences.totalStrings << "\n";
-            txtFile << "  - Cyan: " << colorSequences.cyanSequence.size() << " strings\n";
-            txtFile << "  - Magenta: " << colorSequences.magentaSequence.size() << " strings\n";
-            txtFile << "  - Yellow: " << colorSequences.yellowSequence.size() << " strings\n";
-            txtFile << "  - Black: " << colorSequences.blackSequence.size() << " strings\n";
-            txtFile << "Contrast factor: " << contrastFactor << "\n";
-            txtFile << "Thread thickness: " << threadThickness << "\n";
-            txtFile << "\n";
-            txtFile << "Color String Art Instructions:\n";
-            txtFile << "1. Arrange " << numNails << " nails in a " << (isCircular ? "circle" : "rectangle") << "\n";
-            txtFile << "2. Number them 0 to " << (numNails-1) << " going clockwise\n";
-            txtFile << "3. You will need FOUR different colored threads: CYAN, MAGENTA, YELLOW, BLACK\n";
-            txtFile << "4. Follow each color sequence in the specified order (" << colorOrder << ")\n";
-            txtFile << "5. Pull thread tight between each connection\n";
-            txtFile << "6. Use OPAQUE threads - threads are NOT transparent!\n";
-            txtFile << "\n";
-            
-            // Generate color sequences in user-specified order
-            std::vector<ColorOrderInfo> orderSequence = getColorOrderSequence(colorOrder);
-            
-            for (const ColorOrderInfo& colorInfo : orderSequence) {
-                const std::vector<int>& sequence = StringArtGenerator::getSequenceForColor(colorInfo.letter, colorSequences);
-                
-                if (!sequence.empty()) {
-                    txtFile << colorInfo.displayName << " Thread Sequence (" << sequence.size() << " connections):\n";
-                    for (size_t i = 0; i < sequence.size(); i++) {
-                        txtFile << sequence[i];
-                        if (i < sequence.size() - 1) txtFile << ",";
-                        if ((i + 1) % 20 == 0) txtFile << "\n";
-                    }
-                    txtFile << "\n\n";
-                }
+        // A snapshot's files differ from the full run's only in the string count
+        auto snapshotBase = [&](int count) {
+            StringArtRequest snapshotRequest = request;
+            snapshotRequest.maxStrings = count;
+            return baseFilename + outputSuffix(snapshotRequest);
+        };
+        
+        std::cout << "  Output files: " << txtFilename << std::endl;
+        std::cout << "                " << svgFilename << std::endl;
+        for (int count : snapshotStrings) {
+            std::cout << "                " << snapshotBase(count) << ".txt, .svg" << std::endl;
+        }
+        std::cout << "  Layout: " << layoutSpec << std::endl;
+        if (!customLayout) {
+            std::cout << "  Number of nails: " << numNails << std::endl;
+        }
+        std::cout << "  Max strings: " << (maxStrings > 0 ? std::to_string(maxStrings) : "unlimited") << std::endl;
+        if (!snapshotStrings.empty()) {
+            std::cout << "  Snapshots at:";
+            for (int count : snapshotStrings) {
+                std::cout << " " << count;
             }
-            
-            // Generate construction tips based on color order
-            txtFile << "Construction Tips:\n";
-            txtFile << "* Follow the color order: " << colorOrder << "\n";
-            txtFile << "* It's recommended to start with darker colors first\n";
-            txtFile << "* Each color contributes to the final image - all are important!\n";
-            txtFile << "* Use high-quality, opaque threads for best results\n";
-            
-            txtFile.close();
-            std::cout << "[+] Color text instructions saved to: " << outputFile << std::endl;
+            std::cout << " strings (open-ended strength schedule)" << std::endl;
+        }
+        std::cout << "  Contrast factor: " << contrastFactor << std::endl;
+        std::cout << "  Thread thickness: " << threadThickness << std::endl;
+        if (restarts > 1) {
+            std::cout << "  Restarts: " << restarts << (colorMode ? " (ignored in color mode)" : "") << std::endl;
+        }
+        if (timeBudgetSeconds > 0.0) {
+            std::cout << "  Time budget: " << timeBudgetSeconds << "s" << std::endl;
         }
+        std::cout << std::endl;
         
-        // Generate color SVG
-        generateColorSVG(svgFilename, colorSequences, numNails, isCircular, img.width, img.height, threadThickness, colorOrder, paperWidth, paperHeight);
+        // Load and process image
+        ImageData img;
         
+        std::cout << "Loading and processing image..." << std::endl;
+        if (colorMode) {
+            std::cout << "Color mode enabled - " << (paletteSpec.empty() ? "performing CMYK separation" : "separating into thread palette") << std::endl;
+        }
+        if (!engine.loadImage(inputFile, request, img)) {
+            std::cout << "Error: Cannot load image: " << inputFile << std::endl;
+            std::cout << "Make sure the file exists and is a supported format." << std::endl;
+            std::cout << "For PNG/JPEG files, ensure appropriate image libraries are available." << std::endl;
+            failedImages++;
+            continue;
+        }
+        
+        std::cout << "Image loaded successfully: " << img.width << "x" << img.height << " pixels" << std::endl;
         std::cout << std::endl;
-        std::cout << "=================== COLOR SUCCESS! ===================" << std::endl;
-        std::cout << "Color string art generation completed successfully!" << std::endl;
-        std::cout << "Total nail connections: " << colorSequences.totalStrings << std::endl;
-        std::cout << "  Cyan: " << colorSequences.cyanSequence.size() << " strings" << std::endl;
-        std::cout << "  Magenta: " << colorSequences.magentaSequence.size() << " strings" << std::endl;
-        std::cout << "  Yellow: " << colorSequences.yellowSequence.size() << " strings" << std::endl;
-        std::cout << "  Black: " << colorSequences.blackSequence.size() << " strings" << std::endl;
-        std::cout << std::endl;
-        std::cout << "Files created successfully! You can now:" << std::endl;
-        std::cout << "* Open the .txt file for step-by-step CMYK instructions" << std::endl;
-        std::cout << "* View the .svg file in a web browser for colored thread visualization" << std::endl;
-        std::cout << "* Use CYAN, MAGENTA, YELLOW, and BLACK opaque threads!" << std::endl;
         
-    } else {
-        // Grayscale mode: use existing logic
-        std::vector<int> nailSequence;
-        
-        // Adjust coverage strategy based on string limits
-        int actualCoverageStrategy = coverageStrategy;
-        if (maxStrings == 0 && coverageStrategy != 0) {
-            // Unlimited strings: force to strategy 0
-            actualCoverageStrategy = 0;
+        // Live preview frames are rendered and written on a background thread, from the layout the engine builds
+        std::unique_ptr<LivePreview> livePreview;
+        auto progress = [&](const StringArtProgress& update) {
+            if (update.stage == STAGE_SNAPSHOT) {
+                // Written on the I/O thread while the solver carries on toward the next count
+                const StringArtResponse& response = *update.response;
+                std::vector<int> nailSequence = *update.sequence;
+                const NailLayout& layout = response.layout;
+                std::string snapshotTxt = snapshotBase(update.snapshotStrings) + ".txt";
+                std::string snapshotSvg = snapshotBase(update.snapshotStrings) + ".svg";
+                std::cout << "Snapshot: " << update.snapshotStrings << " strings" << std::endl;
+                writer.submit(snapshotTxt, [=]() {
+                    return writeInstructions(snapshotTxt, nailSequence, layout, timestamp, inputFile, contrastFactor, threadThickness);
+                });
+                writer.submit(snapshotSvg, [=, width = response.width, height = response.height]() {
+                    return generateSVG(snapshotSvg, nailSequence, layout, width, height, threadThickness, paperWidth, paperHeight);
+                });
+                if (!verifyDir.empty()) {
+                    verifyFiles.push_back(snapshotTxt);
+                    verifyFiles.push_back(snapshotSvg);
+                }
+            } else if (update.sequence) {
+                if (livePreview) livePreview->submit(*update.sequence);
+            } else if (update.stage == STAGE_SOLVING && liveInterval > 0) {
+                const StringArtResponse& response = *update.response;
+                livePreview.reset(new LivePreview(imageLiveFilename, response.layout.positions(), response.width, response.height,
+                                                  response.threadOpacity));
+                std::cout << "Live preview: " << imageLiveFilename << " (every " << liveInterval << " strings)" << std::endl;
+            } else if (update.stage == STAGE_REFINING) {
+                finishLivePreview(livePreview);
+                std::cout << (colorMode ? (paletteSpec.empty() ? "Refining CMYK sequences (" : "Refining palette sequences (")
+                                        : "Refining sequence (");
+                if (refineMoves > 0) {
+                    std::cout << refineMoves << " moves";
+                } else {
+                    std::cout << DEFAULT_REFINE_MOVES_PER_STRING << " moves per string";
+                }
+                if (refineSeconds > 0.0) {
+                    std::cout << ", " << refineSeconds << "s cap";
+                }
+                std::cout << ")..." << std::endl;
+            }
+        };
+        
+        // Generate string art
+        std::cout << "Processing..." << std::endl;
+        if (colorMode) {
+            // Color mode: generate separate sequences for each CMYK channel or palette thread
+            std::cout << "Color mode: Generating " << stringsPerColor << " strings per " << (paletteSpec.empty() ? "channel" : "thread color") << std::endl;
+        } else if (maxStrings == 0 && coverageStrategy != 0) {
             std::cout << "Note: Coverage strategy " << coverageStrategy << " requires limited strings. Using default strategy 0 for unlimited strings." << std::endl;
         } else if (maxStrings > 0 && coverageStrategy == 0) {
-            // Limited strings but default strategy: use strategy 1 instead
-            actualCoverageStrategy = 1;
             std::cout << "Note: Using coverage strategy 1 (adaptive) for limited strings instead of default strategy 0." << std::endl;
         }
         
-        if (actualCoverageStrategy == 0) {
-            nailSequence = generator.generateStringArt(img, numNails, isCircular, maxStrings);
-        } else {
-            nailSequence = generator.generateStringArtExperimental(img, numNails, isCircular, maxStrings, actualCoverageStrategy);
+        StringArtResponse result = engine.run(img, request, progress);
+        finishLivePreview(livePreview);
+        
+        if (!result.success) {
+            std::cout << "Error: " << result.error << std::endl;
+            failedImages++;
+            continue;
         }
         
-        if (nailSequence.empty()) {
-            std::cout << "Error: Failed to generate string art" << std::endl;
-            return 1;
+        if (result.cacheHit) {
+            std::cout << "Result cache: hit " << result.cacheKey << ", solving skipped" << std::endl;
+        }
+        if (result.timedOut) {
+            std::cout << "Note: Time budget of " << timeBudgetSeconds << "s reached; keeping the strings placed so far" << std::endl;
         }
         
-        // Save grayscale text file
-        std::ofstream txtFile(outputFile);
-        if (txtFile.is_open()) {
-            txtFile << "String Art Generator - Nail Connection List\n";
-            txtFile << "===========================================\n";
-            txtFile << "Generated: " << timestamp << "\n";
-            txtFile << "Input image: " << inputFile << "\n";
-            txtFile << "Layout: " << (isCircular ? "Circular" : "Rectangular") << "\n";
-            txtFile << "Total nails: " << numNails << "\n";
-            txtFile << "Number of connections: " << nailSequence.size() << "\n";
-            txtFile << "Contrast factor: " << contrastFactor << "\n";
-            txtFile << "Thread thickness: " << threadThickness << "\n";
-            txtFile << "\n";
-            txtFile << "Nail sequence (follow this order to create string art):\n";
+        const ReconstructionMetrics& metrics = result.metrics;
+        std::cout << "Reconstruction: RMSE " << metrics.rmse << ", PSNR " << metrics.psnr << " dB, SSIM " << metrics.ssim << std::endl;
+        
+        if (maxSeconds > 0.0 && result.elapsedSeconds > maxSeconds) {
+            std::cout << "Error: Run took " << result.elapsedSeconds << "s, over the "
+                      << maxSeconds << "s limit" << std::endl;
+            slowImages++;
+        }
+        if (!verifyDir.empty()) {
+            verifyFiles.push_back(txtFilename);
+            verifyFiles.push_back(svgFilename);
+        }
+        
+        // The layout the engine solved on is shared by the instructions and the SVG
+        const NailLayout& layout = result.layout;
+        int layoutNails = layout.size();
+        double threadOpacity = result.threadOpacity;
+        
+        if (!paletteSpec.empty()) {
+            const StringArtGenerator::PaletteStringSequences& paletteSequences = result.paletteSequences;
+            const std::vector<ThreadColor>& colors = paletteSequences.colors;
+            if (result.paletteSeconds > 0.0) {
+                std::cout << "Automatic palette: " << colors.size() << " colors in " << result.paletteSeconds * 1000.0 << " ms" << std::endl;
+            }
+        
+            // Queue the palette text instructions; the I/O thread writes them while the next image runs
+            writer.submit(txtFilename, [=]() {
+                std::ofstream txtFile(txtFilename);
+                if (!txtFile.is_open()) {
+                    return false;
+                }
+                
+                txtFile << "Color String Art Generator - Thread Palette Nail Connection Instructions\n";
+                txtFile << "=========================================================================\n";
+                txtFile << "Generated: " << timestamp << "\n";
+                txtFile << "Input image: " << inputFile << "\n";
+                txtFile << "Mode: Color (thread palette " << paletteSpec << ")\n";
+                txtFile << "Layout: " << layout.displayName() << "\n";
+                txtFile << "Total nails: " << layoutNails << "\n";
+                txtFile << "Strings per color: " << stringsPerColor << "\n";
+                txtFile << "Total connections: " << paletteSequences.totalStrings << "\n";
+                for (size_t c = 0; c < colors.size(); c++) {
+                    txtFile << "  - " << threadName(colors[c]) << ": " << paletteSequences.sequences[c].size() << " strings\n";
+                }
+                txtFile << "Contrast factor: " << contrastFactor << "\n";
+                txtFile << "Thread thickness: " << threadThickness << "\n";
+                txtFile << "\n";
+                txtFile << "Color String Art Instructions:\n";
+                txtFile << "1. Arrange " << layoutNails << " nails in a " << layout.shapeNoun() << "\n";
+                txtFile << "2. Number them 0 to " << (layoutNails-1) << " going clockwise\n";
+                txtFile << "3. You will need " << colors.size() << " thread colors, listed above\n";
+                txtFile << "4. Follow each color sequence in the order listed\n";
+                txtFile << "5. Pull thread tight between each connection\n";
+                txtFile << "6. Use OPAQUE threads - threads are NOT transparent!\n";
+                txtFile << "\n";
+            
+                for (size_t c = 0; c < colors.size(); c++) {
+                    const std::vector<int>& sequence = paletteSequences.sequences[c];
+                    if (!sequence.empty()) {
+                        txtFile << threadName(colors[c]) << " Thread Sequence (" << sequence.size() << " connections):\n";
+                        for (size_t i = 0; i < sequence.size(); i++) {
+                            txtFile << sequence[i];
+                            if (i < sequence.size() - 1) txtFile << ",";
+                            if ((i + 1) % 20 == 0) txtFile << "\n";
+                        }
+                        txtFile << "\n\n";
+                    }
+                }
             
-            for (size_t i = 0; i < nailSequence.size(); i++) {
-                txtFile << nailSequence[i];
-                if (i < nailSequence.size() - 1) txtFile << ",";
-                if ((i + 1) % 20 == 0) txtFile << "\n";
+                txtFile.close();
+                if (txtFile.fail()) {
+                    return false;
+                }
+                std::cout << "[+] Palette text instructions saved to: " << txtFilename << std::endl;
+                return true;
+            });
+        
+            writer.submit(svgFilename, [svgFilename, paletteSequences, layout, width = img.width, height = img.height, threadThickness, paperWidth, paperHeight]() {
+                return generatePaletteSVG(svgFilename, paletteSequences, layout, width, height, threadThickness, paperWidth, paperHeight);
+            });
+        
+            if (writePreview) {
+                writer.submit(previewFilename, [previewFilename, preview = result.preview, width = img.width, height = img.height]() {
+                    if (!writePreviewImage(previewFilename, preview, width, height, 3)) {
+                        return false;
+                    }
+                    std::cout << "[+] Preview saved to: " << previewFilename << std::endl;
+                    return true;
+                });
+                writer.submit(metricsFilename, [metricsFilename, metrics, numStrings = paletteSequences.totalStrings, threadOpacity]() {
+                    return writeMetricsFile(metricsFilename, metrics, numStrings, threadOpacity);
+                });
+            }
+        
+            std::cout << std::endl;
+            std::cout << "=================== COLOR SUCCESS! ===================" << std::endl;
+            std::cout << "Palette string art generation completed successfully!" << std::endl;
+            std::cout << "Total nail connections: " << paletteSequences.totalStrings << std::endl;
+            for (size_t c = 0; c < colors.size(); c++) {
+                std::cout << "  " << threadName(colors[c]) << ": " << paletteSequences.sequences[c].size() << " strings" << std::endl;
             }
+            std::cout << std::endl;
+            std::cout << "Files created successfully! You can now:" << std::endl;
+            std::cout << "* Open the .txt file for step-by-step instructions per thread color" << std::endl;
+            std::cout << "* View the .svg file in a web browser for colored thread visualization" << std::endl;
+        
+        } else if (colorMode) {
+            const StringArtGenerator::ColorStringSequences& colorSequences = result.colorSequences;
+        
+            // Queue the color text instructions; the I/O thread writes them while the next image runs
+            writer.submit(txtFilename, [=]() {
+                std::ofstream txtFile(txtFilename);
+                if (!txtFile.is_open()) {
+                    return false;
+                }
+                
+                txtFile << "Color String Art Generator - CMYK Nail Connection Instructions\n";
+                txtFile << "===================================================================\n";
+                txtFile << "Generated: " << timestamp << "\n";
+                txtFile << "Input image: " << inputFile << "\n";
+                txtFile << "Mode: Color (CMYK separation)\n";
+                txtFile << "Layout: " << layout.displayName() << "\n";
+                txtFile << "Total nails: " << layoutNails << "\n";
+                txtFile << "Strings per color: " << stringsPerColor << "\n";
+                txtFile << "Color order: " << colorOrder << "\n";
+                txtFile << "Total connections: " << colorSequences.totalStrings << "\n";
+                txtFile << "  - Cyan: " << colorSequences.cyanSequence.size() << " strings\n";
+                txtFile << "  - Magenta: " << colorSequences.magentaSequence.size() << " strings\n";
+                txtFile << "  - Yellow: " << colorSequences.yellowSequence.size() << " strings\n";
+                txtFile << "  - Black: " << colorSequences.blackSequence.size() << " strings\n";
+                txtFile << "Contrast factor: " << contrastFactor << "\n";
+                txtFile << "Thread thickness: " << threadThickness << "\n";
+                txtFile << "\n";
+                txtFile << "Color String Art Instructions:\n";
+                txtFile << "1. Arrange " << layoutNails << " nails in a " << layout.shapeNoun() << "\n";
+                txtFile << "2. Number them 0 to " << (layoutNails-1) << " going clockwise\n";
+                txtFile << "3. You will need FOUR different colored threads: CYAN, MAGENTA, YELLOW, BLACK\n";
+                txtFile << "4. Follow each color sequence in the specified order (" << colorOrder << ")\n";
+                txtFile << "5. Pull thread tight between each connection\n";
+                txtFile << "6. Use OPAQUE threads - threads are NOT transparent!\n";
+                txtFile << "\n";
             
-            txtFile << "\n\n";
-            txtFile << "Instructions:\n";
-            txtFile << "1. Arrange " << numNails << " nails in a " << (isCircular ? "circle" : "rectangle") << "\n";
-            txtFile << "2. Number them 0 to " << (numNails-1) << " going clockwise\n";
-            txtFile << "3. Connect the nails with BLACK thread in the sequence shown above\n";
-            txtFile << "4. Pull thread tight between each connection\n";
-            txtFile << "5. Use OPAQUE thread - threads are NOT transparent!\n";
+                // Generate color sequences in user-specified order
+                std::vector<ColorOrderInfo> orderSequence = getColorOrderSequence(colorOrder);
             
-            txtFile.close();
-            std::cout << "[+] Text instructions saved to: " << outputFile << std::endl;
-        }
+                for (const ColorOrderInfo& colorInfo : orderSequence) {
+                    const std::vector<int>& sequence = StringArtGenerator::getSequenceForColor(colorInfo.letter, colorSequences);
+                
+                    if (!sequence.empty()) {
+                        txtFile << colorInfo.displayName << " Thread Sequence (" << sequence.size() << " connections):\n";
+                        for (size_t i = 0; i < sequence.size(); i++) {
+                            txtFile << sequence[i];
+                            if (i < sequence.size() - 1) txtFile << ",";
+                            if ((i + 1) % 20 == 0) txtFile << "\n";
+                        }
+                        txtFile << "\n\n";
+                    }
+                }
+            
+                // The joint solver's order: wind that many strings of a thread, then switch
+                if (!colorSequences.windingOrder.empty()) {
+                    static const char channelLetters[] = {'C', 'M', 'Y', 'K'};
+                    txtFile << "Interleaved Winding Order (thread and number of strings, instead of one color at a time):\n";
+                    const std::vector<int>& order = colorSequences.windingOrder;
+                    int runs = 0;
+                    for (size_t i = 0; i < order.size();) {
+                        size_t end = i;
+                        while (end < order.size() && order[end] == order[i]) end++;
+                        txtFile << channelLetters[order[i]] << (end - i);
+                        runs++;
+                        txtFile << (end < order.size() ? (runs % 20 == 0 ? "\n" : " ") : "\n");
+                        i = end;
+                    }
+                    txtFile << "\n";
+                }
+            
+                // Generate construction tips based on color order
+                txtFile << "Construction Tips:\n";
+                txtFile << "* Follow the color order: " << colorOrder << "\n";
+                txtFile << "* It's recommended to start with darker colors first\n";
+                txtFile << "* Each color contributes to the final image - all are important!\n";
+                txtFile << "* Use high-quality, opaque threads for best results\n";
+            
+                txtFile.close();
+                if (txtFile.fail()) {
+                    return false;
+                }
+                std::cout << "[+] Color text instructions saved to: " << txtFilename << std::endl;
+                return true;
+            });
         
-        // Generate grayscale SVG
-        generateSVG(svgFilename, nailSequence, numNails, isCircular, img.width, img.height, threadThickness, paperWidth, paperHeight);
+            // Generate color SVG
+            writer.submit(svgFilename, [svgFilename, colorSequences, layout, width = img.width, height = img.height, threadThickness, colorOrder, paperWidth, paperHeight]() {
+                return generateColorSVG(svgFilename, colorSequences, layout, width, height, threadThickness, colorOrder, paperWidth, paperHeight);
+            });
         
-        std::cout << std::endl;
-        std::cout << "=================== SUCCESS! ===================" << std::endl;
-        std::cout << "String art generation completed successfully!" << std::endl;
-        std::cout << "Total nail connections: " << nailSequence.size() << std::endl;
-        std::cout << std::endl;
-        std::cout << "Files created successfully! You can now:" << std::endl;
-        std::cout << "* Open the .txt file for step-by-step instructions" << std::endl;
-        std::cout << "* View the .svg file in a web browser for visual reference" << std::endl;
-        std::cout << "* Use OPAQUE BLACK threads to create your physical string art!" << std::endl;
+            if (writePreview) {
+                writer.submit(previewFilename, [previewFilename, preview = result.preview, width = img.width, height = img.height]() {
+                    if (!writePreviewImage(previewFilename, preview, width, height, 3)) {
+                        return false;
+                    }
+                    std::cout << "[+] Preview saved to: " << previewFilename << std::endl;
+                    return true;
+                });
+                writer.submit(metricsFilename, [metricsFilename, metrics, numStrings = colorSequences.totalStrings, threadOpacity]() {
+                    return writeMetricsFile(metricsFilename, metrics, numStrings, threadOpacity);
+                });
+            }
+        
+            std::cout << std::endl;
+            std::cout << "=================== COLOR SUCCESS! ===================" << std::endl;
+            std::cout << "Color string art generation completed successfully!" << std::endl;
+            std::cout << "Total nail connections: " << colorSequences.totalStrings << std::endl;
+            std::cout << "  Cyan: " << colorSequences.cyanSequence.size() << " strings" << std::endl;
+            std::cout << "  Magenta: " << colorSequences.magentaSequence.size() << " strings" << std::endl;
+            std::cout << "  Yellow: " << colorSequences.yellowSequence.size() << " strings" << std::endl;
+            std::cout << "  Black: " << colorSequences.blackSequence.size() << " strings" << std::endl;
+            std::cout << std::endl;
+            std::cout << "Files created successfully! You can now:" << std::endl;
+            std::cout << "* Open the .txt file for step-by-step CMYK instructions" << std::endl;
+            std::cout << "* View the .svg file in a web browser for colored thread visualization" << std::endl;
+            std::cout << "* Use CYAN, MAGENTA, YELLOW, and BLACK opaque threads!" << std::endl;
+        
+        } else {
+            const std::vector<int>& nailSequence = result.sequence;
+        
+            // Queue the text instructions; the I/O thread writes them while the next image runs
+            writer.submit(txtFilename, [=]() {
+                return writeInstructions(txtFilename, nailSequence, layout, timestamp, inputFile, contrastFactor, threadThickness);
+            });
+        
+            // Generate grayscale SVG
+            writer.submit(svgFilename, [svgFilename, nailSequence, layout, width = img.width, height = img.height, threadThickness, paperWidth, paperHeight]() {
+                return generateSVG(svgFilename, nailSequence, layout, width, height, threadThickness, paperWidth, paperHeight);
+            });
+        
+            if (writePreview) {
+                writer.submit(previewFilename, [previewFilename, preview = result.preview, width = img.width, height = img.height]() {
+                    if (!writePreviewImage(previewFilename, preview, width, height, 1)) {
+                        return false;
+                    }
+                    std::cout << "[+] Preview saved to: " << previewFilename << std::endl;
+                    return true;
+                });
+                writer.submit(metricsFilename, [metricsFilename, metrics, numStrings = (int)nailSequence.size(), threadOpacity]() {
+                    return writeMetricsFile(metricsFilename, metrics, numStrings, threadOpacity);
+                });
+            }
+        
+            std::cout << std::endl;
+            std::cout << "=================== SUCCESS! ===================" << std::endl;
+            std::cout << "String art generation completed successfully!" << std::endl;
+            std::cout << "Total nail connections: " << nailSequence.size() << std::endl;
+            std::cout << std::endl;
+            std::cout << "Files created successfully! You can now:" << std::endl;
+            std::cout << "* Open the .txt file for step-by-step instructions" << std::endl;
+            std::cout << "* View the .svg file in a web browser for visual reference" << std::endl;
+            std::cout << "* Use OPAQUE BLACK threads to create your physical string art!" << std::endl;
+        }
+    }
+    
+    // Wait for the last image's files before reporting
+    bool outputOk = writer.finish();
+    std::cout << "Output: " << writer.filesWritten() << " files written (fsync: " << OutputWriter::policyName(fsyncPolicy) << ")" << std::endl;
+    if (!outputOk) {
+        std::cout << "Error: Could not write:" << std::endl;
+        for (const std::string& filename : writer.failures()) {
+            std::cout << "  " << filename << std::endl;
+        }
+    }
+    
+    // Golden files are looked up by output file name, so a trusted run's outputs can be copied in as they are
+    int mismatches = 0;
+    if (!verifyDir.empty()) {
+        for (const std::string& filename : verifyFiles) {
+            std::string goldenFilename = (std::filesystem::path(verifyDir) / std::filesystem::path(filename).filename()).string();
+            std::string detail;
+            if (!matchesGolden(filename, goldenFilename, detail)) {
+                std::cout << "Verify: MISMATCH " << filename << " (" << detail << ")" << std::endl;
+                mismatches++;
+            }
+        }
+        std::cout << "Verify: " << verifyFiles.size() - mismatches << " of " << verifyFiles.size()
+                  << " files match " << verifyDir << std::endl;
+    }
+    if (slowImages > 0) {
+        std::cout << "Error: " << slowImages << " image(s) over the " << maxSeconds << "s limit" << std::endl;
     }
     
-    return 0;
+    return (outputOk && failedImages == 0 && mismatches == 0 && slowImages == 0) ? 0 : 1;
 }
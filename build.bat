@@ -1,4 +1,5 @@
 @echo off
+REM Usage: build.bat [test]   - "test" also builds and runs the regression tests (tests\regression_tests.cpp)
 echo ================== String Art Generator Build ==================
 echo Building with STATIC linking (required for Windows)...
 echo.
@@ -10,7 +11,7 @@ if exist String_Art.exe (
 )
 
 echo Compiling all source files with static linking...
-g++ -std=c++17 -static-libgcc -static-libstdc++ -O2 -o String_Art.exe String_Art.cpp image_processing.cpp string_art_generator.cpp svg_generator.cpp
+g++ -std=c++17 -static-libgcc -static-libstdc++ -O2 -o String_Art.exe String_Art.cpp image_processing.cpp string_art_generator.cpp svg_generator.cpp reconstruction.cpp thread_pool.cpp sequence_optimizer.cpp nail_layout.cpp chord_table.cpp coverage_grid.cpp live_preview.cpp output_writer.cpp string_art_api.cpp lazy_selection.cpp palette.cpp job_server.cpp result_cache.cpp sweep.cpp roi.cpp
 
 REM Check if build was successful
 if exist String_Art.exe (
@@ -33,3 +34,18 @@ if exist String_Art.exe (
 echo Build completed at %date% %time%
 echo.
 
+if /i not "%~1"=="test" goto :eof
+
+echo ================== Regression Tests ==================
+g++ -std=c++17 -static-libgcc -static-libstdc++ -O2 -o tests\regression_tests.exe tests\regression_tests.cpp
+if errorlevel 1 (
+    echo Regression test driver failed to build
+    exit /b 1
+)
+tests\regression_tests.exe --exe String_Art.exe
+if errorlevel 1 (
+    echo.
+    echo =================== REGRESSION TESTS FAILED! ===================
+    exit /b 1
+)
+
@@ -0,0 +1,636 @@
+#include "chord_table.h"
+#include "thread_pool.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'S', 'A', 'C', 'H', 'O', 'R', 'D', '2'};
+const uint32_t CACHE_VERSION = 2;
+
+// On-disk layout: header, chordCount chord records, sampleCount sample records, padding to 8 bytes,
+// wordCount step-bit words, sampleWordCount sample words
+struct ChordCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t nailCount;
+    uint64_t layoutFingerprint;
+    uint64_t chordCount;
+    uint64_t wordCount;
+    uint64_t sampleCount;
+    uint64_t sampleWordCount;
+};
+
+static_assert(sizeof(ChordRecord) == 20, "ChordRecord is stored on disk as-is");
+static_assert(sizeof(SampleRecord) == 28, "SampleRecord is stored on disk as-is");
+static_assert(sizeof(ChordCacheHeader) == 64, "ChordCacheHeader is stored on disk as-is");
+
+size_t bitsOffset(size_t chordCount, size_t sampleCount) {
+    size_t end = sizeof(ChordCacheHeader) + chordCount * sizeof(ChordRecord) + sampleCount * sizeof(SampleRecord);
+    return (end + 7) & ~(size_t)7;
+}
+
+int clampCoordinate(double value, int limit) {
+    return std::max(0, std::min(limit - 1, (int)std::lround(value)));
+}
+
+int countBits(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+size_t wordsFor(size_t items, size_t perWord) {
+    return (items + perWord - 1) / perWord;
+}
+
+// Packs sampler paths into records and words
+class SamplePacker {
+public:
+    SamplePacker(int width, std::vector<uint64_t>& words) : m_width(width), m_words(words) {}
+
+    SampleRecord pack(const std::vector<std::pair<int, int>>& samples) {
+        SampleRecord record = {0, 0, (uint32_t)samples.size(), 1, m_width, (uint32_t)m_words.size(), SampleRecord::NO_REVERSE};
+        if (samples.empty()) return record;
+
+        const std::pair<int, int>& first = samples.front();
+        const std::pair<int, int>& last = samples.back();
+        int sx = last.first >= first.first ? 1 : -1;
+        int sy = last.second >= first.second ? 1 : -1;
+        record.startPixel = (uint32_t)(first.second * m_width + first.first);
+        record.endPixel = (uint32_t)(last.second * m_width + last.first);
+        record.xDelta = sx;
+        record.yDelta = sy * m_width;
+
+        bool unitSteps = true;
+        for (size_t i = 1; i < samples.size() && unitSteps; i++) {
+            int stepX = samples[i].first - samples[i - 1].first;
+            int stepY = samples[i].second - samples[i - 1].second;
+            unitSteps = (stepX == 0 || stepX == sx) && (stepY == 0 || stepY == sy);
+        }
+
+        if (!unitSteps) {
+            // A chord of a few pixels, where one sample can skip a pixel: keep the indices
+            record.xDelta = 0;
+            m_words.resize(m_words.size() + wordsFor(samples.size(), 2), 0);
+            uint64_t* words = m_words.data() + record.wordOffset;
+            for (size_t i = 0; i < samples.size(); i++) {
+                uint64_t idx = (uint64_t)(samples[i].second * m_width + samples[i].first);
+                words[i >> 1] |= idx << (32 * (i & 1));
+            }
+            return record;
+        }
+
+        // Step i (sample i to i + 1) is bits 2i (x advances) and 2i + 1 (y advances)
+        m_words.resize(m_words.size() + wordsFor(samples.size(), 32), 0);
+        uint64_t* words = m_words.data() + record.wordOffset;
+        for (size_t i = 0; i + 1 < samples.size(); i++) {
+            uint64_t step = (samples[i + 1].first != samples[i].first ? 1 : 0) | (samples[i + 1].second != samples[i].second ? 2 : 0);
+            words[i >> 5] |= step << (2 * (i & 31));
+        }
+        return record;
+    }
+
+private:
+    int m_width;
+    std::vector<uint64_t>& m_words;
+};
+
+// The sample paths from one nail to every higher-numbered nail along one path; word offsets and
+// reverse indices are local until packSamplePaths joins the runs
+struct SampleRun {
+    std::vector<SampleRecord> records;
+    std::vector<SampleRecord> reverses;
+    std::vector<uint64_t> words;
+};
+
+void packSampleRun(const std::vector<std::pair<double, double>>& positions, int width, int height,
+                   ChordTable::SamplePath path, int a, SampleRun& run) {
+    int nailCount = (int)positions.size();
+    SamplePacker packer(width, run.words);
+    std::vector<std::pair<int, int>> samples;
+    run.records.reserve(nailCount - 1 - a);
+
+    for (int b = a + 1; b < nailCount; b++) {
+        samples.clear();
+        ChordTable::traceSamples(positions[a], positions[b], path, width, height,
+                                 [&](int x, int y) { samples.push_back({x, y}); });
+        SampleRecord record = packer.pack(samples);
+
+        // The reverse direction usually gives the same samples backwards; only a mismatch gets a record
+        size_t remaining = samples.size();
+        bool mirrored = true;
+        ChordTable::traceSamples(positions[b], positions[a], path, width, height, [&](int x, int y) {
+            mirrored = mirrored && remaining > 0 && samples[remaining - 1] == std::make_pair(x, y);
+            if (remaining > 0) remaining--;
+        });
+        if (!mirrored || remaining != 0) {
+            record.reverse = (uint32_t)run.reverses.size();
+            samples.clear();
+            ChordTable::traceSamples(positions[b], positions[a], path, width, height,
+                                     [&](int x, int y) { samples.push_back({x, y}); });
+            run.reverses.push_back(packer.pack(samples));
+        }
+        run.records.push_back(record);
+    }
+}
+
+// Sampler paths of every chord, both paths, both directions: the records from the lower-numbered
+// nail in pairIndex order per path, then a record for each reverse direction the sampler does not
+// give as the same samples backwards. Runs per (path, nail) are traced on the thread pool.
+void packSamplePaths(const std::vector<std::pair<double, double>>& positions, int width, int height,
+                     std::vector<SampleRecord>& records, std::vector<uint64_t>& words) {
+    int nailCount = (int)positions.size();
+    size_t chordCount = (size_t)nailCount * (nailCount - 1) / 2;
+    std::vector<SampleRun> runs(2 * (size_t)nailCount);
+
+    {
+        ThreadPool pool;
+        for (int path = ChordTable::SCORE_SAMPLES; path <= ChordTable::MARK_SAMPLES; path++) {
+            for (int a = 0; a < nailCount; a++) {
+                // Each task writes only its own run
+                pool.submit([&, path, a]() {
+                    packSampleRun(positions, width, height, (ChordTable::SamplePath)path, a, runs[path * nailCount + a]);
+                });
+            }
+        }
+        pool.waitAll();
+    }
+
+    size_t totalWords = 0, reverseCount = 0;
+    for (const SampleRun& run : runs) {
+        totalWords += run.words.size();
+        reverseCount += run.reverses.size();
+    }
+    records.clear();
+    records.reserve(2 * chordCount + reverseCount);
+    words.clear();
+    words.reserve(totalWords);
+
+    // Words stay in trace order; reverse records follow every forward record in the same run order
+    std::vector<SampleRecord> reverses;
+    reverses.reserve(reverseCount);
+    for (const SampleRun& run : runs) {
+        uint32_t wordBase = (uint32_t)words.size();
+        uint32_t reverseBase = (uint32_t)(2 * chordCount + reverses.size());
+        for (SampleRecord record : run.records) {
+            record.wordOffset += wordBase;
+            if (record.reverse != SampleRecord::NO_REVERSE) record.reverse += reverseBase;
+            records.push_back(record);
+        }
+        for (SampleRecord reverse : run.reverses) {
+            reverse.wordOffset += wordBase;
+            reverses.push_back(reverse);
+        }
+        words.insert(words.end(), run.words.begin(), run.words.end());
+    }
+    records.insert(records.end(), reverses.begin(), reverses.end());
+}
+
+// Upper bound on the sample words of one direction: every sample in bounds, unit steps
+size_t estimateSampleWords(const std::pair<double, double>& from, const std::pair<double, double>& to,
+                           ChordTable::SamplePath path) {
+    double dx = to.first - from.first, dy = to.second - from.second;
+    double length = std::sqrt(dx*dx + dy*dy);
+    if (length < 1.0) return 0;
+    size_t samples = (size_t)std::max(2, (int)(length * ChordTable::samplesPerUnit(path)));
+    return samples <= 4 ? wordsFor(samples, 2) : wordsFor(samples, 32);
+}
+
+} // namespace
+
+ChordTable::ChordTable()
+    : m_width(0), m_height(0), m_nailCount(0), m_layoutFingerprint(0),
+      m_records(nullptr), m_bits(nullptr), m_chordCount(0), m_wordCount(0),
+      m_samples(nullptr), m_sampleWords(nullptr), m_sampleCount(0), m_sampleWordCount(0),
+      m_mapping(nullptr), m_mappingSize(0)
+#ifdef _WIN32
+      , m_fileHandle(nullptr), m_mapHandle(nullptr)
+#endif
+{}
+
+ChordTable::~ChordTable() {
+    release();
+}
+
+void ChordTable::release() {
+    if (m_mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_mapping);
+        CloseHandle(m_mapHandle);
+        CloseHandle(m_fileHandle);
+        m_mapHandle = nullptr;
+        m_fileHandle = nullptr;
+#else
+        munmap(m_mapping, m_mappingSize);
+#endif
+        m_mapping = nullptr;
+        m_mappingSize = 0;
+    }
+    m_ownedRecords.clear();
+    m_ownedBits.clear();
+    m_records = nullptr;
+    m_bits = nullptr;
+    m_chordCount = 0;
+    m_wordCount = 0;
+    m_ownedSamples.clear();
+    m_ownedSampleWords.clear();
+    m_samples = nullptr;
+    m_sampleWords = nullptr;
+    m_sampleCount = 0;
+    m_sampleWordCount = 0;
+    m_nailPixels.clear();
+    m_nailPositions.clear();
+}
+
+void ChordTable::setKey(const NailLayout& layout, int width, int height) {
+    m_width = width;
+    m_height = height;
+    m_nailCount = layout.size();
+    m_layoutFingerprint = layout.fingerprint();
+
+    m_nailPixels.clear();
+    for (const auto& nail : layout.positions()) {
+        m_nailPixels.push_back({clampCoordinate(nail.first, width), clampCoordinate(nail.second, height)});
+    }
+    m_nailPositions = layout.positions();
+}
+
+size_t ChordTable::estimateBytes(const NailLayout& layout, int width, int height) {
+    std::vector<std::pair<int, int>> pixels;
+    for (const auto& nail : layout.positions()) {
+        pixels.push_back({clampCoordinate(nail.first, width), clampCoordinate(nail.second, height)});
+    }
+
+    size_t words = 1;  // trailing guard word
+    for (size_t a = 0; a < pixels.size(); a++) {
+        for (size_t b = a + 1; b < pixels.size(); b++) {
+            int major = std::max(std::abs(pixels[b].first - pixels[a].first), std::abs(pixels[b].second - pixels[a].second));
+            words += (major + 63) / 64;
+        }
+    }
+    size_t chords = pixels.size() * (pixels.size() - 1) / 2;
+
+    // Sample records assume every reverse direction is the same samples backwards, as nearly all are
+    const auto& positions = layout.positions();
+    size_t sampleWords = 0;
+    for (size_t a = 0; a < positions.size(); a++) {
+        for (size_t b = a + 1; b < positions.size(); b++) {
+            sampleWords += estimateSampleWords(positions[a], positions[b], SCORE_SAMPLES);
+            sampleWords += estimateSampleWords(positions[a], positions[b], MARK_SAMPLES);
+        }
+    }
+    return chords * sizeof(ChordRecord) + words * sizeof(uint64_t) + 2 * chords * sizeof(SampleRecord) + sampleWords * sizeof(uint64_t);
+}
+
+void ChordTable::build(const NailLayout& layout, int width, int height, size_t maxBytes) {
+    release();
+    setKey(layout, width, height);
+
+    if (maxBytes > 0 && estimateBytes(layout, width, height) > maxBytes) {
+        // On-demand mode: forEachPixel walks the line from m_nailPixels
+        return;
+    }
+
+    m_chordCount = (size_t)m_nailCount * (m_nailCount - 1) / 2;
+    m_ownedRecords.reserve(m_chordCount);
+
+    for (int a = 0; a < m_nailCount; a++) {
+        int ax = m_nailPixels[a].first;
+        int ay = m_nailPixels[a].second;
+
+        for (int b = a + 1; b < m_nailCount; b++) {
+            int bx = m_nailPixels[b].first;
+            int by = m_nailPixels[b].second;
+
+            int dx = std::abs(bx - ax), dy = std::abs(by - ay);
+            int sx = bx >= ax ? 1 : -1, sy = by >= ay ? 1 : -1;
+            bool steep = dy > dx;
+            int major = steep ? dy : dx;
+            int minor = steep ? dx : dy;
+
+            ChordRecord chord;
+            chord.startPixel = (uint32_t)(ay * width + ax);
+            chord.pixelCount = (uint32_t)(major + 1);
+            chord.majorDelta = steep ? sy * width : sx;
+            chord.minorDelta = steep ? sx : sy * width;
+            chord.wordOffset = (uint32_t)m_ownedBits.size();
+            m_ownedRecords.push_back(chord);
+
+            // Bresenham decision per step; bit i set = minor axis advances between pixels i and i+1
+            m_ownedBits.resize(m_ownedBits.size() + (major + 63) / 64, 0);
+            uint64_t* bits = &m_ownedBits[chord.wordOffset];
+            int decision = 2 * minor - major;
+            for (int i = 0; i < major; i++) {
+                if (decision > 0) {
+                    bits[i >> 6] |= 1ULL << (i & 63);
+                    decision -= 2 * major;
+                }
+                decision += 2 * minor;
+            }
+        }
+    }
+
+    // forEachPixel reads one word past a chord's last step when the count is a multiple of 64
+    m_ownedBits.push_back(0);
+
+    m_records = m_ownedRecords.data();
+    m_bits = m_ownedBits.data();
+    m_wordCount = m_ownedBits.size();
+
+    packSamplePaths(m_nailPositions, width, height, m_ownedSamples, m_ownedSampleWords);
+    m_samples = m_ownedSamples.data();
+    m_sampleWords = m_ownedSampleWords.data();
+    m_sampleCount = m_ownedSamples.size();
+    m_sampleWordCount = m_ownedSampleWords.size();
+}
+
+bool ChordTable::load(const std::string& filename, const NailLayout& layout, int width, int height) {
+    release();
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(ChordCacheHeader)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapHandle) {
+        CloseHandle(file);
+        return false;
+    }
+
+    mapping = MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!mapping) {
+        CloseHandle(mapHandle);
+        CloseHandle(file);
+        return false;
+    }
+    mappingSize = (size_t)fileSize.QuadPart;
+    m_fileHandle = file;
+    m_mapHandle = mapHandle;
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(ChordCacheHeader)) {
+        close(fd);
+        return false;
+    }
+
+    // Shared read-only mapping: every process on the same board maps the same page-cache pages
+    mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+    mappingSize = (size_t)info.st_size;
+#endif
+
+    m_mapping = mapping;
+    m_mappingSize = mappingSize;
+
+    ChordCacheHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+
+    size_t nailCount = header.nailCount;
+    bool valid = std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+              && header.version == CACHE_VERSION
+              && header.width == (uint32_t)width && header.height == (uint32_t)height
+              && header.nailCount == (uint32_t)layout.size()
+              && header.layoutFingerprint == layout.fingerprint()
+              && header.chordCount == nailCount * (nailCount - 1) / 2
+              && header.sampleCount >= 2 * header.chordCount && header.sampleCount <= 4 * header.chordCount
+              && header.wordCount <= mappingSize / sizeof(uint64_t) && header.sampleWordCount <= mappingSize / sizeof(uint64_t)
+              && bitsOffset(header.chordCount, header.sampleCount) + (header.wordCount + header.sampleWordCount) * sizeof(uint64_t) == mappingSize;
+    if (!valid) {
+        release();
+        return false;
+    }
+
+    setKey(layout, width, height);
+    m_chordCount = header.chordCount;
+    m_wordCount = header.wordCount;
+    m_sampleCount = header.sampleCount;
+    m_sampleWordCount = header.sampleWordCount;
+
+    const char* base = static_cast<const char*>(mapping);
+    m_records = reinterpret_cast<const ChordRecord*>(base + sizeof(ChordCacheHeader));
+    m_samples = reinterpret_cast<const SampleRecord*>(base + sizeof(ChordCacheHeader) + m_chordCount * sizeof(ChordRecord));
+    m_bits = reinterpret_cast<const uint64_t*>(base + bitsOffset(m_chordCount, m_sampleCount));
+    m_sampleWords = m_bits + m_wordCount;
+
+    // The header matching is not enough: the walks trust every record, so a damaged or foreign
+    // file must not get as far as a solver
+    if (!validate()) {
+        std::cout << "Chord cache: Ignoring damaged cache file " << filename << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool ChordTable::validate() const {
+    const uint64_t pixels = (uint64_t)m_width * m_height;
+
+    // Bresenham chords are fully determined by the nail pixels except for their step bits: those
+    // must lie inside the file and advance the minor axis exactly as far as the far nail, which
+    // keeps every pixel of the walk between the two nails
+    for (int a = 0; a < m_nailCount; a++) {
+        int ax = m_nailPixels[a].first;
+        int ay = m_nailPixels[a].second;
+        for (int b = a + 1; b < m_nailCount; b++) {
+            const ChordRecord& chord = m_records[pairIndex(a, b)];
+            int bx = m_nailPixels[b].first;
+            int by = m_nailPixels[b].second;
+            int dx = std::abs(bx - ax), dy = std::abs(by - ay);
+            int sx = bx >= ax ? 1 : -1, sy = by >= ay ? 1 : -1;
+            bool steep = dy > dx;
+            int major = steep ? dy : dx;
+            int minor = steep ? dx : dy;
+
+            if (chord.startPixel != (uint32_t)(ay * m_width + ax) || chord.pixelCount != (uint32_t)(major + 1)
+                || chord.majorDelta != (steep ? sy * m_width : sx) || chord.minorDelta != (steep ? sx : sy * m_width)
+                || (uint64_t)chord.wordOffset + wordsFor(chord.pixelCount, 64) > m_wordCount) {
+                return false;
+            }
+
+            int advances = 0;
+            for (int i = 0; i < major; i += 64) {
+                uint64_t word = m_bits[chord.wordOffset + i / 64];
+                if (major - i < 64) word &= (1ULL << (major - i)) - 1;
+                advances += countBits(word);
+            }
+            if (advances != minor) return false;
+        }
+    }
+
+    // Sampler paths: in-file words, a start pixel in the image, and an end pixel that the steps
+    // really reach; x and y only ever move towards the end, so the whole walk stays in the image
+    for (size_t r = 0; r < m_sampleCount; r++) {
+        const SampleRecord& record = m_samples[r];
+        uint32_t count = record.sampleCount;
+
+        if (r < 2 * m_chordCount) {
+            if (record.reverse != SampleRecord::NO_REVERSE && (record.reverse < 2 * m_chordCount || record.reverse >= m_sampleCount)) {
+                return false;
+            }
+        } else if (record.reverse != SampleRecord::NO_REVERSE) {
+            return false;
+        }
+
+        if (record.xDelta == 0) {
+            if ((uint64_t)record.wordOffset + wordsFor(count, 2) > m_sampleWordCount) return false;
+            for (uint32_t i = 0; i < count; i++) {
+                if ((m_sampleWords[record.wordOffset + (i >> 1)] >> (32 * (i & 1)) & 0xFFFFFFFFu) >= pixels) return false;
+            }
+            continue;
+        }
+
+        if ((record.xDelta != 1 && record.xDelta != -1) || (record.yDelta != m_width && record.yDelta != -m_width)
+            || (uint64_t)record.wordOffset + wordsFor(count, 32) > m_sampleWordCount) {
+            return false;
+        }
+        if (count == 0) continue;
+        if (record.startPixel >= pixels || record.endPixel >= pixels) return false;
+
+        int64_t xSteps = 0, ySteps = 0;
+        for (uint32_t i = 0; i + 1 < count; i += 32) {
+            uint64_t word = m_sampleWords[record.wordOffset + i / 32];
+            uint32_t steps = count - 1 - i;
+            if (steps < 32) word &= (1ULL << (2 * steps)) - 1;
+            xSteps += countBits(word & 0x5555555555555555ULL);
+            ySteps += countBits(word & 0xAAAAAAAAAAAAAAAAULL);
+        }
+        int64_t endX = (int64_t)(record.startPixel % m_width) + (record.xDelta > 0 ? xSteps : -xSteps);
+        int64_t endY = (int64_t)(record.startPixel / m_width) + (record.yDelta > 0 ? ySteps : -ySteps);
+        if (endX < 0 || endX >= m_width || endY < 0 || endY >= m_height || (uint64_t)(endY * m_width + endX) != record.endPixel) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ChordTable::save(const std::string& filename) const {
+    if (!m_records) return false;
+
+    std::error_code ec;
+    std::filesystem::path target(filename);
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+
+    // Unique temp name so concurrent writers of the same key cannot interleave
+    std::string tempName = filename + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(tempName, std::ios::binary);
+        if (!file.is_open()) {
+            std::cout << "Chord cache: Cannot write " << tempName << std::endl;
+            return false;
+        }
+
+        ChordCacheHeader header;
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = CACHE_VERSION;
+        header.width = (uint32_t)m_width;
+        header.height = (uint32_t)m_height;
+        header.nailCount = (uint32_t)m_nailCount;
+        header.layoutFingerprint = m_layoutFingerprint;
+        header.chordCount = m_chordCount;
+        header.wordCount = m_wordCount;
+        header.sampleCount = m_sampleCount;
+        header.sampleWordCount = m_sampleWordCount;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_records), m_chordCount * sizeof(ChordRecord));
+        file.write(reinterpret_cast<const char*>(m_samples), m_sampleCount * sizeof(SampleRecord));
+
+        const char padding[8] = {0};
+        size_t recordsEnd = sizeof(ChordCacheHeader) + m_chordCount * sizeof(ChordRecord) + m_sampleCount * sizeof(SampleRecord);
+        file.write(padding, bitsOffset(m_chordCount, m_sampleCount) - recordsEnd);
+        file.write(reinterpret_cast<const char*>(m_bits), m_wordCount * sizeof(uint64_t));
+        file.write(reinterpret_cast<const char*>(m_sampleWords), m_sampleWordCount * sizeof(uint64_t));
+
+        if (!file.good()) {
+            file.close();
+            std::remove(tempName.c_str());
+            std::cout << "Chord cache: Write failed for " << tempName << std::endl;
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempName, target, ec);
+    if (ec) {
+        std::remove(tempName.c_str());
+        std::cout << "Chord cache: Cannot rename cache file to " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string ChordTable::cacheFilename(const std::string& cacheDir, const NailLayout& layout, int width, int height) {
+    char key[64];
+    std::snprintf(key, sizeof(key), "chords-%dx%d-n%d-%016llx.bin", width, height, layout.size(),
+                  (unsigned long long)layout.fingerprint());
+    return (std::filesystem::path(cacheDir) / key).string();
+}
+
+void ChordTable::loadOrBuild(const std::string& cacheDir, const NailLayout& layout, int width, int height, size_t maxBytes) {
+    if (!cacheDir.empty() && (maxBytes == 0 || estimateBytes(layout, width, height) <= maxBytes)) {
+        std::string filename = cacheFilename(cacheDir, layout, width, height);
+        if (load(filename, layout, width, height)) {
+            return;
+        }
+        build(layout, width, height);
+        save(filename);
+        return;
+    }
+    build(layout, width, height, maxBytes);
+}
+
+bool ChordTable::matches(const NailLayout& layout, int width, int height) const {
+    return !m_nailPixels.empty() && m_width == width && m_height == height && m_nailCount == layout.size()
+        && m_layoutFingerprint == layout.fingerprint();
+}
+
+bool ChordTable::isMapped() const {
+    return m_mapping != nullptr;
+}
+
+bool ChordTable::isPacked() const {
+    return m_records != nullptr;
+}
+
+int ChordTable::nailCount() const {
+    return m_nailCount;
+}
+
+size_t ChordTable::memoryBytes() const {
+    return m_chordCount * sizeof(ChordRecord) + m_wordCount * sizeof(uint64_t)
+         + m_sampleCount * sizeof(SampleRecord) + m_sampleWordCount * sizeof(uint64_t)
+         + m_nailPixels.size() * (sizeof(std::pair<int, int>) + sizeof(std::pair<double, double>));
+}
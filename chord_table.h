@@ -0,0 +1,301 @@
+#pragma once
+
+#include "nail_layout.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+// Pixel footprint of one nail-to-nail chord. The path is a Bresenham line: after the first pixel,
+// every step moves one pixel along the major axis and, if its bit is set, one along the minor axis.
+// That packs a chord into one bit per pixel plus this fixed header.
+struct ChordRecord {
+    uint32_t startPixel;   // y * width + x of the lower-numbered nail
+    uint32_t pixelCount;
+    int32_t majorDelta;    // Index step along the major axis (+-1 or +-width)
+    int32_t minorDelta;    // Extra index step when the minor axis advances
+    uint32_t wordOffset;   // First 64-bit word of this chord's step bits
+};
+
+// A chord as the greedy heuristic's line sampler sees it, in one direction: samples spaced evenly
+// from one nail to the other and truncated to pixels, duplicates included, in sampling order.
+// Between consecutive samples x and y each move at most one pixel (except on chords of a few
+// pixels), so a step packs into two bits: x advances, y advances.
+struct SampleRecord {
+    static const uint32_t NO_REVERSE = 0xFFFFFFFFu;
+
+    uint32_t startPixel;   // First sample inside the image
+    uint32_t endPixel;     // Last sample inside the image
+    uint32_t sampleCount;  // Samples inside the image
+    int32_t xDelta;        // +-1, or 0 when the words hold the samples' pixel indices, two per word
+    int32_t yDelta;        // +-width
+    uint32_t wordOffset;   // First 64-bit word of the steps (or indices)
+    uint32_t reverse;      // Record sampled from the other nail, or NO_REVERSE: the same samples backwards
+};
+
+// Read-only table of every chord's footprint for one (layout, image size). Built in memory or
+// memory-mapped from a cache file, so repeated jobs on the same board skip all geometry work and
+// concurrent processes share one physical copy. When the packed table would exceed a memory
+// budget, only the nails' pixel coordinates are kept and chords are traced on demand; both modes
+// visit exactly the same pixels in the same order.
+//
+// Two footprints are kept per chord. forEachPixel is the Bresenham line, one visit per pixel,
+// which the integer and physical models use. forEachSample replays the original sampler of the
+// per-pixel heuristic (1.2 samples per unit of length for scoring, 1.5 for laying a string down):
+// pixels hit by several samples are visited that many times, and the path depends on which nail
+// it starts from, so the heuristic's scores and coverage are exactly those of the sampler.
+class ChordTable {
+public:
+    enum SamplePath { SCORE_SAMPLES = 0, MARK_SAMPLES = 1 };
+
+    ChordTable();
+    ~ChordTable();
+
+    ChordTable(const ChordTable&) = delete;
+    ChordTable& operator=(const ChordTable&) = delete;
+
+    // Rasterize every chord of the layout, or fall back to on-demand tracing when the packed
+    // table would need more than maxBytes (0 = no limit)
+    void build(const NailLayout& layout, int width, int height, size_t maxBytes = 0);
+
+    // Map a cache file; fails (returning false) if it is missing, was built for a different key, or
+    // holds a chord that would leave the image
+    bool load(const std::string& filename, const NailLayout& layout, int width, int height);
+
+    // Write to a temp file and rename, so readers never map a half-written cache
+    bool save(const std::string& filename) const;
+
+    // Load from cacheDir if present, otherwise build and store there (empty dir = build only)
+    void loadOrBuild(const std::string& cacheDir, const NailLayout& layout, int width, int height, size_t maxBytes = 0);
+
+    // Exact size of the packed table for a layout, without storing it
+    static size_t estimateBytes(const NailLayout& layout, int width, int height);
+
+    // Cache file name encoding the key: image size, nail count and layout fingerprint
+    static std::string cacheFilename(const std::string& cacheDir, const NailLayout& layout, int width, int height);
+
+    bool matches(const NailLayout& layout, int width, int height) const;
+    bool isMapped() const;
+    bool isPacked() const;      // false = chords traced on demand
+    int nailCount() const;
+    size_t memoryBytes() const;
+
+    int pixelCount(int nailA, int nailB) const;
+
+    // Rounded pixel (x, y) a nail's chords start from
+    const std::pair<int, int>& nailPixel(int nail) const;
+
+    // Visit every pixel index on the chord between two nails (order of the nails does not matter)
+    template <typename Fn>
+    void forEachPixel(int nailA, int nailB, Fn fn) const;
+
+    // Visit the pixel index of every in-image sample from one nail to the other, in sampling order
+    template <typename Fn>
+    void forEachSample(int fromNail, int toNail, SamplePath path, Fn fn) const;
+
+    static double samplesPerUnit(SamplePath path);
+
+    // The sampler itself: max(2, length * samplesPerUnit) points from one position to the other,
+    // fn(x, y) for those inside the image; nothing for a chord shorter than a pixel
+    template <typename Fn>
+    static void traceSamples(const std::pair<double, double>& from, const std::pair<double, double>& to,
+                             SamplePath path, int width, int height, Fn fn);
+
+private:
+    size_t pairIndex(int nailA, int nailB) const;
+    void release();
+    void setKey(const NailLayout& layout, int width, int height);
+    bool validate() const;
+
+    int m_width, m_height, m_nailCount;
+    uint64_t m_layoutFingerprint;
+
+    // Views into either the owned vectors or the mapped file
+    const ChordRecord* m_records;
+    const uint64_t* m_bits;
+    size_t m_chordCount, m_wordCount;
+
+    std::vector<ChordRecord> m_ownedRecords;
+    std::vector<uint64_t> m_ownedBits;
+
+    // Sampler paths: records [path * chordCount + pairIndex] start from the lower-numbered nail;
+    // reverse records the sampler gives differently from the other nail follow them
+    const SampleRecord* m_samples;
+    const uint64_t* m_sampleWords;
+    size_t m_sampleCount, m_sampleWordCount;
+
+    std::vector<SampleRecord> m_ownedSamples;
+    std::vector<uint64_t> m_ownedSampleWords;
+
+    // Rounded nail pixels (x, y) and exact positions, kept in both modes; the only state in
+    // on-demand mode
+    std::vector<std::pair<int, int>> m_nailPixels;
+    std::vector<std::pair<double, double>> m_nailPositions;
+
+    void* m_mapping;       // Start of the mapped file (null when built in memory)
+    size_t m_mappingSize;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mapHandle;
+#endif
+};
+
+inline size_t ChordTable::pairIndex(int nailA, int nailB) const {
+    int a = nailA < nailB ? nailA : nailB;
+    int b = nailA < nailB ? nailB : nailA;
+    // Row-major upper triangle without the diagonal
+    return (size_t)a * (2 * m_nailCount - a - 1) / 2 + (b - a - 1);
+}
+
+inline int ChordTable::pixelCount(int nailA, int nailB) const {
+    if (!m_records) {
+        int dx = std::abs(m_nailPixels[nailB].first - m_nailPixels[nailA].first);
+        int dy = std::abs(m_nailPixels[nailB].second - m_nailPixels[nailA].second);
+        return std::max(dx, dy) + 1;
+    }
+    return (int)m_records[pairIndex(nailA, nailB)].pixelCount;
+}
+
+inline const std::pair<int, int>& ChordTable::nailPixel(int nail) const {
+    return m_nailPixels[nail];
+}
+
+template <typename Fn>
+inline void ChordTable::forEachPixel(int nailA, int nailB, Fn fn) const {
+    if (!m_records) {
+        // Same Bresenham walk as build(), always from the lower-numbered nail
+        const std::pair<int, int>& from = m_nailPixels[nailA < nailB ? nailA : nailB];
+        const std::pair<int, int>& to = m_nailPixels[nailA < nailB ? nailB : nailA];
+        int dx = to.first - from.first, dy = to.second - from.second;
+        int sx = dx >= 0 ? 1 : -1, sy = dy >= 0 ? 1 : -1;
+        dx *= sx;
+        dy *= sy;
+        bool steep = dy > dx;
+        int major = steep ? dy : dx;
+        int minor = steep ? dx : dy;
+        int32_t majorDelta = steep ? sy * m_width : sx;
+        int32_t minorDelta = steep ? sx : sy * m_width;
+
+        int32_t idx = from.second * m_width + from.first;
+        int decision = 2 * minor - major;
+        for (int i = 0; i <= major; i++) {
+            fn(idx);
+            idx += majorDelta;
+            if (decision > 0) {
+                idx += minorDelta;
+                decision -= 2 * major;
+            }
+            decision += 2 * minor;
+        }
+        return;
+    }
+
+    const ChordRecord& chord = m_records[pairIndex(nailA, nailB)];
+    const uint64_t* bits = m_bits + chord.wordOffset;
+
+    int32_t idx = (int32_t)chord.startPixel;
+    int32_t majorDelta = chord.majorDelta;
+    int32_t minorDelta = chord.minorDelta;
+    uint32_t count = chord.pixelCount;
+
+    // One word load per 64 pixels; the step bits are then shifted out one at a time
+    for (uint32_t i = 0; i < count; bits++) {
+        uint64_t word = *bits;
+        uint32_t end = count - i < 64 ? count : i + 64;
+        for (; i < end; i++) {
+            fn(idx);
+            idx += majorDelta + (minorDelta & -(int32_t)(word & 1));
+            word >>= 1;
+        }
+    }
+}
+
+inline double ChordTable::samplesPerUnit(SamplePath path) {
+    return path == SCORE_SAMPLES ? 1.2 : 1.5;
+}
+
+template <typename Fn>
+inline void ChordTable::traceSamples(const std::pair<double, double>& from, const std::pair<double, double>& to,
+                                     SamplePath path, int width, int height, Fn fn) {
+    double x1 = from.first, y1 = from.second;
+    double dx = to.first - x1;
+    double dy = to.second - y1;
+    double length = std::sqrt(dx*dx + dy*dy);
+
+    if (length < 1.0) return;
+
+    int numSamples = (int)(length * samplesPerUnit(path));
+    if (numSamples < 2) numSamples = 2;
+
+    for (int i = 0; i < numSamples; i++) {
+        double t = (double)i / (numSamples - 1);
+        int x = (int)(x1 + t * dx);
+        int y = (int)(y1 + t * dy);
+
+        if (x >= 0 && x < width && y >= 0 && y < height) {
+            fn(x, y);
+        }
+    }
+}
+
+template <typename Fn>
+inline void ChordTable::forEachSample(int fromNail, int toNail, SamplePath path, Fn fn) const {
+    if (!m_samples) {
+        int width = m_width;
+        traceSamples(m_nailPositions[fromNail], m_nailPositions[toNail], path, m_width, m_height, [&](int x, int y) {
+            fn(y * width + x);
+        });
+        return;
+    }
+
+    const SampleRecord* record = &m_samples[(size_t)path * m_chordCount + pairIndex(fromNail, toNail)];
+    bool backwards = false;
+    if (fromNail > toNail) {
+        if (record->reverse != SampleRecord::NO_REVERSE) {
+            record = &m_samples[record->reverse];
+        } else {
+            backwards = true;
+        }
+    }
+
+    const uint64_t* words = m_sampleWords + record->wordOffset;
+    uint32_t count = record->sampleCount;
+
+    if (record->xDelta == 0) {
+        for (uint32_t k = 0; k < count; k++) {
+            uint32_t i = backwards ? count - 1 - k : k;
+            fn((int32_t)(uint32_t)(words[i >> 1] >> (32 * (i & 1))));
+        }
+        return;
+    }
+
+    int32_t xDelta = record->xDelta;
+    int32_t yDelta = record->yDelta;
+
+    if (!backwards) {
+        // One word load per 32 samples, as in forEachPixel
+        int32_t idx = (int32_t)record->startPixel;
+        for (uint32_t i = 0; i < count; words++) {
+            uint64_t word = *words;
+            uint32_t end = count - i < 32 ? count : i + 32;
+            for (; i < end; i++) {
+                fn(idx);
+                idx += (xDelta & -(int32_t)(word & 1)) + (yDelta & -(int32_t)((word >> 1) & 1));
+                word >>= 2;
+            }
+        }
+        return;
+    }
+
+    // From the last sample, undoing step i - 1 after visiting sample i
+    int32_t idx = (int32_t)record->endPixel;
+    for (uint32_t i = count; i-- > 0;) {
+        fn(idx);
+        if (i == 0) break;
+        uint64_t step = words[(i - 1) >> 5] >> (2 * ((i - 1) & 31));
+        idx -= (xDelta & -(int32_t)(step & 1)) + (yDelta & -(int32_t)((step >> 1) & 1));
+    }
+}
@@ -0,0 +1,295 @@
+#include "coverage_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+SupersampledCoverage::SupersampledCoverage(const NailLayout& layout, const std::vector<double>& darkness, int width, int height,
+                                           int factor, double threadWidth)
+    : m_width(width), m_height(height), m_factor(1), m_shift(0), m_opacity(1.0), m_residual(darkness) {
+    while (m_factor < factor && m_factor < 8) {
+        m_factor <<= 1;
+        m_shift++;
+    }
+
+    int fineWidth = width << m_shift;
+    int fineHeight = height << m_shift;
+    m_passes.assign((size_t)width * height << (2 * m_shift), 0);
+
+    // Fraction of one subpixel's width the thread blocks
+    m_opacity = std::max(0.01, std::min(1.0, threadWidth * m_factor));
+    m_transmittance[0] = 1.0;
+    for (int k = 1; k < 256; k++) {
+        m_transmittance[k] = m_transmittance[k - 1] * (1.0 - m_opacity);
+    }
+
+    // Nail centers on the subpixel grid
+    for (const auto& nail : layout.positions()) {
+        int fx = (int)std::lround(nail.first * m_factor + (m_factor - 1) / 2.0);
+        int fy = (int)std::lround(nail.second * m_factor + (m_factor - 1) / 2.0);
+        m_nailSubpixels.push_back({std::max(0, std::min(fineWidth - 1, fx)), std::max(0, std::min(fineHeight - 1, fy))});
+    }
+}
+
+int SupersampledCoverage::factorForThreadWidth(double threadWidth, int maxFactor) {
+    int factor = 1;
+    while (factor < maxFactor && threadWidth * factor < 0.75) {
+        factor <<= 1;
+    }
+    return factor;
+}
+
+inline size_t SupersampledCoverage::subpixelIndex(int pixel, int fx, int fy) const {
+    int mask = m_factor - 1;
+    return ((size_t)pixel << (2 * m_shift)) | ((fy & mask) << m_shift) | (fx & mask);
+}
+
+template <typename Fn>
+inline void SupersampledCoverage::traceChord(int nailA, int nailB, Fn fn) const {
+    const std::pair<int, int>& from = m_nailSubpixels[std::min(nailA, nailB)];
+    const std::pair<int, int>& to = m_nailSubpixels[std::max(nailA, nailB)];
+
+    int fx = from.first, fy = from.second;
+    int dx = std::abs(to.first - fx), dy = std::abs(to.second - fy);
+    int sx = to.first >= fx ? 1 : -1, sy = to.second >= fy ? 1 : -1;
+
+    if (dx >= dy) {
+        int decision = 2 * dy - dx;
+        for (int i = 0; i <= dx; i++) {
+            fn(fx, fy);
+            fx += sx;
+            if (decision > 0) {
+                fy += sy;
+                decision -= 2 * dx;
+            }
+            decision += 2 * dy;
+        }
+    } else {
+        int decision = 2 * dx - dy;
+        for (int i = 0; i <= dy; i++) {
+            fn(fx, fy);
+            fy += sy;
+            if (decision > 0) {
+                fx += sx;
+                decision -= 2 * dy;
+            }
+            decision += 2 * dx;
+        }
+    }
+}
+
+double SupersampledCoverage::scoreChord(int nailA, int nailB) const {
+    double total = 0.0;
+    int count = 0;
+
+    traceChord(nailA, nailB, [&](int fx, int fy) {
+        int pixel = (fy >> m_shift) * m_width + (fx >> m_shift);
+        total += m_residual[pixel] * m_transmittance[m_passes[subpixelIndex(pixel, fx, fy)]];
+        count++;
+    });
+
+    return count > 0 ? total / count : 0.0;
+}
+
+void SupersampledCoverage::markChord(int nailA, int nailB) {
+    double subpixelShare = 1.0 / (m_factor * m_factor);
+
+    traceChord(nailA, nailB, [&](int fx, int fy) {
+        int pixel = (fy >> m_shift) * m_width + (fx >> m_shift);
+        uint8_t& passes = m_passes[subpixelIndex(pixel, fx, fy)];
+        // Darkness this pass adds to the subpixel, spread over its pixel
+        m_residual[pixel] -= m_opacity * m_transmittance[passes] * subpixelShare;
+        if (passes < 255) passes++;
+    });
+}
+
+int SupersampledCoverage::factor() const {
+    return m_factor;
+}
+
+double SupersampledCoverage::subpixelOpacity() const {
+    return m_opacity;
+}
+
+size_t SupersampledCoverage::memoryBytes() const {
+    return m_passes.size() + m_residual.size() * sizeof(double);
+}
+
+namespace {
+
+// Exact floor(sqrt(value)) in integers only
+uint32_t isqrt64(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+// Largest penalty: the coverage factor never drops below 0.1
+const int32_t MAX_PENALTY = FixedPointCoverage::ONE - 410;
+
+}
+
+FixedPointCoverage::FixedPointCoverage(const ChordTable& chords, const std::vector<unsigned char>& gray, double contrastFactor,
+                                       const unsigned char* importance)
+    : m_chords(chords), m_darkness(gray.size()), m_penalty(gray.size(), 0), m_weighted(gray.size()), m_longestChord(1) {
+    // d * (1 + d * contrast) with d = (255 - gray) / 255, in Q12
+    int64_t contrast = (int64_t)std::lround(contrastFactor * ONE);
+    for (size_t i = 0; i < gray.size(); i++) {
+        int64_t d = 255 - gray[i];
+        int64_t darkness = d * (255 * ONE + d * contrast) / (255 * 255);
+        if (importance) {
+            darkness = darkness * importance[i] / 255;
+        }
+        m_darkness[i] = (uint16_t)darkness;
+        m_weighted[i] = (uint32_t)m_darkness[i] * ONE;
+    }
+
+    int nailCount = chords.nailCount();
+    for (int a = 0; a < nailCount; a++) {
+        for (int b = a + 1; b < nailCount; b++) {
+            m_longestChord = std::max(m_longestChord, chordLength(a, b));
+        }
+    }
+}
+
+int64_t FixedPointCoverage::scoreChord(int nailA, int nailB) const {
+    const uint32_t* weighted = m_weighted.data();
+    uint64_t total = 0;
+
+    m_chords.forEachPixel(nailA, nailB, [&](int idx) {
+        total += weighted[idx];
+    });
+
+    return (int64_t)(total / (uint64_t)m_chords.pixelCount(nailA, nailB));
+}
+
+void FixedPointCoverage::markChord(int nailA, int nailB, int32_t strength) {
+    int32_t length = chordLength(nailA, nailB);
+    if (length < 256) return;
+
+    // strength * 0.8 * 1.5 hits per unit of length spread over the chord's pixels, divided by 6
+    int64_t amount = (int64_t)strength * length / (5 * 256 * (int64_t)m_chords.pixelCount(nailA, nailB));
+
+    m_chords.forEachPixel(nailA, nailB, [&](int idx) {
+        int32_t penalty = std::min<int32_t>(MAX_PENALTY, (int32_t)(m_penalty[idx] + amount));
+        m_penalty[idx] = (uint16_t)penalty;
+        m_weighted[idx] = (uint32_t)m_darkness[idx] * (uint32_t)(ONE - penalty);
+    });
+}
+
+int32_t FixedPointCoverage::chordLength(int nailA, int nailB) const {
+    const std::pair<int, int>& a = m_chords.nailPixel(nailA);
+    const std::pair<int, int>& b = m_chords.nailPixel(nailB);
+    int64_t dx = b.first - a.first;
+    int64_t dy = b.second - a.second;
+    return (int32_t)isqrt64((uint64_t)(dx * dx + dy * dy) << 16);
+}
+
+int32_t FixedPointCoverage::longestChord() const {
+    return m_longestChord;
+}
+
+size_t FixedPointCoverage::memoryBytes() const {
+    return m_darkness.size() * (2 * sizeof(uint16_t) + sizeof(uint32_t));
+}
+
+double FixedPointCoverage::toDouble(int64_t score) {
+    // Exact: scores are far below 2^53
+    return std::ldexp((double)score, -SCORE_BITS);
+}
+
+ResidualCoverage::ResidualCoverage(const ChordTable& chords, const std::vector<double>& darkness, double threadWidth)
+    : m_chords(chords), m_residual(darkness.size()), m_threadDarkness(1) {
+    // Contrast-enhanced darkness stays below 3.0, so Q12 fits 16 bits
+    for (size_t i = 0; i < darkness.size(); i++) {
+        m_residual[i] = (uint16_t)std::max<long>(0, std::min<long>(UINT16_MAX, std::lround(darkness[i] * ONE)));
+    }
+    m_threadDarkness = (uint16_t)std::max<long>(1, std::lround(std::min(1.0, threadWidth) * ONE));
+}
+
+int64_t ResidualCoverage::scoreChord(int nailA, int nailB) const {
+    const uint16_t* residual = m_residual.data();
+    uint32_t total = 0;   // At most 2^16 per pixel and a few thousand pixels per chord
+
+    m_chords.forEachPixel(nailA, nailB, [&](int idx) {
+        total += residual[idx];
+    });
+
+    return ((int64_t)total << (FixedPointCoverage::SCORE_BITS - 12)) / m_chords.pixelCount(nailA, nailB);
+}
+
+void ResidualCoverage::markChord(int nailA, int nailB) {
+    uint16_t* residual = m_residual.data();
+    uint16_t amount = m_threadDarkness;
+
+    // Saturating subtract; compiles to a compare and conditional move
+    m_chords.forEachPixel(nailA, nailB, [&](int idx) {
+        uint16_t value = residual[idx];
+        residual[idx] = value > amount ? (uint16_t)(value - amount) : 0;
+    });
+}
+
+int32_t ResidualCoverage::threadDarkness() const {
+    return m_threadDarkness;
+}
+
+size_t ResidualCoverage::memoryBytes() const {
+    return m_residual.size() * sizeof(uint16_t);
+}
+
+JointColorCoverage::JointColorCoverage(const ChordTable& chords, const std::vector<const std::vector<unsigned char>*>& channels,
+                                       double contrastFactor, const unsigned char* importance)
+    : m_chords(chords), m_pixels(channels[0]->size()) {
+    m_darkness.resize(m_pixels * CHANNELS);
+    m_coverage.assign(m_pixels * CHANNELS, 0.0);
+    for (int c = 0; c < CHANNELS; c++) {
+        const std::vector<unsigned char>& gray = *channels[c];
+        double* dark = &m_darkness[c * m_pixels];
+        for (size_t i = 0; i < m_pixels; i++) {
+            double d = (255.0 - gray[i]) / 255.0;
+            dark[i] = d * (1.0 + d * contrastFactor);
+            if (importance) {
+                dark[i] *= importance[i] / 255.0;   // As StringArtGenerator::buildEnhancedDarkness
+            }
+        }
+    }
+    m_weighted = m_darkness;
+}
+
+double JointColorCoverage::scoreChord(int channel, int nailA, int nailB) const {
+    const double* weighted = &m_weighted[channel * m_pixels];
+    double total = 0.0;
+    int samples = 0;
+
+    m_chords.forEachSample(nailA, nailB, ChordTable::SCORE_SAMPLES, [&](int idx) {
+        total += weighted[idx];
+        samples++;
+    });
+
+    return samples > 0 ? total / samples : 0.0;
+}
+
+void JointColorCoverage::markChord(int channel, int nailA, int nailB, double strength) {
+    double* cov = &m_coverage[channel * m_pixels];
+    double* weighted = &m_weighted[channel * m_pixels];
+    const double* dark = &m_darkness[channel * m_pixels];
+    double amount = strength * 0.8;
+
+    m_chords.forEachSample(nailA, nailB, ChordTable::MARK_SAMPLES, [&](int idx) {
+        cov[idx] += amount;
+        weighted[idx] = dark[idx] * std::max(0.1, 1.0 - cov[idx] / 6.0);
+    });
+}
+
+size_t JointColorCoverage::memoryBytes() const {
+    return (m_darkness.size() + m_coverage.size() + m_weighted.size()) * sizeof(double);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "nail_layout.h"
+#include "chord_table.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Physical coverage model on a supersampled grid. Each processing pixel is split into
+// factor x factor subpixels and a string covers one subpixel per step, so a thread narrower than a
+// pixel darkens it only partially, the way it does on paper. Every pass over a subpixel blocks
+// threadWidth * factor of it (capped at 1): after k passes a subpixel's darkness is 1 - (1 - a)^k,
+// and a pixel's darkness is the mean over its subpixels.
+//
+// Subpixel pass counts are blocked per pixel: a pixel's factor x factor subpixels are contiguous
+// (one cache line at factor 8) and sit at the pixel's index times factor^2. In row-major order a
+// steep chord would touch a new line of a multi-megabyte grid on every subpixel step; blocked, all
+// the steps inside one pixel share a line, and the index comes from the pixel index already needed
+// for the residual lookup.
+class SupersampledCoverage {
+public:
+    // darkness: per-pixel target (contrast-enhanced, 0 = white); factor must be 1, 2, 4 or 8;
+    // threadWidth is the thread's width in processing pixels (see threadOpacityForPaper)
+    SupersampledCoverage(const NailLayout& layout, const std::vector<double>& darkness, int width, int height,
+                         int factor, double threadWidth);
+
+    // Mean over the chord's subpixels of (target - achieved pixel darkness) times the light the
+    // subpixel still lets through - how much darkness the string would add where it is wanted
+    double scoreChord(int nailA, int nailB) const;
+
+    // Lay the string down: bump pass counts and add its darkness to the pixels it crosses
+    void markChord(int nailA, int nailB);
+
+    int factor() const;
+    double subpixelOpacity() const;
+    size_t memoryBytes() const;
+
+    // Subpixel factor that makes one subpixel about one thread wide, capped at maxFactor
+    static int factorForThreadWidth(double threadWidth, int maxFactor = 8);
+
+private:
+    size_t subpixelIndex(int pixel, int fx, int fy) const;
+
+    // Bresenham walk on the subpixel grid from the lower-numbered nail: fn(fx, fy)
+    template <typename Fn>
+    void traceChord(int nailA, int nailB, Fn fn) const;
+
+    int m_width, m_height;
+    int m_factor, m_shift;          // m_factor == 1 << m_shift
+    double m_opacity;
+
+    std::vector<double> m_residual;                // Per-pixel target minus darkness laid so far
+    std::vector<uint8_t> m_passes;                 // Per-pixel-blocked subpixel pass counts (saturating)
+    std::vector<std::pair<int, int>> m_nailSubpixels;
+    double m_transmittance[256];                   // (1 - a)^k
+};
+
+// Integer version of the per-pixel coverage heuristic, for results that must not depend on the
+// compiler, the FPU or the vector width. Darkness and the coverage factor are Q12 fixed point and
+// every pixel keeps their product (Q24), so scoring a chord is one 32-bit load and add per pixel
+// against two doubles and a division in the floating-point path. All arithmetic is integer and
+// chord lengths come from the rounded nail pixels, so a given board gives bit-identical scores,
+// and therefore sequences, on every platform.
+class FixedPointCoverage {
+public:
+    static const int SCORE_BITS = 24;          // Scores are Q24: 1 << 24 == 1.0
+    static const int32_t ONE = 1 << 12;        // Q12 1.0 for darkness, factors and strengths
+
+    // gray: 8-bit image (255 = white); importance: optional per-pixel weight 0-255 that scales the
+    // darkness (null = the whole image counts). The table must outlive this object.
+    FixedPointCoverage(const ChordTable& chords, const std::vector<unsigned char>& gray, double contrastFactor,
+                       const unsigned char* importance = nullptr);
+
+    // Mean over the chord's pixels of darkness times max(0.1, 1 - coverage / 6), in Q24
+    int64_t scoreChord(int nailA, int nailB) const;
+
+    // Lay a string down with a Q12 strength (see StringArtGenerator's coverage schedules)
+    void markChord(int nailA, int nailB, int32_t strength);
+
+    // Chord length in pixels, Q8 (integer square root of the squared pixel distance)
+    int32_t chordLength(int nailA, int nailB) const;
+    int32_t longestChord() const;
+
+    size_t memoryBytes() const;
+
+    static double toDouble(int64_t score);
+
+private:
+    const ChordTable& m_chords;
+    std::vector<uint16_t> m_darkness;     // Contrast-enhanced darkness, Q12 (up to 3.0)
+    std::vector<uint16_t> m_penalty;      // Coverage / 6 in Q12, saturating where the factor floors at 0.1
+    std::vector<uint32_t> m_weighted;     // darkness * (1 - penalty), Q24
+    int32_t m_longestChord;
+};
+
+// Residual-image model: a single plane of the darkness each pixel still lacks, uint16 Q12, instead
+// of a target and a coverage grid read side by side. Laying a string subtracts the thread's darkness
+// along the chord, saturating at zero, and a chord's score is the integer sum of the residual it
+// crosses. Two bytes of solver state per pixel against eight for FixedPointCoverage (sixteen for the
+// double heuristic), so a 400 px board's plane fits in L2. Chord pixels are a Bresenham walk, one
+// scattered index per step, so the update is a branchless per-pixel saturating subtract rather than
+// packed SIMD. Integer throughout: sequences are bit-identical on every platform.
+class ResidualCoverage {
+public:
+    static const int32_t ONE = FixedPointCoverage::ONE;   // Q12 darkness
+
+    // darkness: per-pixel target (contrast-enhanced, 0 = white); threadWidth as for
+    // SupersampledCoverage, capped at one pixel. The table must outlive this object.
+    ResidualCoverage(const ChordTable& chords, const std::vector<double>& darkness, double threadWidth);
+
+    // Mean residual over the chord's pixels, Q24 (same scale as FixedPointCoverage::scoreChord)
+    int64_t scoreChord(int nailA, int nailB) const;
+
+    // Lay the string down: subtract one thread's darkness from every pixel it crosses
+    void markChord(int nailA, int nailB);
+
+    int32_t threadDarkness() const;   // Q12 darkness one pass lays down
+    size_t memoryBytes() const;
+
+private:
+    const ChordTable& m_chords;
+    std::vector<uint16_t> m_residual;
+    uint16_t m_threadDarkness;
+};
+
+// The per-pixel coverage heuristic for the four CMYK threads at once. Each pixel keeps darkness times
+// its coverage factor per channel, so scoring a chord is one load and add per sample instead of a
+// divide, a max and two loads. Channels are planar rather than interleaved: the four threads stand on
+// different nails, so a scan only ever needs its own channel, and a plane of weights stays in cache
+// where four interleaved channels would not. Samples, terms and summation order are exactly those of
+// the single-channel HeuristicScoring, so scores match it bit for bit.
+class JointColorCoverage {
+public:
+    static const int CHANNELS = 4;
+
+    // channels: 8-bit C, M, Y, K separations (255 = no ink); importance as for FixedPointCoverage.
+    // The table must outlive this object.
+    JointColorCoverage(const ChordTable& chords, const std::vector<const std::vector<unsigned char>*>& channels,
+                       double contrastFactor, const unsigned char* importance = nullptr);
+
+    // Mean coverage-weighted darkness over the chord's samples from nailA, for one channel
+    double scoreChord(int channel, int nailA, int nailB) const;
+
+    // Lay one channel's string down with a schedule strength, as HeuristicScoring::mark does
+    void markChord(int channel, int nailA, int nailB, double strength);
+
+    size_t memoryBytes() const;
+
+private:
+    const ChordTable& m_chords;
+    size_t m_pixels;
+    std::vector<double> m_darkness;   // Planar: channel * pixels + pixel
+    std::vector<double> m_coverage;
+    std::vector<double> m_weighted;   // darkness * max(0.1, 1 - coverage / 6)
+};
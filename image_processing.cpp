@@ -7,6 +7,12 @@
 #include <algorithm>
 #include <cmath>
 
+// BT.601 luma in integers: exact on every compiler (a floating-point multiply-add may or may not be
+// fused), and neutral grays map to themselves instead of sometimes truncating one level dark
+static inline unsigned char luma(unsigned char r, unsigned char g, unsigned char b) {
+    return (unsigned char)((299 * r + 587 * g + 114 * b) / 1000);
+}
+
 // Updated BMP loader - supports both grayscale and color modes
 bool loadBMP(const std::string& filename, std::vector<unsigned char>& imageData, int& width, int& height) {
     std::ifstream file(filename, std::ios::binary);
@@ -60,7 +66,7 @@ bool loadBMP(const std::string& filename, std::vector<unsigned char>& imageData,
             unsigned char g = row[x * bytesPerPixel + 1];
             unsigned char r = row[x * bytesPerPixel + 2];
             // Skip alpha channel if present (32-bit BMP)
-            unsigned char gray = (unsigned char)(0.299 * r + 0.587 * g + 0.114 * b);
+            unsigned char gray = luma(r, g, b);
             
             int flipped_y = height - 1 - y;
             imageData[flipped_y * width + x] = gray;
@@ -156,7 +162,7 @@ void ImageData::performColorSeparation() {
             unsigned char b = colorData[colorIdx + 2];
             
             // Convert to grayscale for backward compatibility
-            unsigned char gray = (unsigned char)(0.299 * r + 0.587 * g + 0.114 * b);
+            unsigned char gray = luma(r, g, b);
             data[pixelIdx] = gray;
             
             // Convert to CMYK
@@ -170,9 +176,7 @@ void ImageData::performColorSeparation() {
 }
 
 // Resize image to optimize processing - short side becomes 400px max
-void ImageData::resizeForProcessing() {
-    const int targetShortSide = 400;
-    
+void ImageData::resizeForProcessing(int targetShortSide, ResampleFilter filter) {
     // Check if resizing is needed
     int shortSide = std::min(width, height);
     if (shortSide <= targetShortSide) {
@@ -186,41 +190,16 @@ void ImageData::resizeForProcessing() {
     
     std::cout << "Resizing image from " << width << "x" << height 
               << " to " << newWidth << "x" << newHeight 
-              << " (scale factor: " << std::fixed << std::setprecision(3) << scaleFactor << ")" << std::endl;
+              << " (scale factor: " << std::fixed << std::setprecision(3) << scaleFactor << ", "
+              << (filter == RESAMPLE_LANCZOS ? "lanczos" : "box") << ")" << std::endl;
     
     if (isColorMode) {
-        // Resize color data using bilinear interpolation
-        std::vector<unsigned char> newColorData(newWidth * newHeight * 3);
-        
-        for (int y = 0; y < newHeight; y++) {
-            for (int x = 0; x < newWidth; x++) {
-                // Map new coordinates to original image
-                double srcX = x / scaleFactor;
-                double srcY = y / scaleFactor;
-                
-                // Bilinear interpolation
-                int x1 = (int)srcX;
-                int y1 = (int)srcY;
-                int x2 = std::min(x1 + 1, width - 1);
-                int y2 = std::min(y1 + 1, height - 1);
-                
-                double fx = srcX - x1;
-                double fy = srcY - y1;
-                
-                for (int c = 0; c < 3; c++) { // RGB channels
-                    double p1 = colorData[(y1 * width + x1) * 3 + c] * (1 - fx) + colorData[(y1 * width + x2) * 3 + c] * fx;
-                    double p2 = colorData[(y2 * width + x1) * 3 + c] * (1 - fx) + colorData[(y2 * width + x2) * 3 + c] * fx;
-                    double result = p1 * (1 - fy) + p2 * fy;
-                    
-                    newColorData[(y * newWidth + x) * 3 + c] = (unsigned char)std::clamp(result, 0.0, 255.0);
-                }
-            }
-        }
+        // Resize all three RGB channels in one pass
+        colorData = resampleImage(colorData, width, height, 3, newWidth, newHeight, filter);
         
         // Update dimensions and data
         width = newWidth;
         height = newHeight;
-        colorData = newColorData;
         
         // Resize other data vectors
         data.resize(width * height);
@@ -232,39 +211,172 @@ void ImageData::resizeForProcessing() {
         // Recompute color separation with new size
         performColorSeparation();
     } else {
-        // Resize grayscale data using bilinear interpolation
-        std::vector<unsigned char> newData(newWidth * newHeight);
-        
-        for (int y = 0; y < newHeight; y++) {
-            for (int x = 0; x < newWidth; x++) {
-                // Map new coordinates to original image
-                double srcX = x / scaleFactor;
-                double srcY = y / scaleFactor;
-                
-                // Bilinear interpolation
-                int x1 = (int)srcX;
-                int y1 = (int)srcY;
-                int x2 = std::min(x1 + 1, width - 1);
-                int y2 = std::min(y1 + 1, height - 1);
-                
-                double fx = srcX - x1;
-                double fy = srcY - y1;
-                
-                double p1 = data[y1 * width + x1] * (1 - fx) + data[y1 * width + x2] * fx;
-                double p2 = data[y2 * width + x1] * (1 - fx) + data[y2 * width + x2] * fx;
-                double result = p1 * (1 - fy) + p2 * fy;
-                
-                newData[y * newWidth + x] = (unsigned char)std::clamp(result, 0.0, 255.0);
-            }
-        }
+        data = resampleImage(data, width, height, 1, newWidth, newHeight, filter);
         
         // Update dimensions and data
         width = newWidth;
         height = newHeight;
-        data = newData;
     }
 }
 
+namespace {
+
+const int RESAMPLE_BITS = 14;   // Fixed-point weight scale: weights sum to 1 << 14
+
+// Filter taps for one axis: output i reads count[i] source samples from start[i]
+struct ResampleTaps {
+    std::vector<int> start;
+    std::vector<int> count;
+    std::vector<int32_t> weights;   // maxTaps per output, zero-padded
+    int maxTaps;
+};
+
+double lanczos3(double x) {
+    if (x == 0.0) return 1.0;
+    if (x <= -3.0 || x >= 3.0) return 0.0;
+    double px = M_PI * x;
+    return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+}
+
+ResampleTaps buildResampleTaps(int srcSize, int dstSize, ResampleFilter filter) {
+    double scale = (double)srcSize / dstSize;
+    double filterScale = std::max(1.0, scale);                  // Widen the kernel when downscaling
+    double support = (filter == RESAMPLE_LANCZOS ? 3.0 : 0.5) * filterScale;
+    
+    ResampleTaps taps;
+    taps.maxTaps = (int)std::ceil(support) * 2 + 1;
+    taps.start.resize(dstSize);
+    taps.count.resize(dstSize);
+    taps.weights.assign((size_t)dstSize * taps.maxTaps, 0);
+    
+    std::vector<double> weights(taps.maxTaps);
+    for (int i = 0; i < dstSize; i++) {
+        double center = (i + 0.5) * scale;
+        int lo = std::max(0, (int)std::floor(center - support));
+        int hi = std::min(srcSize, (int)std::ceil(center + support));
+        hi = std::min(hi, lo + taps.maxTaps);
+        
+        double sum = 0.0;
+        for (int j = lo; j < hi; j++) {
+            double w;
+            if (filter == RESAMPLE_LANCZOS) {
+                w = lanczos3((j + 0.5 - center) / filterScale);
+            } else {
+                // Box: overlap of source pixel [j, j+1) with the output pixel's footprint
+                w = std::max(0.0, std::min(j + 1.0, center + support) - std::max((double)j, center - support));
+            }
+            weights[j - lo] = w;
+            sum += w;
+        }
+        
+        // Normalize to fixed point; rounding slack goes to the largest tap so weights sum exactly
+        int32_t* fixed = &taps.weights[(size_t)i * taps.maxTaps];
+        int32_t total = 0;
+        int largest = 0;
+        for (int k = 0; k < hi - lo; k++) {
+            fixed[k] = (int32_t)std::lround(weights[k] / sum * (1 << RESAMPLE_BITS));
+            total += fixed[k];
+            if (fixed[k] > fixed[largest]) largest = k;
+        }
+        fixed[largest] += (1 << RESAMPLE_BITS) - total;
+        
+        taps.start[i] = lo;
+        taps.count[i] = hi - lo;
+    }
+    return taps;
+}
+
+inline unsigned char clampFixed(int32_t acc) {
+    int32_t value = acc >> RESAMPLE_BITS;
+    return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+} // namespace
+
+std::vector<unsigned char> resampleImage(const std::vector<unsigned char>& pixels, int width, int height, int channels,
+                                         int newWidth, int newHeight, ResampleFilter filter) {
+    ResampleTaps horizontal = buildResampleTaps(width, newWidth, filter);
+    ResampleTaps vertical = buildResampleTaps(height, newHeight, filter);
+    const int32_t rounding = 1 << (RESAMPLE_BITS - 1);
+    
+    // Horizontal pass: every channel of an output pixel reads the same taps
+    std::vector<unsigned char> rows((size_t)height * newWidth * channels);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = &pixels[(size_t)y * width * channels];
+        unsigned char* dst = &rows[(size_t)y * newWidth * channels];
+        
+        for (int x = 0; x < newWidth; x++) {
+            const int32_t* w = &horizontal.weights[(size_t)x * horizontal.maxTaps];
+            const unsigned char* tap = src + (size_t)horizontal.start[x] * channels;
+            int count = horizontal.count[x];
+            
+            for (int c = 0; c < channels; c++) {
+                int32_t acc = rounding;
+                for (int k = 0; k < count; k++) {
+                    acc += w[k] * tap[k * channels + c];
+                }
+                dst[x * channels + c] = clampFixed(acc);
+            }
+        }
+    }
+    
+    // Vertical pass: whole rows at a time, so the inner loop is a contiguous multiply-add the
+    // compiler vectorizes (SSE2/NEON) without platform-specific intrinsics
+    int rowLength = newWidth * channels;
+    std::vector<unsigned char> result((size_t)newHeight * rowLength);
+    std::vector<int32_t> acc(rowLength);
+    for (int y = 0; y < newHeight; y++) {
+        std::fill(acc.begin(), acc.end(), rounding);
+        const int32_t* w = &vertical.weights[(size_t)y * vertical.maxTaps];
+        
+        for (int k = 0; k < vertical.count[y]; k++) {
+            const unsigned char* src = &rows[(size_t)(vertical.start[y] + k) * rowLength];
+            int32_t weight = w[k];
+            int32_t* a = acc.data();
+            for (int i = 0; i < rowLength; i++) {
+                a[i] += weight * src[i];
+            }
+        }
+        
+        unsigned char* dst = &result[(size_t)y * rowLength];
+        for (int i = 0; i < rowLength; i++) {
+            dst[i] = clampFixed(acc[i]);
+        }
+    }
+    
+    return result;
+}
+
+// Decoded pixels from memory (no file involved): gray, RGB or RGBA, 8 bits per channel
+bool imageFromPixels(const std::vector<unsigned char>& pixels, int width, int height, int channels, bool colorMode, ImageData& img) {
+    if (width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4) ||
+        pixels.size() < (size_t)width * height * channels) {
+        return false;
+    }
+    
+    img = ImageData(width, height, colorMode);
+    for (int i = 0; i < width * height; i++) {
+        const unsigned char* pixel = &pixels[(size_t)i * channels];
+        // Alpha (if present) is ignored, like 32-bit BMPs
+        unsigned char r = pixel[0];
+        unsigned char g = channels >= 3 ? pixel[1] : r;
+        unsigned char b = channels >= 3 ? pixel[2] : r;
+        
+        if (colorMode) {
+            img.colorData[i * 3] = r;
+            img.colorData[i * 3 + 1] = g;
+            img.colorData[i * 3 + 2] = b;
+        } else {
+            img.data[i] = channels == 1 ? r : luma(r, g, b);
+        }
+    }
+    
+    if (colorMode) {
+        img.performColorSeparation();
+    }
+    return true;
+}
+
 // Color-aware BMP loader that preserves RGB information
 bool loadBMPColor(const std::string& filename, ImageData& img) {
     std::ifstream file(filename, std::ios::binary);
@@ -898,7 +1010,7 @@ bool loadPNG(const std::string& filename, std::vector<unsigned char>& imageData,
                 unsigned char r = row[x * bytesPerPixel];
                 unsigned char g = row[x * bytesPerPixel + 1];
                 unsigned char b = row[x * bytesPerPixel + 2];
-                unsigned char gray = (unsigned char)(0.299 * r + 0.587 * g + 0.114 * b);
+                unsigned char gray = luma(r, g, b);
                 imageData[y * width + x] = gray;
             }
         }
@@ -1436,3 +1548,113 @@ bool loadJPEGColor(const std::string& filename, ImageData& img) {
     img = ImageData(width, height, true);
     return false;
 }
+
+// Binary PGM (P5) for grayscale, PPM (P6) for RGB
+bool writePGM(const std::string& filename, const std::vector<unsigned char>& pixels, int width, int height, int channels) {
+    if (channels != 1 && channels != 3) return false;
+    if (pixels.size() < (size_t)width * height * channels) return false;
+    
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    
+    file << (channels == 1 ? "P5" : "P6") << "\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), (std::streamsize)width * height * channels);
+    return file.good();
+}
+
+static uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t length) {
+    // Built once on first use (thread-safe static initialization)
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void writeBigEndianUint32(std::ofstream& file, uint32_t value) {
+    unsigned char bytes[4] = {(unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value};
+    file.write(reinterpret_cast<const char*>(bytes), 4);
+}
+
+static void writePNGChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& payload) {
+    writeBigEndianUint32(file, (uint32_t)payload.size());
+    
+    std::vector<unsigned char> typed(type, type + 4);
+    typed.insert(typed.end(), payload.begin(), payload.end());
+    file.write(reinterpret_cast<const char*>(typed.data()), typed.size());
+    writeBigEndianUint32(file, crc32Update(0, typed.data(), typed.size()));
+}
+
+// Minimal PNG encoder - unfiltered rows in stored (uncompressed) deflate blocks.
+// Previews are written often and read rarely, so encoding speed wins over file size.
+bool writePNG(const std::string& filename, const std::vector<unsigned char>& pixels, int width, int height, int channels) {
+    if (channels != 1 && channels != 3) return false;
+    if (pixels.size() < (size_t)width * height * channels) return false;
+    
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    
+    const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    file.write(reinterpret_cast<const char*>(signature), 8);
+    
+    std::vector<unsigned char> ihdr = {
+        (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+        (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+        8,                                      // bit depth
+        (unsigned char)(channels == 1 ? 0 : 2), // color type: gray or RGB
+        0, 0, 0                                 // compression, filter, interlace
+    };
+    writePNGChunk(file, "IHDR", ihdr);
+    
+    // Raw scanlines, each prefixed with filter type 0
+    size_t rowBytes = (size_t)width * channels;
+    std::vector<unsigned char> raw;
+    raw.reserve((rowBytes + 1) * height);
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * rowBytes, pixels.begin() + (y + 1) * rowBytes);
+    }
+    
+    // zlib stream: header, stored blocks of at most 65535 bytes, Adler-32 trailer
+    std::vector<unsigned char> idat = {0x78, 0x01};
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min<size_t>(65535, raw.size() - offset);
+        bool finalBlock = offset + blockSize == raw.size();
+        idat.push_back(finalBlock ? 1 : 0);
+        idat.push_back((unsigned char)(blockSize & 0xFF));
+        idat.push_back((unsigned char)(blockSize >> 8));
+        idat.push_back((unsigned char)(~blockSize & 0xFF));
+        idat.push_back((unsigned char)((~blockSize >> 8) & 0xFF));
+        idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+    
+    uint32_t adlerA = 1, adlerB = 0;
+    for (unsigned char byte : raw) {
+        adlerA = (adlerA + byte) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+    }
+    uint32_t adler = (adlerB << 16) | adlerA;
+    idat.push_back((unsigned char)(adler >> 24));
+    idat.push_back((unsigned char)(adler >> 16));
+    idat.push_back((unsigned char)(adler >> 8));
+    idat.push_back((unsigned char)adler);
+    
+    writePNGChunk(file, "IDAT", idat);
+    writePNGChunk(file, "IEND", std::vector<unsigned char>());
+    
+    return file.good();
+}
@@ -28,6 +28,14 @@ struct CMYKPixel {
     CMYKPixel(unsigned char c = 0, unsigned char m = 0, unsigned char y = 0, unsigned char k = 255) 
         : c(c), m(m), y(y), k(k) {}
 };
+// Downscaling filter for the processing image
+enum ResampleFilter {
+    RESAMPLE_BOX,       // Area averaging: fast, no ringing
+    RESAMPLE_LANCZOS    // Lanczos-3: sharper, slight ringing on hard edges
+};
+
+// Default short side of the processing image
+const int DEFAULT_WORK_SIZE = 400;
 
 struct ImageData {
     int width, height;
@@ -56,8 +64,8 @@ struct ImageData {
     // Perform CMYK color separation from RGB data
     void performColorSeparation();
     
-    // Resize image to optimize processing - short side becomes 400px max
-    void resizeForProcessing();
+    // Resize image to optimize processing - short side becomes targetShortSide max (never upscaled)
+    void resizeForProcessing(int targetShortSide = DEFAULT_WORK_SIZE, ResampleFilter filter = RESAMPLE_BOX);
 };
 
 // Function declarations
@@ -66,6 +74,9 @@ bool convertToBMP(const std::string& inputFile, const std::string& tempBMP);
 CMYKPixel rgbToCmyk(unsigned char r, unsigned char g, unsigned char b);
 bool loadBMPColor(const std::string& filename, ImageData& img);
 
+// Build an image from decoded 8-bit pixels in memory (channels 1, 3 or 4; alpha is ignored)
+bool imageFromPixels(const std::vector<unsigned char>& pixels, int width, int height, int channels, bool colorMode, ImageData& img);
+
 // Native PNG loading functions
 bool loadPNG(const std::string& filename, std::vector<unsigned char>& imageData, int& width, int& height);
 bool loadPNGColor(const std::string& filename, ImageData& img);
@@ -82,3 +93,11 @@ bool loadJPEGColor(const std::string& filename, ImageData& img);
 bool isJPEGFile(const std::string& filename);
 bool parseJPEGHeader(const std::vector<unsigned char>& buffer, int& width, int& height);
 bool decodeJPEG(const std::vector<unsigned char>& buffer, std::vector<unsigned char>& imageData, int width, int height);
+
+// Separable fixed-point resampler for interleaved 8-bit pixels (channels 1-4, all in one pass)
+std::vector<unsigned char> resampleImage(const std::vector<unsigned char>& pixels, int width, int height, int channels,
+                                         int newWidth, int newHeight, ResampleFilter filter);
+
+// Image writing functions (previews) - channels is 1 (gray) or 3 (RGB)
+bool writePGM(const std::string& filename, const std::vector<unsigned char>& pixels, int width, int height, int channels);
+bool writePNG(const std::string& filename, const std::vector<unsigned char>& pixels, int width, int height, int channels);
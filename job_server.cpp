@@ -0,0 +1,775 @@
+#include "job_server.h"
+#include "svg_generator.h"
+#include <iostream>
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <csignal>
+#endif
+
+namespace {
+
+// Request values: the server only takes flat objects of strings, numbers and booleans
+struct JsonValue {
+    enum Type { STRING, NUMBER, BOOL, NUL } type;
+    std::string text;
+    double number;
+    bool flag;
+
+    JsonValue() : type(NUL), number(0.0), flag(false) {}
+};
+
+void skipSpace(const std::string& s, size_t& pos) {
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r' || s[pos] == '\n')) pos++;
+}
+
+bool parseJsonString(const std::string& s, size_t& pos, std::string& out) {
+    if (pos >= s.size() || s[pos] != '"') return false;
+    pos++;
+    out.clear();
+    while (pos < s.size() && s[pos] != '"') {
+        char c = s[pos++];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= s.size()) return false;
+        char e = s[pos++];
+        switch (e) {
+            case '"': case '\\': case '/': out += e; break;
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                if (pos + 4 > s.size()) return false;
+                unsigned code = (unsigned)std::strtoul(s.substr(pos, 4).c_str(), nullptr, 16);
+                pos += 4;
+                // Paths and names are expected to be ASCII; anything else is kept as UTF-8 (no surrogate pairs)
+                if (code < 0x80) {
+                    out += (char)code;
+                } else if (code < 0x800) {
+                    out += (char)(0xC0 | (code >> 6));
+                    out += (char)(0x80 | (code & 0x3F));
+                } else {
+                    out += (char)(0xE0 | (code >> 12));
+                    out += (char)(0x80 | ((code >> 6) & 0x3F));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: return false;
+        }
+    }
+    if (pos >= s.size()) return false;
+    pos++;
+    return true;
+}
+
+bool parseFlatJson(const std::string& s, std::map<std::string, JsonValue>& fields, std::string& error) {
+    size_t pos = 0;
+    skipSpace(s, pos);
+    if (pos >= s.size() || s[pos] != '{') {
+        error = "Request must be a JSON object";
+        return false;
+    }
+    pos++;
+    skipSpace(s, pos);
+    if (pos < s.size() && s[pos] == '}') {
+        pos++;
+    } else {
+        while (true) {
+            std::string key;
+            skipSpace(s, pos);
+            if (!parseJsonString(s, pos, key)) {
+                error = "Expected a quoted key";
+                return false;
+            }
+            skipSpace(s, pos);
+            if (pos >= s.size() || s[pos] != ':') {
+                error = "Expected ':' after \"" + key + "\"";
+                return false;
+            }
+            pos++;
+            skipSpace(s, pos);
+
+            JsonValue value;
+            if (pos < s.size() && s[pos] == '"') {
+                value.type = JsonValue::STRING;
+                if (!parseJsonString(s, pos, value.text)) {
+                    error = "Unterminated string for \"" + key + "\"";
+                    return false;
+                }
+            } else if (s.compare(pos, 4, "true") == 0 || s.compare(pos, 5, "false") == 0) {
+                value.type = JsonValue::BOOL;
+                value.flag = s[pos] == 't';
+                pos += value.flag ? 4 : 5;
+            } else if (s.compare(pos, 4, "null") == 0) {
+                pos += 4;
+            } else {
+                const char* start = s.c_str() + pos;
+                char* end = nullptr;
+                value.number = std::strtod(start, &end);
+                if (end == start) {
+                    error = "Unsupported value for \"" + key + "\" (strings, numbers and booleans only)";
+                    return false;
+                }
+                value.type = JsonValue::NUMBER;
+                pos += end - start;
+            }
+            fields[key] = value;
+
+            skipSpace(s, pos);
+            if (pos < s.size() && s[pos] == ',') {
+                pos++;
+                continue;
+            }
+            if (pos < s.size() && s[pos] == '}') {
+                pos++;
+                break;
+            }
+            error = "Expected ',' or '}' after \"" + key + "\"";
+            return false;
+        }
+    }
+    skipSpace(s, pos);
+    if (pos != s.size()) {
+        error = "Trailing characters after the request object";
+        return false;
+    }
+    return true;
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned char)c);
+                    out += buffer;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+std::string jsonArray(const std::vector<int>& values) {
+    std::string out = "[";
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) out += ',';
+        out += std::to_string(values[i]);
+    }
+    return out + "]";
+}
+
+// Finite numbers only; JSON has no inf or nan (a perfect PSNR is reported as null)
+std::string jsonNumber(double value) {
+    if (!std::isfinite(value)) return "null";
+    std::ostringstream out;
+    out << std::setprecision(6) << value;
+    return out.str();
+}
+
+std::string eventHead(const std::string& id, const char* event) {
+    return "{\"id\":" + jsonString(id) + ",\"event\":\"" + event + "\"";
+}
+
+const char* stageName(StringArtStage stage) {
+    switch (stage) {
+        case STAGE_SNAPSHOT: return "snapshot";
+        case STAGE_REFINING: return "refining";
+        case STAGE_RENDERING: return "rendering";
+        default: return "solving";
+    }
+}
+
+class StreamSink : public ReplySink {
+public:
+    explicit StreamSink(std::ostream& out) : m_out(out) {}
+
+    void send(const std::string& line) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_out << line << '\n';
+        m_out.flush();
+    }
+
+private:
+    std::ostream& m_out;
+    std::mutex m_mutex;
+};
+
+#ifndef _WIN32
+// One socket client. The descriptor closes when the reader and every job holding the sink are done.
+class SocketSink : public ReplySink {
+public:
+    explicit SocketSink(int fd) : m_fd(fd) {}
+    ~SocketSink() override { close(m_fd); }
+
+    void send(const std::string& line) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::string data = line + "\n";
+        size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t written = write(m_fd, data.data() + offset, data.size() - offset);
+            if (written <= 0) return;   // Client went away; the job still finishes
+            offset += written;
+        }
+    }
+
+    int fd() const { return m_fd; }
+
+private:
+    int m_fd;
+    std::mutex m_mutex;
+};
+#endif
+
+} // namespace
+
+JobServer::JobServer(const StringArtRequest& defaults, int workers, size_t imageCacheSize)
+    : m_defaults(defaults), m_imageCacheSize(std::max<size_t>(1, imageCacheSize)), m_running(0), m_stop(false),
+      m_shutdown(false), m_nextId(0), m_jobsDone(0), m_jobsFailed(0), m_imageHits(0), m_imageMisses(0), m_listenFd(-1) {
+    // Jobs log nothing; their results are the replies. Parallelism comes from running jobs side by
+    // side, so a job's own parallel modes use one thread unless it asks for more with "threads".
+    m_defaults.verbose = false;
+    m_defaults.numThreads = 1;
+    if (workers <= 0) {
+        workers = (int)std::thread::hardware_concurrency();
+        if (workers <= 0) workers = 1;
+    }
+    for (int i = 0; i < workers; i++) {
+        m_workers.emplace_back(&JobServer::workerLoop, this);
+    }
+}
+
+JobServer::~JobServer() {
+    drain();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobServer::drain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_queue.empty() && m_running == 0; });
+}
+
+int JobServer::serveStream(std::istream& in, std::ostream& out) {
+    std::shared_ptr<ReplySink> sink = std::make_shared<StreamSink>(out);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        handleLine(line, sink);
+    }
+    drain();
+    return 0;
+}
+
+int JobServer::serveSocket(const std::string& path) {
+#ifdef _WIN32
+    std::cout << "Error: --serve on a socket needs Unix domain sockets; use --serve without a path (stdin)" << std::endl;
+    return 1;
+#else
+    // A client that disconnects mid-reply must fail the write, not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cout << "Error: Socket path too long: " << path << std::endl;
+        return 1;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // A stale socket from an earlier server is replaced; any other file is left alone
+    std::error_code ec;
+    if (std::filesystem::is_socket(path, ec)) {
+        std::filesystem::remove(path, ec);
+    }
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listenFd < 0 || bind(m_listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(m_listenFd, 16) != 0) {
+        std::cout << "Error: Cannot listen on socket: " << path << " (" << std::strerror(errno) << ")" << std::endl;
+        if (m_listenFd >= 0) close(m_listenFd);
+        m_listenFd = -1;
+        return 1;
+    }
+    std::cout << "Serving on " << path << " with " << m_workers.size() << " workers" << std::endl;
+
+    struct Client {
+        std::thread reader;
+        std::shared_ptr<SocketSink> sink;
+    };
+    std::vector<Client> clients;
+
+    while (true) {
+        int fd = accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;   // Listening socket shut down by a shutdown request
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_shutdown) {
+                close(fd);
+                break;
+            }
+        }
+
+        Client client;
+        client.sink = std::make_shared<SocketSink>(fd);
+        std::shared_ptr<ReplySink> sink = client.sink;
+        client.reader = std::thread([this, fd, sink]() {
+            std::string pending;
+            char buffer[4096];
+            ssize_t got;
+            while ((got = read(fd, buffer, sizeof(buffer))) > 0) {
+                pending.append(buffer, got);
+                size_t newline;
+                while ((newline = pending.find('\n')) != std::string::npos) {
+                    std::string line = pending.substr(0, newline);
+                    pending.erase(0, newline + 1);
+                    if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                        handleLine(line, sink);
+                    }
+                }
+            }
+            if (pending.find_first_not_of(" \t\r") != std::string::npos) {
+                handleLine(pending, sink);
+            }
+        });
+        clients.push_back(std::move(client));
+    }
+
+    // Wake readers still waiting on connected clients, then let queued jobs finish
+    for (Client& client : clients) {
+        shutdown(client.sink->fd(), SHUT_RD);
+    }
+    for (Client& client : clients) {
+        client.reader.join();
+    }
+    drain();
+
+    close(m_listenFd);
+    m_listenFd = -1;
+    std::filesystem::remove(path, ec);
+    std::cout << "Server stopped: " << m_jobsDone << " jobs done, " << m_jobsFailed << " failed" << std::endl;
+    return 0;
+#endif
+}
+
+void JobServer::handleLine(const std::string& line, const std::shared_ptr<ReplySink>& sink) {
+    std::unique_ptr<Job> job(new Job());
+    std::string op, error;
+    if (!parseJob(line, *job, op, error)) {
+        sink->send(eventHead(job->id, "error") + ",\"error\":" + jsonString(error) + "}");
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (op == "cancel") {
+        std::map<std::string, std::shared_ptr<CancellationToken>>::iterator active = m_active.find(job->id);
+        bool found = active != m_active.end();
+        if (found) active->second->cancel();
+        lock.unlock();
+        sink->send(eventHead(job->id, "cancel") + ",\"found\":" + (found ? "true" : "false") + "}");
+        return;
+    }
+    if (op == "stats") {
+        std::string reply = eventHead(job->id, "stats") + ",\"workers\":" + std::to_string(m_workers.size()) +
+                            ",\"queued\":" + std::to_string(m_queue.size()) + ",\"running\":" + std::to_string(m_running) +
+                            ",\"done\":" + std::to_string(m_jobsDone) + ",\"failed\":" + std::to_string(m_jobsFailed);
+        lock.unlock();
+        std::lock_guard<std::mutex> imageLock(m_imageMutex);
+        sink->send(reply + ",\"image_cache_hits\":" + std::to_string(m_imageHits) +
+                   ",\"image_cache_misses\":" + std::to_string(m_imageMisses) + "}");
+        return;
+    }
+    if (op == "shutdown") {
+        m_shutdown = true;
+        lock.unlock();
+#ifndef _WIN32
+        // Unblocks accept(); the socket server then finishes queued jobs and returns
+        if (m_listenFd >= 0) shutdown(m_listenFd, SHUT_RDWR);
+#endif
+        sink->send(eventHead(job->id, "shutdown") + "}");
+        return;
+    }
+
+    if (job->id.empty()) {
+        job->id = "job-" + std::to_string(++m_nextId);
+    }
+    if (m_active.count(job->id)) {
+        lock.unlock();
+        sink->send(eventHead(job->id, "error") + ",\"error\":\"A job with this id is already queued or running\"}");
+        return;
+    }
+    job->sink = sink;
+    job->cancel = std::make_shared<CancellationToken>();
+    m_active[job->id] = job->cancel;
+    std::string reply = eventHead(job->id, "queued") + ",\"position\":" + std::to_string(m_queue.size()) + "}";
+    m_queue.push_back(std::move(job));
+    lock.unlock();
+
+    // Sent before a worker can pick the job up, so "queued" always comes first
+    sink->send(reply);
+    m_wake.notify_one();
+}
+
+bool JobServer::parseJob(const std::string& line, Job& job, std::string& op, std::string& error) const {
+    std::map<std::string, JsonValue> fields;
+    if (!parseFlatJson(line, fields, error)) return false;
+
+    op = "run";
+    job.request = m_defaults;
+    StringArtRequest& request = job.request;
+    bool paletteGiven = false;
+
+    for (const std::pair<const std::string, JsonValue>& field : fields) {
+        const std::string& key = field.first;
+        const JsonValue& value = field.second;
+        bool isString = value.type == JsonValue::STRING;
+        bool isNumber = value.type == JsonValue::NUMBER;
+        bool isBool = value.type == JsonValue::BOOL;
+        bool ok = true;
+
+        if (key == "id") {
+            ok = isString || isNumber;
+            job.id = isString ? value.text : jsonNumber(value.number);
+        } else if (key == "op") {
+            ok = isString && (value.text == "run" || value.text == "cancel" || value.text == "stats" || value.text == "shutdown");
+            op = value.text;
+        } else if (key == "input") {
+            ok = isString;
+            job.input = value.text;
+        } else if (key == "svg") {
+            ok = isString;
+            job.svgFile = value.text;
+        } else if (key == "preview") {
+            ok = isString;
+            job.previewFile = value.text;
+        } else if (key == "layout") {
+            ok = isString;
+            request.layoutSpec = value.text;
+        } else if (key == "nails") {
+            ok = isNumber;
+            request.numNails = (int)value.number;
+        } else if (key == "strings") {
+            ok = isNumber && value.number >= 0;
+            request.maxStrings = (int)value.number;
+        } else if (key == "strategy") {
+            ok = isNumber && value.number >= 0 && value.number <= 3;
+            request.coverageStrategy = (int)value.number;
+        } else if (key == "contrast") {
+            ok = isNumber && value.number >= 0.0 && value.number <= 2.0;
+            request.contrastFactor = value.number;
+        } else if (key == "thread") {
+            ok = isString;
+            request.threadThickness = value.text;
+        } else if (key == "paper_width") {
+            ok = isNumber && value.number > 0;
+            request.paperWidth = value.number;
+        } else if (key == "paper_height") {
+            ok = isNumber && value.number > 0;
+            request.paperHeight = value.number;
+        } else if (key == "color") {
+            // true for CMYK, or the layering order
+            ok = isBool || (isString && value.text.size() == 4 && value.text.find_first_not_of("CMYK") == std::string::npos);
+            request.colorMode = isString || value.flag;
+            if (isString) request.colorOrder = value.text;
+        } else if (key == "strings_per_color") {
+            ok = isNumber && value.number >= 1 && value.number <= 2500;
+            request.stringsPerColor = (int)value.number;
+        } else if (key == "palette") {
+            std::vector<ThreadColor> colors;
+            int autoColors = 0;
+            ok = isString && parsePalette(value.text, colors, autoColors);
+            request.palette = value.text;
+            paletteGiven = true;
+        } else if (key == "roi") {
+            ok = isString && !value.text.empty();
+            request.roi = value.text;
+        } else if (key == "restarts") {
+            ok = isNumber && value.number >= 1;
+            request.restarts = (int)value.number;
+        } else if (key == "threads") {
+            ok = isNumber && value.number >= 0;
+            request.numThreads = (int)value.number;
+        } else if (key == "refine") {
+            ok = isNumber && value.number >= 0;
+            request.refineSeconds = value.number;
+        } else if (key == "refine_moves") {
+            ok = isNumber && value.number >= 0;
+            request.refineMoves = (long long)value.number;
+        } else if (key == "time_budget") {
+            ok = isNumber && value.number >= 0;
+            request.timeBudgetSeconds = value.number;
+        } else if (key == "supersample") {
+            ok = isNumber && (value.number == -1 || value.number == 0 || value.number == 1 || value.number == 2 ||
+                              value.number == 4 || value.number == 8);
+            request.supersample = (int)value.number;
+        } else if (key == "fixed_point") {
+            ok = isBool;
+            request.fixedPoint = value.flag;
+        } else if (key == "residual") {
+            ok = isBool;
+            request.residual = value.flag;
+        } else if (key == "lazy") {
+            ok = isBool;
+            request.lazyEvaluation = value.flag;
+        } else if (key == "joint_color") {
+            ok = isBool;
+            request.jointColor = value.flag;
+        } else if (key == "work_size") {
+            ok = isNumber && value.number >= 100 && value.number <= 2000;
+            request.workSize = (int)value.number;
+        } else if (key == "resample") {
+            ok = isString && (value.text == "box" || value.text == "lanczos");
+            request.resampleFilter = value.text == "lanczos" ? RESAMPLE_LANCZOS : RESAMPLE_BOX;
+        } else if (key == "progress") {
+            ok = isNumber && value.number >= 0;
+            request.progressInterval = (int)value.number;
+        } else {
+            error = "Unknown field \"" + key + "\"";
+            return false;
+        }
+
+        if (!ok) {
+            error = "Invalid value for \"" + key + "\"";
+            return false;
+        }
+    }
+
+    if (op != "run") {
+        if ((op == "cancel") && job.id.empty()) {
+            error = "cancel needs the id of the job";
+            return false;
+        }
+        return true;
+    }
+    if (paletteGiven && !request.palette.empty()) {
+        request.colorMode = true;
+    }
+    if (job.input.empty()) {
+        error = "Missing \"input\" image file";
+        return false;
+    }
+    if (request.layoutSpec.rfind("csv:", 0) != 0 && (request.numNails < 50 || request.numNails > 1000)) {
+        error = "Number of nails must be between 50 and 1000";
+        return false;
+    }
+    if (request.fixedPoint && request.supersample >= 0) {
+        error = "fixed_point and supersample cannot be combined";
+        return false;
+    }
+    if (request.residual && (request.fixedPoint || request.supersample >= 0)) {
+        error = "residual cannot be combined with fixed_point or supersample";
+        return false;
+    }
+    return true;
+}
+
+void JobServer::workerLoop() {
+    // The engine, and the chord geometry it keeps warm, lives as long as the worker
+    StringArtEngine engine;
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;   // Stopped and drained
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_running++;
+        }
+
+        runJob(engine, *job);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running--;
+            m_active.erase(job->id);
+        }
+        m_idle.notify_all();
+    }
+}
+
+std::shared_ptr<const ImageData> JobServer::imageFor(StringArtEngine& engine, const Job& job, bool& cached) {
+    cached = false;
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::absolute(job.input, ec);
+    if (ec || !std::filesystem::is_regular_file(path, ec)) {
+        return nullptr;
+    }
+
+    // A rewritten file gets a new key; the stale entry ages out
+    std::ostringstream key;
+    key << path.string() << '|' << std::filesystem::file_size(path, ec) << '|'
+        << std::filesystem::last_write_time(path, ec).time_since_epoch().count() << '|'
+        << job.request.workSize << '|' << (int)job.request.resampleFilter << '|' << job.request.colorMode;
+
+    {
+        std::lock_guard<std::mutex> lock(m_imageMutex);
+        for (std::list<CachedImage>::iterator it = m_images.begin(); it != m_images.end(); ++it) {
+            if (it->key == key.str()) {
+                m_images.splice(m_images.begin(), m_images, it);
+                m_imageHits++;
+                cached = true;
+                return it->image;
+            }
+        }
+        m_imageMisses++;
+    }
+
+    // Decoded outside the lock; two workers missing on the same file at once both decode it
+    std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+    if (!engine.loadImage(path.string(), job.request, *image)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_imageMutex);
+    m_images.push_front({key.str(), image});
+    if (m_images.size() > m_imageCacheSize) {
+        m_images.pop_back();
+    }
+    return image;
+}
+
+void JobServer::runJob(StringArtEngine& engine, Job& job) {
+    ReplySink& sink = *job.sink;
+    auto fail = [&](const std::string& error) {
+        sink.send(eventHead(job.id, "error") + ",\"error\":" + jsonString(error) + "}");
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobsFailed++;
+    };
+
+    // Cancelled while still queued
+    if (job.cancel->isCancelled()) {
+        fail("Cancelled before it started");
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    bool imageCached = false;
+    std::shared_ptr<const ImageData> image = imageFor(engine, job, imageCached);
+    if (!image) {
+        fail("Cannot load image: " + job.input);
+        return;
+    }
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    auto progress = [&](const StringArtProgress& update) {
+        std::string line = eventHead(job.id, "progress") + ",\"stage\":\"" + stageName(update.stage) + "\"";
+        if (update.sequence) {
+            line += ",\"strings\":" + std::to_string(update.sequence->size());
+        }
+        sink.send(line + "}");
+    };
+
+    StringArtResponse response = engine.run(*image, job.request, progress, job.cancel.get());
+    if (!response.success) {
+        fail(response.error);
+        return;
+    }
+
+    const std::string paletteSpec = job.request.palette;
+    bool paletteMode = job.request.colorMode && !paletteSpec.empty();
+    std::vector<std::string> files;
+    bool filesOk = true;
+    if (!job.svgFile.empty()) {
+        bool written;
+        if (paletteMode) {
+            written = generatePaletteSVG(job.svgFile, response.paletteSequences, response.layout, response.width, response.height,
+                                         job.request.threadThickness, job.request.paperWidth, job.request.paperHeight);
+        } else if (job.request.colorMode) {
+            written = generateColorSVG(job.svgFile, response.colorSequences, response.layout, response.width, response.height,
+                                       job.request.threadThickness, job.request.colorOrder, job.request.paperWidth, job.request.paperHeight);
+        } else {
+            written = generateSVG(job.svgFile, response.sequence, response.layout, response.width, response.height,
+                                  job.request.threadThickness, job.request.paperWidth, job.request.paperHeight);
+        }
+        if (written) files.push_back(job.svgFile); else filesOk = false;
+    }
+    if (!job.previewFile.empty()) {
+        if (writePreviewImage(job.previewFile, response.preview, response.width, response.height, response.previewChannels)) {
+            files.push_back(job.previewFile);
+        } else {
+            filesOk = false;
+        }
+    }
+
+    std::ostringstream reply;
+    reply << eventHead(job.id, "result") << ",\"ok\":" << (filesOk ? "true" : "false")
+          << ",\"cancelled\":" << (response.cancelled ? "true" : "false")
+          << ",\"timed_out\":" << (response.timedOut ? "true" : "false")
+          << ",\"image_cached\":" << (imageCached ? "true" : "false")
+          << ",\"result_cached\":" << (response.cacheHit ? "true" : "false")
+          << ",\"width\":" << response.width << ",\"height\":" << response.height
+          << ",\"nails\":" << response.layout.size()
+          << ",\"load_seconds\":" << jsonNumber(loadSeconds)
+          << ",\"seconds\":" << jsonNumber(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count())
+          << ",\"rmse\":" << jsonNumber(response.metrics.rmse)
+          << ",\"psnr\":" << jsonNumber(response.metrics.psnr)
+          << ",\"ssim\":" << jsonNumber(response.metrics.ssim);
+    if (paletteMode) {
+        const StringArtGenerator::PaletteStringSequences& palette = response.paletteSequences;
+        reply << ",\"threads\":[";
+        for (size_t c = 0; c < palette.colors.size(); c++) {
+            reply << (c == 0 ? "" : ",") << "{\"color\":" << jsonString(palette.colors[c].hex())
+                  << ",\"name\":" << jsonString(palette.colors[c].name)
+                  << ",\"sequence\":" << jsonArray(palette.sequences[c]) << "}";
+        }
+        reply << "]";
+    } else if (job.request.colorMode) {
+        const StringArtGenerator::ColorStringSequences& color = response.colorSequences;
+        reply << ",\"color_order\":" << jsonString(job.request.colorOrder)
+              << ",\"cyan\":" << jsonArray(color.cyanSequence) << ",\"magenta\":" << jsonArray(color.magentaSequence)
+              << ",\"yellow\":" << jsonArray(color.yellowSequence) << ",\"black\":" << jsonArray(color.blackSequence);
+        if (!color.windingOrder.empty()) {
+            reply << ",\"winding_order\":" << jsonArray(color.windingOrder);
+        }
+    } else {
+        reply << ",\"sequence\":" << jsonArray(response.sequence);
+    }
+    if (!files.empty() || !filesOk) {
+        reply << ",\"files\":[";
+        for (size_t i = 0; i < files.size(); i++) {
+            reply << (i == 0 ? "" : ",") << jsonString(files[i]);
+        }
+        reply << "]";
+        if (!filesOk) reply << ",\"error\":\"Could not write every output file\"";
+    }
+    reply << "}";
+    sink.send(reply.str());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (filesOk) m_jobsDone++; else m_jobsFailed++;
+}
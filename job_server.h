@@ -0,0 +1,104 @@
+#pragma once
+
+#include "string_art_api.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <istream>
+#include <ostream>
+
+// Where one client's replies go: a line of JSON per call, safe to call from any worker
+class ReplySink {
+public:
+    virtual ~ReplySink() {}
+    virtual void send(const std::string& line) = 0;
+};
+
+// Long-lived job server: newline-delimited JSON requests in, JSON events out, one line each.
+//
+// Requests are flat objects. {"id": "a1", "input": "photo.png", "nails": 300, "strings": 2000}
+// runs a job; any field left out keeps the server's default (the command line options it was
+// started with). {"op": "cancel", "id": "a1"} stops a queued or running job, {"op": "stats"}
+// reports counters and {"op": "shutdown"} stops a socket server once queued jobs are done.
+//
+// Replies: "queued", "progress" (stage changes, and the string count every "progress" strings),
+// then "result" with the sequences and metrics, or "error".
+//
+// Each worker thread owns a StringArtEngine for the server's lifetime, so chord geometry stays
+// warm between jobs on the same layout and size. Decoded, resized images are shared by all
+// workers through a small LRU keyed by file, modification time and processing settings.
+class JobServer {
+public:
+    // workers <= 0 uses the hardware concurrency; imageCacheSize is the number of decoded images kept
+    JobServer(const StringArtRequest& defaults, int workers = 0, size_t imageCacheSize = 8);
+    ~JobServer();
+
+    JobServer(const JobServer&) = delete;
+    JobServer& operator=(const JobServer&) = delete;
+
+    // Serve one stream until end of input, then wait for its jobs. Returns 0.
+    int serveStream(std::istream& in, std::ostream& out);
+
+    // Serve clients on a Unix domain socket until a shutdown request. Returns 0, or 1 when the
+    // socket cannot be opened (or on Windows, which has no Unix sockets here).
+    int serveSocket(const std::string& path);
+
+    // Handle one request line; replies go to sink
+    void handleLine(const std::string& line, const std::shared_ptr<ReplySink>& sink);
+
+    // Block until every queued and running job has finished
+    void drain();
+
+private:
+    struct Job {
+        std::string id;
+        StringArtRequest request;
+        std::string input;
+        std::string svgFile;            // Optional outputs, written before the result is sent
+        std::string previewFile;
+        std::shared_ptr<ReplySink> sink;
+        std::shared_ptr<CancellationToken> cancel;
+    };
+
+    struct CachedImage {
+        std::string key;
+        std::shared_ptr<const ImageData> image;
+    };
+
+    void workerLoop();
+    void runJob(StringArtEngine& engine, Job& job);
+    bool parseJob(const std::string& line, Job& job, std::string& op, std::string& error) const;
+
+    // Decoded image for a job, from the cache or loaded through the worker's engine
+    std::shared_ptr<const ImageData> imageFor(StringArtEngine& engine, const Job& job, bool& cached);
+
+    StringArtRequest m_defaults;
+    size_t m_imageCacheSize;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;       // Signals workers: job queued or stopping
+    std::condition_variable m_idle;       // Signals drain(): a job finished
+    std::deque<std::unique_ptr<Job>> m_queue;
+    std::map<std::string, std::shared_ptr<CancellationToken>> m_active;   // Queued or running, by id
+    int m_running;
+    bool m_stop;
+    bool m_shutdown;                      // Shutdown requested by a client
+    int m_nextId;
+    long long m_jobsDone;
+    long long m_jobsFailed;
+
+    std::mutex m_imageMutex;
+    std::list<CachedImage> m_images;      // Most recently used first
+    long long m_imageHits;
+    long long m_imageMisses;
+
+    int m_listenFd;                       // Socket server only (-1 otherwise)
+
+    std::vector<std::thread> m_workers;   // Declared last: start after every other member is initialized
+};
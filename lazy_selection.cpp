@@ -0,0 +1,19 @@
+#include "lazy_selection.h"
+#include <limits>
+
+LazyChordSelector::LazyChordSelector(int nailCount, bool symmetricScores)
+    : m_nailCount(nailCount), m_symmetric(symmetricScores), m_bounds((size_t)nailCount * nailCount, std::numeric_limits<double>::infinity()),
+      m_evaluations(0), m_skipped(0) {}
+
+int64_t LazyChordSelector::evaluations() const {
+    return m_evaluations;
+}
+
+int64_t LazyChordSelector::skipped() const {
+    return m_skipped;
+}
+
+double LazyChordSelector::skippedFraction() const {
+    int64_t total = m_evaluations + m_skipped;
+    return total > 0 ? (double)m_skipped / total : 0.0;
+}
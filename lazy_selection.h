@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Lazy greedy (CELF) choice of the next nail. Coverage only ever grows, so a chord's score can only
+// fall between the times it is scored; the last score computed for a chord is an upper bound on its
+// score now. Candidates are taken best bound first and re-scored until the best fresh score beats
+// every remaining bound - those chords cannot win and are never traced.
+//
+// The choice is exactly the exhaustive scan's: the highest score, the lowest nail on a tie. That
+// holds for any score that never increases for a chord (the per-pixel and fixed-point models, plus
+// a constant per-chord bonus), not for the supersampled model, whose residual can go negative.
+//
+// symmetricScores: a chord scores the same from either nail, so a score bounds both directions. The
+// per-pixel heuristic samples from the nail the thread leaves, and its two directions can differ in
+// the last bit, so it keeps a bound per direction.
+class LazyChordSelector {
+public:
+    LazyChordSelector(int nailCount, bool symmetricScores);
+
+    // Best of candidates for a string from currentNail; -1 when there are none
+    template <typename ScoreFn>
+    int selectBest(int currentNail, const std::vector<int>& candidates, ScoreFn score, double& bestScore);
+
+    int64_t evaluations() const;
+    int64_t skipped() const;
+    double skippedFraction() const;
+
+private:
+    struct Entry {
+        double bound;
+        int nail;
+    };
+
+    // Top of the heap: highest bound, then lowest nail
+    static bool lowerPriority(const Entry& a, const Entry& b) {
+        return a.bound < b.bound || (a.bound == b.bound && a.nail > b.nail);
+    }
+
+    int m_nailCount;
+    bool m_symmetric;
+    std::vector<double> m_bounds;   // Last score per ordered pair; both orders in step when symmetric
+    std::vector<Entry> m_heap;
+    int64_t m_evaluations;
+    int64_t m_skipped;
+};
+
+template <typename ScoreFn>
+int LazyChordSelector::selectBest(int currentNail, const std::vector<int>& candidates, ScoreFn score, double& bestScore) {
+    const double* bounds = &m_bounds[(size_t)currentNail * m_nailCount];
+    m_heap.clear();
+    for (int nail : candidates) {
+        m_heap.push_back({bounds[nail], nail});
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), lowerPriority);
+
+    int bestNail = -1;
+    bestScore = -1.0;
+    while (!m_heap.empty()) {
+        const Entry& top = m_heap.front();
+        // Nothing left can score higher, or tie with a lower nail
+        if (bestNail != -1 && (top.bound < bestScore || (top.bound == bestScore && top.nail > bestNail))) {
+            break;
+        }
+
+        int nail = top.nail;
+        std::pop_heap(m_heap.begin(), m_heap.end(), lowerPriority);
+        m_heap.pop_back();
+
+        double value = score(nail);
+        m_bounds[(size_t)currentNail * m_nailCount + nail] = value;
+        if (m_symmetric) {
+            m_bounds[(size_t)nail * m_nailCount + currentNail] = value;
+        }
+        m_evaluations++;
+
+        if (value > bestScore || (value == bestScore && nail < bestNail)) {
+            bestScore = value;
+            bestNail = nail;
+        }
+    }
+
+    m_skipped += (int64_t)m_heap.size();
+    return bestNail;
+}
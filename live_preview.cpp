@@ -0,0 +1,145 @@
+#include "live_preview.h"
+#include "reconstruction.h"
+#include "image_processing.h"
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
+#endif
+
+LivePreview::LivePreview(const std::string& filename, const std::vector<std::pair<double, double>>& nails,
+                         int width, int height, double threadOpacity, int maxSide)
+    : m_filename(filename), m_png(false), m_pipe(false), m_width(width), m_height(height), m_opacity(threadOpacity),
+      m_hasPending(false), m_stop(false), m_framesWritten(0), m_framesSkipped(0) {
+    std::string ext = filename.substr(filename.find_last_of(".") + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    m_png = ext == "png";
+
+    std::error_code ec;
+    m_pipe = std::filesystem::is_fifo(filename, ec);
+    if (m_pipe) {
+        m_png = false;  // Pipes get a plain PGM stream
+#ifndef _WIN32
+        // A viewer closing the pipe mid-frame must fail the write, not kill the job
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+    }
+
+    // Downscale so each frame is cheap; a thinner thread at lower resolution keeps the same tone
+    double scale = std::min(1.0, (double)maxSide / std::max(width, height));
+    m_width = std::max(1, (int)(width * scale));
+    m_height = std::max(1, (int)(height * scale));
+    m_opacity = std::max(0.01, std::min(1.0, threadOpacity * scale));
+    for (const auto& nail : nails) {
+        m_nails.push_back({nail.first * scale, nail.second * scale});
+    }
+
+    m_thread = std::thread(&LivePreview::run, this);
+}
+
+LivePreview::~LivePreview() {
+    finish();
+}
+
+void LivePreview::finish() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void LivePreview::submit(const std::vector<int>& sequence) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_hasPending) {
+            m_framesSkipped++;  // The writer never got to the previous snapshot
+        }
+        m_pending = sequence;
+        m_hasPending = true;
+    }
+    m_wake.notify_one();
+}
+
+int LivePreview::framesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_framesWritten;
+}
+
+int LivePreview::framesSkipped() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_framesSkipped;
+}
+
+void LivePreview::run() {
+    std::vector<int> snapshot;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || m_hasPending; });
+            if (!m_hasPending) {
+                return;  // Stopped with nothing left to write
+            }
+            snapshot.swap(m_pending);
+            m_hasPending = false;
+        }
+
+        writeFrame(snapshot);
+    }
+}
+
+void LivePreview::writeFrame(const std::vector<int>& sequence) {
+    std::vector<unsigned char> gray = darknessToGray(renderSequenceDarkness(sequence, m_nails, m_width, m_height, m_opacity));
+
+    if (m_pipe) {
+#ifndef _WIN32
+        // Non-blocking open fails while nobody reads the pipe; the frame is dropped
+        int fd = open(m_filename.c_str(), O_WRONLY | O_NONBLOCK);
+        if (fd < 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_framesSkipped++;
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+        std::string header = "P5\n" + std::to_string(m_width) + " " + std::to_string(m_height) + "\n255\n";
+        bool ok = write(fd, header.data(), header.size()) == (ssize_t)header.size();
+        size_t offset = 0;
+        while (ok && offset < gray.size()) {
+            ssize_t written = write(fd, gray.data() + offset, gray.size() - offset);
+            ok = written > 0;
+            if (ok) offset += written;
+        }
+        close(fd);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok) m_framesWritten++; else m_framesSkipped++;
+#endif
+        return;
+    }
+
+    // Write under a temp name, then rename over the previous frame
+    std::string tempName = m_filename + ".part";
+    bool ok = m_png ? writePNG(tempName, gray, m_width, m_height, 1) : writePGM(tempName, gray, m_width, m_height, 1);
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tempName, m_filename, ec);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (ok && !ec) {
+        m_framesWritten++;
+    } else {
+        std::remove(tempName.c_str());
+        m_framesSkipped++;
+    }
+}
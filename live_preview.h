@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Progressive preview written while a solve runs. The solver hands over a copy of the sequence
+// with submit() and carries on; a background thread renders the latest copy at reduced size and
+// replaces the preview file. If the writer is still busy, newer snapshots overwrite the waiting
+// one, so the solver never blocks on rendering or disk I/O.
+//
+// Regular files are replaced atomically (written under a temp name, then renamed), so viewers
+// never see a half-written frame. A named pipe (POSIX FIFO) receives one PGM frame per update
+// and frames are skipped while no reader is attached.
+class LivePreview {
+public:
+    // Output format follows the extension: .png, anything else is PGM
+    LivePreview(const std::string& filename, const std::vector<std::pair<double, double>>& nails,
+                int width, int height, double threadOpacity, int maxSide = 256);
+
+    // Writes the last pending snapshot, then stops the writer thread (also done by the destructor)
+    void finish();
+    ~LivePreview();
+
+    LivePreview(const LivePreview&) = delete;
+    LivePreview& operator=(const LivePreview&) = delete;
+
+    void submit(const std::vector<int>& sequence);
+
+    int framesWritten() const;
+    int framesSkipped() const;
+
+private:
+    void run();
+    void writeFrame(const std::vector<int>& sequence);
+
+    std::string m_filename;
+    bool m_png;
+    bool m_pipe;
+    std::vector<std::pair<double, double>> m_nails;   // Scaled to the preview size
+    int m_width, m_height;
+    double m_opacity;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<int> m_pending;
+    bool m_hasPending;
+    bool m_stop;
+    int m_framesWritten;
+    int m_framesSkipped;
+
+    std::thread m_thread;   // Declared last: starts after every other member is initialized
+};
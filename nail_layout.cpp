@@ -0,0 +1,338 @@
+#include "nail_layout.h"
+#include "image_processing.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+const unsigned int SIDE_TOP = 1, SIDE_RIGHT = 2, SIDE_BOTTOM = 4, SIDE_LEFT = 8;
+
+} // namespace
+
+NailLayout::NailLayout() : m_shape(CIRCLE), m_sides(0) {}
+
+NailLayout NailLayout::circle(int width, int height, int numNails) {
+    NailLayout layout;
+    layout.m_shape = CIRCLE;
+
+    int centerX = width / 2;
+    int centerY = height / 2;
+    double radius = std::min(width, height) / 2.0 - 10;
+
+    for (int i = 0; i < numNails; i++) {
+        double angle = 2.0 * M_PI * i / numNails;
+        double x = centerX + radius * cos(angle);
+        double y = centerY + radius * sin(angle);
+        layout.m_nails.push_back({x, y});
+    }
+
+    return layout;
+}
+
+NailLayout NailLayout::rectangle(int width, int height, int numNails) {
+    NailLayout layout;
+    layout.m_shape = RECTANGLE;
+
+    std::vector<std::pair<double, double>>& nails = layout.m_nails;
+    std::vector<unsigned int>& sides = layout.m_sideMask;
+    int margin = 15;
+    int nailsPerSide = numNails / 4;
+
+    // Top side
+    for (int i = 0; i < nailsPerSide && (int)nails.size() < numNails; i++) {
+        double x = margin + (double)i * (width - 2 * margin) / std::max(1, nailsPerSide - 1);
+        nails.push_back({x, margin});
+        sides.push_back(SIDE_TOP | (i == 0 ? SIDE_LEFT : 0) | (i == nailsPerSide - 1 ? SIDE_RIGHT : 0));
+    }
+
+    // Right side
+    for (int i = 1; i < nailsPerSide && (int)nails.size() < numNails; i++) {
+        double y = margin + (double)i * (height - 2 * margin) / std::max(1, nailsPerSide - 1);
+        nails.push_back({width - margin, y});
+        sides.push_back(SIDE_RIGHT | (i == nailsPerSide - 1 ? SIDE_BOTTOM : 0));
+    }
+
+    // Bottom side
+    for (int i = nailsPerSide - 2; i >= 0 && (int)nails.size() < numNails; i--) {
+        double x = margin + (double)i * (width - 2 * margin) / std::max(1, nailsPerSide - 1);
+        nails.push_back({x, height - margin});
+        sides.push_back(SIDE_BOTTOM | (i == 0 ? SIDE_LEFT : 0));
+    }
+
+    // Left side
+    for (int i = nailsPerSide - 2; i > 0 && (int)nails.size() < numNails; i--) {
+        double y = margin + (double)i * (height - 2 * margin) / std::max(1, nailsPerSide - 1);
+        nails.push_back({margin, y});
+        sides.push_back(SIDE_LEFT);
+    }
+
+    return layout;
+}
+
+NailLayout NailLayout::ellipse(int width, int height, int numNails) {
+    NailLayout layout;
+    layout.m_shape = ELLIPSE;
+
+    double centerX = width / 2.0;
+    double centerY = height / 2.0;
+    double radiusX = width / 2.0 - 10;
+    double radiusY = height / 2.0 - 10;
+
+    // Space nails evenly by arc length (equal angles would bunch them at the narrow ends)
+    const int steps = 4096;
+    std::vector<double> arcLength(steps + 1, 0.0);
+    for (int s = 1; s <= steps; s++) {
+        double a0 = 2.0 * M_PI * (s - 1) / steps;
+        double a1 = 2.0 * M_PI * s / steps;
+        double dx = radiusX * (cos(a1) - cos(a0));
+        double dy = radiusY * (sin(a1) - sin(a0));
+        arcLength[s] = arcLength[s - 1] + sqrt(dx*dx + dy*dy);
+    }
+
+    double perimeter = arcLength[steps];
+    int s = 0;
+    for (int i = 0; i < numNails; i++) {
+        double targetLength = perimeter * i / numNails;
+        while (s < steps && arcLength[s + 1] < targetLength) s++;
+
+        double segment = arcLength[s + 1] - arcLength[s];
+        double frac = segment > 0.0 ? (targetLength - arcLength[s]) / segment : 0.0;
+        double angle = 2.0 * M_PI * (s + frac) / steps;
+        layout.m_nails.push_back({centerX + radiusX * cos(angle), centerY + radiusY * sin(angle)});
+    }
+
+    return layout;
+}
+
+NailLayout NailLayout::polygon(int width, int height, int numNails, int sides) {
+    NailLayout layout;
+    layout.m_shape = POLYGON;
+    layout.m_sides = sides;
+
+    // Regular polygon inscribed in the circular layout's circle, first vertex at angle 0
+    double centerX = width / 2;
+    double centerY = height / 2;
+    double radius = std::min(width, height) / 2.0 - 10;
+
+    std::vector<std::pair<double, double>> vertices;
+    for (int v = 0; v < sides; v++) {
+        double angle = 2.0 * M_PI * v / sides;
+        vertices.push_back({centerX + radius * cos(angle), centerY + radius * sin(angle)});
+    }
+
+    // Nails evenly spaced along the perimeter; a nail exactly on a vertex belongs to both sides
+    double sideLength = 2.0 * radius * sin(M_PI / sides);
+    double spacing = sideLength * sides / numNails;
+    for (int i = 0; i < numNails; i++) {
+        double distance = spacing * i;
+        int side = std::min(sides - 1, (int)(distance / sideLength));
+        double t = (distance - side * sideLength) / sideLength;
+
+        const std::pair<double, double>& a = vertices[side];
+        const std::pair<double, double>& b = vertices[(side + 1) % sides];
+        layout.m_nails.push_back({a.first + t * (b.first - a.first), a.second + t * (b.second - a.second)});
+
+        unsigned int mask = 1u << side;
+        if (t < 1e-9) mask |= 1u << ((side + sides - 1) % sides);
+        if (t > 1.0 - 1e-9) mask |= 1u << ((side + 1) % sides);
+        layout.m_sideMask.push_back(mask);
+    }
+
+    return layout;
+}
+
+bool NailLayout::loadCSV(const std::string& filename, int width, int height, NailLayout& layout) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cout << "Layout: Cannot open nail file: " << filename << std::endl;
+        return false;
+    }
+
+    NailLayout result;
+    result.m_shape = CUSTOM;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+        if (line.empty() || line[0] == '#') continue;
+
+        std::replace(line.begin(), line.end(), ';', ',');
+        size_t comma = line.find(',');
+        if (comma == std::string::npos) {
+            std::cout << "Layout: Expected x,y on line " << lineNumber << " of " << filename << std::endl;
+            return false;
+        }
+
+        try {
+            double x = std::stod(line.substr(0, comma));
+            double y = std::stod(line.substr(comma + 1));
+            if (x < 0.0 || x > 1.0 || y < 0.0 || y > 1.0) {
+                std::cout << "Layout: Coordinates must be normalized (0-1) on line " << lineNumber << std::endl;
+                return false;
+            }
+            result.m_nails.push_back({x * (width - 1), y * (height - 1)});
+        } catch (const std::exception&) {
+            // A header such as "x,y" is allowed before the first coordinate
+            if (!result.m_nails.empty()) {
+                std::cout << "Layout: Invalid number on line " << lineNumber << " of " << filename << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if (result.m_nails.size() < 3) {
+        std::cout << "Layout: Nail file needs at least 3 nails: " << filename << std::endl;
+        return false;
+    }
+
+    layout = result;
+    return true;
+}
+
+bool NailLayout::isValidSpec(const std::string& spec) {
+    if (spec == "circle" || spec == "rectangle" || spec == "ellipse" || spec == "polygon") return true;
+    if (spec.rfind("polygon:", 0) == 0) {
+        int sides = std::atoi(spec.substr(8).c_str());
+        return sides >= 3 && sides <= 32;  // one mask bit per side
+    }
+    return spec.rfind("csv:", 0) == 0 && spec.size() > 4;
+}
+
+std::string NailLayout::specShortCode(const std::string& spec) {
+    if (spec == "circle") return "c";
+    if (spec == "rectangle") return "r";
+    if (spec == "ellipse") return "e";
+    if (spec == "polygon") return "p6";
+    if (spec.rfind("polygon:", 0) == 0) return "p" + std::to_string(std::atoi(spec.substr(8).c_str()));
+    return "csv";
+}
+
+bool NailLayout::fromSpec(const std::string& spec, int width, int height, int numNails, NailLayout& layout) {
+    if (spec == "circle") {
+        layout = circle(width, height, numNails);
+    } else if (spec == "rectangle") {
+        layout = rectangle(width, height, numNails);
+    } else if (spec == "ellipse") {
+        layout = ellipse(width, height, numNails);
+    } else if (spec == "polygon") {
+        layout = polygon(width, height, numNails, 6);
+    } else if (spec.rfind("polygon:", 0) == 0 && isValidSpec(spec)) {
+        layout = polygon(width, height, numNails, std::atoi(spec.substr(8).c_str()));
+    } else if (spec.rfind("csv:", 0) == 0) {
+        return loadCSV(spec.substr(4), width, height, layout);
+    } else {
+        std::cout << "Layout: Unknown layout: " << spec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const std::vector<std::pair<double, double>>& NailLayout::positions() const {
+    return m_nails;
+}
+
+int NailLayout::size() const {
+    return (int)m_nails.size();
+}
+
+NailLayout::Shape NailLayout::shape() const {
+    return m_shape;
+}
+
+std::string NailLayout::shortCode() const {
+    switch (m_shape) {
+        case CIRCLE: return "c";
+        case RECTANGLE: return "r";
+        case ELLIPSE: return "e";
+        case POLYGON: return "p" + std::to_string(m_sides);
+        default: return "csv";
+    }
+}
+
+std::string NailLayout::displayName() const {
+    switch (m_shape) {
+        case CIRCLE: return "Circular";
+        case RECTANGLE: return "Rectangular";
+        case ELLIPSE: return "Elliptical";
+        case POLYGON: return "Polygon (" + std::to_string(m_sides) + " sides)";
+        default: return "Custom";
+    }
+}
+
+std::string NailLayout::shapeNoun() const {
+    switch (m_shape) {
+        case CIRCLE: return "circle";
+        case RECTANGLE: return "rectangle";
+        case ELLIPSE: return "ellipse";
+        case POLYGON: return std::to_string(m_sides) + "-sided polygon";
+        default: return "custom shape (see nail file)";
+    }
+}
+
+double NailLayout::diameter() const {
+    if (m_nails.empty()) return 0.0;
+
+    double cx = 0.0, cy = 0.0;
+    for (const auto& nail : m_nails) {
+        cx += nail.first;
+        cy += nail.second;
+    }
+    cx /= m_nails.size();
+    cy /= m_nails.size();
+
+    double maxDist = 0.0;
+    for (const auto& nail : m_nails) {
+        double dx = nail.first - cx;
+        double dy = nail.second - cy;
+        maxDist = std::max(maxDist, sqrt(dx*dx + dy*dy));
+    }
+    return 2.0 * maxDist;
+}
+
+std::vector<unsigned char> NailLayout::buildPairMask() const {
+    int n = size();
+    std::vector<unsigned char> allowed(n * n, 1);
+    for (int i = 0; i < n; i++) {
+        allowed[i * n + i] = 0;
+    }
+
+    if (m_sideMask.empty()) {
+        return allowed;
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if (m_sideMask[i] & m_sideMask[j]) {
+                allowed[i * n + j] = 0;
+            }
+        }
+    }
+    return allowed;
+}
+
+uint64_t NailLayout::fingerprint() const {
+    // FNV-1a over shape, count and the raw coordinate bits
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* data, size_t length) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < length; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    int shape = (int)m_shape;
+    int count = size();
+    mix(&shape, sizeof(shape));
+    mix(&count, sizeof(count));
+    for (const auto& nail : m_nails) {
+        double xy[2] = {nail.first, nail.second};
+        mix(xy, sizeof(xy));
+    }
+    return hash;
+}
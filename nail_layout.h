@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+
+// Nail positions for one board, in processing-image pixel coordinates (double precision).
+// Built once per job and shared read-only by the solvers, the SVG writer and the renderers.
+class NailLayout {
+public:
+    enum Shape {
+        CIRCLE,
+        RECTANGLE,
+        ELLIPSE,
+        POLYGON,
+        CUSTOM
+    };
+
+    NailLayout();
+
+    // Factory functions - same margins the solvers have always used
+    static NailLayout circle(int width, int height, int numNails);
+    static NailLayout rectangle(int width, int height, int numNails);
+    static NailLayout ellipse(int width, int height, int numNails);
+    static NailLayout polygon(int width, int height, int numNails, int sides);
+
+    // Custom layout from CSV: one "x,y" per line in normalized image coordinates (0-1).
+    // Blank lines, '#' comments and a non-numeric header line are ignored.
+    static bool loadCSV(const std::string& filename, int width, int height, NailLayout& layout);
+
+    // Build from a command-line spec: circle, rectangle, ellipse, polygon[:sides], csv:<file>
+    static bool fromSpec(const std::string& spec, int width, int height, int numNails, NailLayout& layout);
+
+    // Syntax check for a spec before an image is loaded
+    static bool isValidSpec(const std::string& spec);
+
+    // Filename code for a spec, matching shortCode() of the layout it builds
+    static std::string specShortCode(const std::string& spec);
+
+    const std::vector<std::pair<double, double>>& positions() const;
+    int size() const;
+    Shape shape() const;
+
+    // Naming used in filenames, instruction text and SVG descriptions
+    std::string shortCode() const;      // c, r, e, p6, csv
+    std::string displayName() const;    // Circular, Rectangular, ...
+    std::string shapeNoun() const;      // circle, rectangle, ...
+
+    // Twice the largest nail distance from the layout's centroid (the circle's diameter)
+    double diameter() const;
+
+    // numNails x numNails table of candidate chords: 0 for self-pairs and for pairs on the same
+    // straight side (rectangle, polygon), which run along the frame and can never help
+    std::vector<unsigned char> buildPairMask() const;
+
+    // Stable 64-bit hash of the exact nail coordinates, for keying per-layout caches
+    uint64_t fingerprint() const;
+
+private:
+    Shape m_shape;
+    int m_sides;                                    // Polygon side count
+    std::vector<std::pair<double, double>> m_nails;
+    std::vector<unsigned int> m_sideMask;           // Bit per straight side a nail lies on (empty = none)
+};
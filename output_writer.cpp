@@ -0,0 +1,135 @@
+#include "output_writer.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+OutputWriter::OutputWriter(FsyncPolicy fsyncPolicy, int capacity)
+    : m_fsyncPolicy(fsyncPolicy), m_capacity((size_t)std::max(1, capacity)), m_stop(false), m_filesWritten(0) {
+    m_thread = std::thread(&OutputWriter::run, this);
+}
+
+OutputWriter::~OutputWriter() {
+    finish();
+}
+
+bool OutputWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failures.empty();
+}
+
+void OutputWriter::submit(const std::string& filename, Job job) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_space.wait(lock, [this] { return m_queue.size() < m_capacity; });
+        m_queue.push_back({filename, std::move(job)});
+    }
+    m_wake.notify_one();
+}
+
+int OutputWriter::filesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_filesWritten;
+}
+
+std::vector<std::string> OutputWriter::failures() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failures;
+}
+
+bool OutputWriter::parsePolicy(const std::string& name, FsyncPolicy& policy) {
+    if (name == "none") {
+        policy = FSYNC_NONE;
+    } else if (name == "file") {
+        policy = FSYNC_FILE;
+    } else if (name == "end") {
+        policy = FSYNC_END;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* OutputWriter::policyName(FsyncPolicy policy) {
+    switch (policy) {
+        case FSYNC_FILE: return "file";
+        case FSYNC_END: return "end";
+        default: return "none";
+    }
+}
+
+void OutputWriter::run() {
+    while (true) {
+        Entry entry;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                break;  // Stopped and drained
+            }
+            entry = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_space.notify_one();
+
+        bool ok = entry.job();
+        if (ok && m_fsyncPolicy == FSYNC_FILE) {
+            ok = syncFile(entry.filename);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok) {
+            m_filesWritten++;
+            if (m_fsyncPolicy == FSYNC_END) {
+                m_written.push_back(entry.filename);
+            }
+        } else {
+            m_failures.push_back(entry.filename);
+        }
+    }
+
+    // Everything is on its way to disk; now wait for it once
+    std::vector<std::string> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pending.swap(m_written);
+    }
+    for (const std::string& filename : pending) {
+        if (!syncFile(filename)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_failures.push_back(filename);
+            m_filesWritten--;
+        }
+    }
+}
+
+bool OutputWriter::syncFile(const std::string& filename) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    bool ok = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return ok;
+#else
+    // Flushing through any descriptor commits the file's dirty pages
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// When written files are forced to stable storage
+enum FsyncPolicy {
+    FSYNC_NONE,     // Leave it to the OS (default)
+    FSYNC_FILE,     // After each file, before the next one is written
+    FSYNC_END       // All files once, when the writer finishes
+};
+
+// Asynchronous output stage. Finished results are queued as write jobs and a dedicated I/O
+// thread writes them in submission order, so the caller can decode and solve the next image
+// while the previous one's instructions, SVG and preview are still going to disk.
+//
+// The queue is bounded: submit() only blocks when capacity jobs are already waiting, which keeps
+// a slow disk from piling up results in memory. A failed job is recorded rather than reported
+// from the I/O thread; finish() returns false if anything failed and failures() names the files.
+class OutputWriter {
+public:
+    // A job writes one file and returns false on failure
+    typedef std::function<bool()> Job;
+
+    explicit OutputWriter(FsyncPolicy fsyncPolicy = FSYNC_NONE, int capacity = 8);
+
+    // Waits for queued jobs, applies the end-of-run fsync and stops the I/O thread
+    // (also done by the destructor). Returns true if every file was written.
+    bool finish();
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Queue a job that writes filename; blocks while the queue is full
+    void submit(const std::string& filename, Job job);
+
+    int filesWritten() const;
+    std::vector<std::string> failures() const;
+
+    static bool parsePolicy(const std::string& name, FsyncPolicy& policy);
+    static const char* policyName(FsyncPolicy policy);
+
+private:
+    struct Entry {
+        std::string filename;
+        Job job;
+    };
+
+    void run();
+    static bool syncFile(const std::string& filename);
+
+    FsyncPolicy m_fsyncPolicy;
+    size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;        // Signals the I/O thread: job queued or stopping
+    std::condition_variable m_space;       // Signals submitters: a slot is free
+    std::deque<Entry> m_queue;
+    bool m_stop;
+    int m_filesWritten;
+    std::vector<std::string> m_written;    // Kept for FSYNC_END
+    std::vector<std::string> m_failures;
+
+    std::thread m_thread;   // Declared last: starts after every other member is initialized
+};
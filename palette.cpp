@@ -0,0 +1,234 @@
+#include "palette.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cctype>
+#include <cstdlib>
+
+ThreadColor::ThreadColor() : r(0), g(0), b(0) {}
+
+ThreadColor::ThreadColor(unsigned char r, unsigned char g, unsigned char b, const std::string& name)
+    : r(r), g(g), b(b), name(name) {}
+
+std::string ThreadColor::hex() const {
+    char buffer[8];
+    std::snprintf(buffer, sizeof(buffer), "#%02x%02x%02x", r, g, b);
+    return buffer;
+}
+
+std::string ThreadColor::label() const {
+    return name.empty() ? hex() : name;
+}
+
+namespace {
+
+bool parseHexColor(std::string text, ThreadColor& color) {
+    if (!text.empty() && text[0] == '#') text = text.substr(1);
+    if (text.size() != 6) return false;
+    for (char c : text) {
+        if (!std::isxdigit((unsigned char)c)) return false;
+    }
+    long value = std::strtol(text.c_str(), nullptr, 16);
+    color.r = (unsigned char)(value >> 16);
+    color.g = (unsigned char)(value >> 8);
+    color.b = (unsigned char)value;
+    return true;
+}
+
+// Pixels this light in every channel count as bare paper
+const int PAPER_LEVEL = 230;
+
+int colorLuma(const ThreadColor& c) {
+    return (299 * c.r + 587 * c.g + 114 * c.b) / 1000;
+}
+
+} // namespace
+
+bool parsePalette(const std::string& spec, std::vector<ThreadColor>& colors, int& autoColors) {
+    colors.clear();
+    autoColors = 0;
+
+    if (spec == "auto" || spec.rfind("auto:", 0) == 0) {
+        autoColors = spec == "auto" ? 4 : std::atoi(spec.c_str() + 5);
+        return autoColors >= 1 && autoColors <= 16;
+    }
+
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string entry = spec.substr(start, end - start);
+
+        ThreadColor color;
+        size_t equals = entry.find('=');
+        if (equals != std::string::npos) {
+            color.name = entry.substr(0, equals);
+            entry = entry.substr(equals + 1);
+            // Names end up in SVG ids and file text: letters, digits, '-' and '_' only
+            for (char c : color.name) {
+                if (!std::isalnum((unsigned char)c) && c != '-' && c != '_') {
+                    colors.clear();
+                    return false;
+                }
+            }
+        }
+        if (!parseHexColor(entry, color)) {
+            colors.clear();
+            return false;
+        }
+        colors.push_back(color);
+        start = end + 1;
+    }
+    return !colors.empty() && colors.size() <= 16;
+}
+
+std::vector<ThreadColor> extractPalette(const std::vector<unsigned char>& rgb, int count, int maxSamples) {
+    std::vector<ThreadColor> palette;
+    size_t pixelCount = rgb.size() / 3;
+    if (count < 1 || pixelCount == 0) return palette;
+
+    // Planar samples on an even stride, paper left out
+    size_t step = std::max<size_t>(1, pixelCount / std::max(1, maxSamples));
+    std::vector<int32_t> sr, sg, sb;
+    for (size_t i = 0; i < pixelCount; i += step) {
+        const unsigned char* px = &rgb[i * 3];
+        if (px[0] >= PAPER_LEVEL && px[1] >= PAPER_LEVEL && px[2] >= PAPER_LEVEL) continue;
+        sr.push_back(px[0]);
+        sg.push_back(px[1]);
+        sb.push_back(px[2]);
+    }
+    int n = (int)sr.size();
+    if (n == 0) {
+        palette.emplace_back(0, 0, 0);   // A blank page still needs a thread
+        return palette;
+    }
+    const int32_t* channels[3] = {sr.data(), sg.data(), sb.data()};
+
+    // Median cut for the starting centers: split the box with the widest channel range at its median
+    struct Box { int begin, end; };
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++) order[i] = i;
+    std::vector<Box> boxes = {{0, n}};
+    while ((int)boxes.size() < count) {
+        int bestBox = -1, bestChannel = 0, bestRange = 0;
+        for (int bi = 0; bi < (int)boxes.size(); bi++) {
+            if (boxes[bi].end - boxes[bi].begin < 2) continue;
+            for (int c = 0; c < 3; c++) {
+                int lo = 255, hi = 0;
+                for (int k = boxes[bi].begin; k < boxes[bi].end; k++) {
+                    lo = std::min(lo, (int)channels[c][order[k]]);
+                    hi = std::max(hi, (int)channels[c][order[k]]);
+                }
+                if (hi - lo > bestRange) {
+                    bestRange = hi - lo;
+                    bestBox = bi;
+                    bestChannel = c;
+                }
+            }
+        }
+        if (bestBox < 0) break;   // Every box is a single color; fewer distinct colors than asked for
+
+        Box box = boxes[bestBox];
+        int mid = (box.begin + box.end) / 2;
+        const int32_t* channel = channels[bestChannel];
+        std::nth_element(order.begin() + box.begin, order.begin() + mid, order.begin() + box.end,
+                         [channel](int a, int b) { return channel[a] < channel[b]; });
+        boxes[bestBox] = {box.begin, mid};
+        boxes.push_back({mid, box.end});
+    }
+
+    int k = (int)boxes.size();
+    std::vector<int32_t> cr(k), cg(k), cb(k);
+    for (int c = 0; c < k; c++) {
+        int64_t sumR = 0, sumG = 0, sumB = 0;
+        for (int i = boxes[c].begin; i < boxes[c].end; i++) {
+            sumR += sr[order[i]];
+            sumG += sg[order[i]];
+            sumB += sb[order[i]];
+        }
+        int size = boxes[c].end - boxes[c].begin;
+        cr[c] = (int32_t)(sumR / size);
+        cg[c] = (int32_t)(sumG / size);
+        cb[c] = (int32_t)(sumB / size);
+    }
+
+    // Lloyd iterations. One center at a time over all samples: a branch-free min over int32 lanes.
+    std::vector<int32_t> bestDist(n), label(n, 0), previous(n, -1);
+    const int maxIterations = 12;
+    for (int iteration = 0; iteration < maxIterations; iteration++) {
+        std::fill(bestDist.begin(), bestDist.end(), INT32_MAX);
+        for (int c = 0; c < k; c++) {
+            const int32_t r0 = cr[c], g0 = cg[c], b0 = cb[c];
+            int32_t* dist = bestDist.data();
+            int32_t* lab = label.data();
+            for (int i = 0; i < n; i++) {
+                int32_t dr = sr[i] - r0, dg = sg[i] - g0, db = sb[i] - b0;
+                int32_t d = dr * dr + dg * dg + db * db;
+                bool closer = d < dist[i];
+                dist[i] = closer ? d : dist[i];
+                lab[i] = closer ? c : lab[i];
+            }
+        }
+        if (label == previous) break;
+        previous = label;
+
+        std::vector<int64_t> sumR(k, 0), sumG(k, 0), sumB(k, 0), members(k, 0);
+        for (int i = 0; i < n; i++) {
+            sumR[label[i]] += sr[i];
+            sumG[label[i]] += sg[i];
+            sumB[label[i]] += sb[i];
+            members[label[i]]++;
+        }
+        for (int c = 0; c < k; c++) {
+            if (members[c] == 0) continue;   // An empty cluster keeps its center
+            cr[c] = (int32_t)((sumR[c] + members[c] / 2) / members[c]);
+            cg[c] = (int32_t)((sumG[c] + members[c] / 2) / members[c]);
+            cb[c] = (int32_t)((sumB[c] + members[c] / 2) / members[c]);
+        }
+    }
+
+    for (int c = 0; c < k; c++) {
+        palette.emplace_back((unsigned char)cr[c], (unsigned char)cg[c], (unsigned char)cb[c]);
+    }
+    std::stable_sort(palette.begin(), palette.end(), [](const ThreadColor& a, const ThreadColor& b) {
+        return colorLuma(a) > colorLuma(b);
+    });
+    return palette;
+}
+
+std::vector<std::vector<unsigned char>> separatePalette(const std::vector<unsigned char>& rgb,
+                                                        const std::vector<ThreadColor>& palette) {
+    size_t pixelCount = rgb.size() / 3;
+    size_t colors = palette.size();
+    std::vector<std::vector<unsigned char>> planes(colors, std::vector<unsigned char>(pixelCount, 255));
+    std::vector<double> weights(colors);
+
+    for (size_t i = 0; i < pixelCount; i++) {
+        int r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+
+        // White paper is an implicit last entry that takes the rest of the pixel
+        int paperDist = (255 - r) * (255 - r) + (255 - g) * (255 - g) + (255 - b) * (255 - b);
+        if (paperDist == 0) continue;
+        double total = 1.0 / paperDist;
+        int exact = -1;
+        for (size_t c = 0; c < colors; c++) {
+            int dr = r - palette[c].r, dg = g - palette[c].g, db = b - palette[c].b;
+            int dist = dr * dr + dg * dg + db * db;
+            if (dist == 0) {
+                exact = (int)c;
+                break;
+            }
+            weights[c] = 1.0 / dist;
+            total += weights[c];
+        }
+
+        if (exact >= 0) {
+            planes[exact][i] = 0;
+            continue;
+        }
+        for (size_t c = 0; c < colors; c++) {
+            planes[c][i] = (unsigned char)(255 - (int)(255.0 * weights[c] / total + 0.5));
+        }
+    }
+    return planes;
+}
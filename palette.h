@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+// Thread palettes for color string art with the threads actually on the shelf instead of CMYK.
+// Each palette color gets its own density plane, solved like one CMYK channel.
+
+struct ThreadColor {
+    unsigned char r, g, b;
+    std::string name;   // Optional label from the palette spec (empty = use the hex code)
+
+    ThreadColor();
+    ThreadColor(unsigned char r, unsigned char g, unsigned char b, const std::string& name = "");
+
+    std::string hex() const;     // "#rrggbb"
+    std::string label() const;   // Name if given, else the hex code
+};
+
+// Palette spec: "auto[:N]" (N colors from the image, default 4) or a comma list of thread colors,
+// each "rrggbb", "#rrggbb" or "name=rrggbb" (names: letters, digits, '-', '_'). Colors are wound,
+// and layered, in the order given. Up to 16 colors.
+// autoColors is set to N for an automatic palette (colors left empty), else to 0.
+bool parsePalette(const std::string& spec, std::vector<ThreadColor>& colors, int& autoColors);
+
+// Automatic palette: k-means over a subsample of at most maxSamples pixels of interleaved RGB,
+// started from a median cut. Paper-white pixels are left out (the paper is the background, not a
+// thread). Integer distances over planar sample arrays, so the inner loop vectorizes. Colors come
+// back light to dark, the order in which they are best wound.
+std::vector<ThreadColor> extractPalette(const std::vector<unsigned char>& rgb, int count, int maxSamples = 4096);
+
+// Density plane per palette color, in the same convention as the CMYK planes (255 = no thread,
+// 0 = fully covered). Each pixel is split between the threads and the white paper by inverse
+// squared color distance, so a pixel matching a thread goes entirely to it.
+std::vector<std::vector<unsigned char>> separatePalette(const std::vector<unsigned char>& rgb,
+                                                        const std::vector<ThreadColor>& palette);
@@ -0,0 +1,290 @@
+#include "reconstruction.h"
+#include <fstream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+ReconstructionMetrics::ReconstructionMetrics() : rmse(0.0), psnr(0.0), ssim(0.0) {}
+
+double threadOpacityForPaper(const std::string& threadThickness, int imgWidth, int imgHeight, double paperWidth, double paperHeight) {
+    double threadMM = std::atof(threadThickness.c_str());
+    if (threadMM <= 0.0) threadMM = 0.1;  // hairline default, same as the SVG writer
+
+    // Same scale the SVG writer uses: image plus 20px border each side fitted into the paper
+    double scale = std::min(paperWidth / (imgWidth + 40), paperHeight / (imgHeight + 40));
+    if (scale <= 0.0) return DEFAULT_THREAD_OPACITY;
+
+    double opacity = threadMM / scale;  // Fraction of a pixel the thread covers
+    return std::clamp(opacity, 0.02, 1.0);
+}
+
+// Xiaolin Wu anti-aliased line walk. Calls plot(pixelIndex, coverage) for every touched pixel,
+// coverage in (0, 1]. Each pixel is visited at most twice per line (once per side of the ideal line).
+template <typename PlotFn>
+static void traceLineAA(double x0, double y0, double x1, double y1, int width, int height, PlotFn plot) {
+    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    double gradient = dx < 1e-9 ? 1.0 : dy / dx;
+
+    auto emit = [&](int major, int minor, double coverage) {
+        if (coverage <= 0.0) return;
+        int x = steep ? minor : major;
+        int y = steep ? major : minor;
+        if (x < 0 || x >= width || y < 0 || y >= height) return;
+        plot(y * width + x, coverage);
+    };
+
+    int xStart = (int)std::round(x0);
+    int xEnd = (int)std::round(x1);
+    double intery = y0 + gradient * (xStart - x0);
+
+    for (int x = xStart; x <= xEnd; x++) {
+        int yBase = (int)std::floor(intery);
+        double frac = intery - yBase;
+        emit(x, yBase, 1.0 - frac);
+        emit(x, yBase + 1, frac);
+        intery += gradient;
+    }
+}
+
+void traceChordAA(double x0, double y0, double x1, double y1, int width, int height, std::vector<std::pair<int, float>>& out) {
+    traceLineAA(x0, y0, x1, y1, width, height, [&](int idx, double coverage) {
+        out.push_back({idx, (float)coverage});
+    });
+}
+
+std::vector<float> renderSequenceDarkness(const std::vector<int>& sequence, const std::vector<std::pair<double, double>>& nails,
+                                          int width, int height, double threadOpacity) {
+    // Accumulate transmittance (fraction of paper still visible) and convert at the end
+    std::vector<float> transmittance(width * height, 1.0f);
+    float opacity = (float)threadOpacity;
+
+    for (size_t i = 0; i + 1 < sequence.size(); i++) {
+        int nail1 = sequence[i];
+        int nail2 = sequence[i + 1];
+        if (nail1 < 0 || nail2 < 0 || nail1 >= (int)nails.size() || nail2 >= (int)nails.size()) continue;
+
+        traceLineAA(nails[nail1].first, nails[nail1].second, nails[nail2].first, nails[nail2].second, width, height,
+                    [&](int idx, double coverage) {
+                        transmittance[idx] *= 1.0f - opacity * (float)coverage;
+                    });
+    }
+
+    for (float& t : transmittance) {
+        t = 1.0f - t;
+    }
+    return transmittance;
+}
+
+// Thread colors as RGB, matching the SVG stroke colors
+static void threadColorRGB(char colorLetter, float rgb[3]) {
+    switch (colorLetter) {
+        case 'C': rgb[0] = 0.0f; rgb[1] = 1.0f;   rgb[2] = 1.0f; break;
+        case 'M': rgb[0] = 1.0f; rgb[1] = 0.0f;   rgb[2] = 1.0f; break;
+        case 'Y': rgb[0] = 1.0f; rgb[1] = 0.84f;  rgb[2] = 0.0f; break;  // "gold"
+        default:  rgb[0] = 0.0f; rgb[1] = 0.0f;   rgb[2] = 0.0f; break;
+    }
+}
+
+// Lay one thread's strings over an RGB canvas; later threads cover earlier ones
+static void layThreadOnCanvas(std::vector<float>& canvas, const std::vector<int>& sequence, const float rgb[3],
+                              const std::vector<std::pair<double, double>>& nails, int width, int height, float opacity) {
+    for (size_t i = 0; i + 1 < sequence.size(); i++) {
+        int nail1 = sequence[i];
+        int nail2 = sequence[i + 1];
+        if (nail1 < 0 || nail2 < 0 || nail1 >= (int)nails.size() || nail2 >= (int)nails.size()) continue;
+
+        traceLineAA(nails[nail1].first, nails[nail1].second, nails[nail2].first, nails[nail2].second, width, height,
+                    [&](int idx, double coverage) {
+                        float alpha = opacity * (float)coverage;
+                        float* px = &canvas[idx * 3];
+                        px[0] += (rgb[0] - px[0]) * alpha;
+                        px[1] += (rgb[1] - px[1]) * alpha;
+                        px[2] += (rgb[2] - px[2]) * alpha;
+                    });
+    }
+}
+
+static std::vector<unsigned char> canvasToRGB(const std::vector<float>& canvas) {
+    std::vector<unsigned char> pixels(canvas.size());
+    for (size_t i = 0; i < canvas.size(); i++) {
+        pixels[i] = (unsigned char)std::lround(std::clamp(canvas[i], 0.0f, 1.0f) * 255.0f);
+    }
+    return pixels;
+}
+
+std::vector<unsigned char> renderColorPreview(const StringArtGenerator::ColorStringSequences& colorSequences, const std::string& colorOrder,
+                                              const std::vector<std::pair<double, double>>& nails, int width, int height,
+                                              double threadOpacity) {
+    std::vector<float> canvas(width * height * 3, 1.0f);
+
+    for (char colorLetter : colorOrder) {
+        float rgb[3];
+        threadColorRGB(colorLetter, rgb);
+        layThreadOnCanvas(canvas, StringArtGenerator::getSequenceForColor(colorLetter, colorSequences), rgb, nails,
+                          width, height, (float)threadOpacity);
+    }
+    return canvasToRGB(canvas);
+}
+
+std::vector<unsigned char> renderPalettePreview(const StringArtGenerator::PaletteStringSequences& paletteSequences,
+                                                const std::vector<std::pair<double, double>>& nails, int width, int height,
+                                                double threadOpacity) {
+    std::vector<float> canvas(width * height * 3, 1.0f);
+
+    for (size_t c = 0; c < paletteSequences.colors.size() && c < paletteSequences.sequences.size(); c++) {
+        const ThreadColor& color = paletteSequences.colors[c];
+        float rgb[3] = {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f};
+        layThreadOnCanvas(canvas, paletteSequences.sequences[c], rgb, nails, width, height, (float)threadOpacity);
+    }
+    return canvasToRGB(canvas);
+}
+
+std::vector<unsigned char> darknessToGray(const std::vector<float>& darkness) {
+    std::vector<unsigned char> gray(darkness.size());
+    for (size_t i = 0; i < darkness.size(); i++) {
+        gray[i] = (unsigned char)std::lround((1.0f - std::clamp(darkness[i], 0.0f, 1.0f)) * 255.0f);
+    }
+    return gray;
+}
+
+double computeReconstructionRMSE(const ImageData& target, const std::vector<float>& renderedDarkness,
+                                 const unsigned char* importance) {
+    size_t count = std::min(target.data.size(), renderedDarkness.size());
+    if (count == 0) return 0.0;
+
+    double sumSq = 0.0;
+    double totalWeight = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double targetDarkness = (255.0 - target.data[i]) / 255.0;
+        double diff = targetDarkness - renderedDarkness[i];
+        double weight = importance ? importance[i] / 255.0 : 1.0;
+        sumSq += weight * diff * diff;
+        totalWeight += weight;
+    }
+    return totalWeight > 0.0 ? std::sqrt(sumSq / totalWeight) : 0.0;
+}
+
+double computeReconstructionRMSE(const ImageData& target, const std::vector<int>& sequence,
+                                 const std::vector<std::pair<double, double>>& nails, double threadOpacity,
+                                 const unsigned char* importance) {
+    std::vector<float> rendered = renderSequenceDarkness(sequence, nails, target.width, target.height, threadOpacity);
+    return computeReconstructionRMSE(target, rendered, importance);
+}
+
+// Luminance plane of an 8-bit gray or RGB buffer
+static std::vector<double> luminancePlane(const std::vector<unsigned char>& pixels, int count, int channels) {
+    std::vector<double> plane(count);
+    for (int i = 0; i < count; i++) {
+        if (channels == 1) {
+            plane[i] = pixels[i];
+        } else {
+            plane[i] = 0.299 * pixels[i * 3] + 0.587 * pixels[i * 3 + 1] + 0.114 * pixels[i * 3 + 2];
+        }
+    }
+    return plane;
+}
+
+// Mean SSIM over all 8x8 windows, using summed-area tables so every window costs O(1)
+static double computeSSIM(const std::vector<double>& a, const std::vector<double>& b, int width, int height) {
+    const int window = 8;
+    if (width < window || height < window) return 1.0;
+
+    int stride = width + 1;
+    std::vector<double> sumA(stride * (height + 1), 0.0), sumB(sumA), sumAA(sumA), sumBB(sumA), sumAB(sumA);
+
+    for (int y = 0; y < height; y++) {
+        double rowA = 0, rowB = 0, rowAA = 0, rowBB = 0, rowAB = 0;
+        for (int x = 0; x < width; x++) {
+            double va = a[y * width + x];
+            double vb = b[y * width + x];
+            rowA += va; rowB += vb;
+            rowAA += va * va; rowBB += vb * vb; rowAB += va * vb;
+
+            int idx = (y + 1) * stride + (x + 1);
+            int above = y * stride + (x + 1);
+            sumA[idx] = sumA[above] + rowA;
+            sumB[idx] = sumB[above] + rowB;
+            sumAA[idx] = sumAA[above] + rowAA;
+            sumBB[idx] = sumBB[above] + rowBB;
+            sumAB[idx] = sumAB[above] + rowAB;
+        }
+    }
+
+    auto boxSum = [&](const std::vector<double>& table, int x, int y) {
+        return table[(y + window) * stride + (x + window)] - table[y * stride + (x + window)]
+             - table[(y + window) * stride + x] + table[y * stride + x];
+    };
+
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    const double n = window * window;
+
+    double total = 0.0;
+    long long windows = 0;
+    for (int y = 0; y + window <= height; y++) {
+        for (int x = 0; x + window <= width; x++) {
+            double meanA = boxSum(sumA, x, y) / n;
+            double meanB = boxSum(sumB, x, y) / n;
+            double varA = boxSum(sumAA, x, y) / n - meanA * meanA;
+            double varB = boxSum(sumBB, x, y) / n - meanB * meanB;
+            double covAB = boxSum(sumAB, x, y) / n - meanA * meanB;
+
+            total += ((2 * meanA * meanB + c1) * (2 * covAB + c2)) /
+                     ((meanA * meanA + meanB * meanB + c1) * (varA + varB + c2));
+            windows++;
+        }
+    }
+    return total / windows;
+}
+
+ReconstructionMetrics computeReconstructionMetrics(const std::vector<unsigned char>& target, const std::vector<unsigned char>& rendered,
+                                                   int width, int height, int channels) {
+    ReconstructionMetrics metrics;
+    size_t count = (size_t)width * height * channels;
+    if (count == 0 || target.size() < count || rendered.size() < count) return metrics;
+
+    double sumSq = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double diff = ((double)target[i] - rendered[i]) / 255.0;
+        sumSq += diff * diff;
+    }
+    metrics.rmse = std::sqrt(sumSq / count);
+    metrics.psnr = metrics.rmse > 0.0 ? 20.0 * std::log10(1.0 / metrics.rmse) : 99.0;
+
+    metrics.ssim = computeSSIM(luminancePlane(target, width * height, channels),
+                               luminancePlane(rendered, width * height, channels), width, height);
+    return metrics;
+}
+
+bool writePreviewImage(const std::string& filename, const std::vector<unsigned char>& pixels, int width, int height, int channels) {
+    std::string ext = filename.substr(filename.find_last_of(".") + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    if (ext == "pgm" || ext == "ppm") {
+        return writePGM(filename, pixels, width, height, channels);
+    }
+    return writePNG(filename, pixels, width, height, channels);
+}
+
+bool writeMetricsFile(const std::string& filename, const ReconstructionMetrics& metrics, int numStrings, double threadOpacity) {
+    std::ofstream file(filename);
+    if (!file.is_open()) return false;
+
+    file << "strings: " << numStrings << "\n";
+    file << "thread_opacity: " << threadOpacity << "\n";
+    file << "rmse: " << metrics.rmse << "\n";
+    file << "psnr_db: " << metrics.psnr << "\n";
+    file << "ssim: " << metrics.ssim << "\n";
+    return file.good();
+}
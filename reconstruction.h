@@ -0,0 +1,64 @@
+#pragma once
+
+#include "image_processing.h"
+#include "string_art_generator.h"
+#include <vector>
+#include <string>
+#include <utility>
+
+// Default darkness a single pass of thread adds to a pixel it fully covers
+const double DEFAULT_THREAD_OPACITY = 0.25;
+
+// Objective quality of a rendered sequence against the processed image
+struct ReconstructionMetrics {
+    double rmse;   // Root-mean-square error on a 0-1 intensity scale
+    double psnr;   // Peak signal-to-noise ratio in dB
+    double ssim;   // Mean structural similarity over 8x8 windows (1.0 = identical)
+
+    ReconstructionMetrics();
+};
+
+// Per-pass opacity matching the physical thread width relative to one processing pixel on the chosen paper
+double threadOpacityForPaper(const std::string& threadThickness, int imgWidth, int imgHeight, double paperWidth, double paperHeight);
+
+// Anti-aliased footprint of one chord: (pixel index, coverage) pairs are appended to out.
+// This is the exact footprint renderSequenceDarkness uses, so callers can update renders incrementally.
+void traceChordAA(double x0, double y0, double x1, double y1, int width, int height, std::vector<std::pair<int, float>>& out);
+
+// Render a nail sequence as anti-aliased thread darkness (0=white, 1=black), one value per pixel.
+// Overlapping passes combine multiplicatively, 1 - (1 - opacity)^n, so dense areas saturate like real thread.
+std::vector<float> renderSequenceDarkness(const std::vector<int>& sequence, const std::vector<std::pair<double, double>>& nails,
+                                          int width, int height, double threadOpacity = DEFAULT_THREAD_OPACITY);
+
+// Render CMYK sequences onto white as RGB, laying threads down in the given color order
+std::vector<unsigned char> renderColorPreview(const StringArtGenerator::ColorStringSequences& colorSequences, const std::string& colorOrder,
+                                              const std::vector<std::pair<double, double>>& nails, int width, int height,
+                                              double threadOpacity = DEFAULT_THREAD_OPACITY);
+
+// Same for palette sequences, each in its real thread color, in palette order
+std::vector<unsigned char> renderPalettePreview(const StringArtGenerator::PaletteStringSequences& paletteSequences,
+                                                const std::vector<std::pair<double, double>>& nails, int width, int height,
+                                                double threadOpacity = DEFAULT_THREAD_OPACITY);
+
+// Convert a darkness buffer to 8-bit grayscale (255 = white)
+std::vector<unsigned char> darknessToGray(const std::vector<float>& darkness);
+
+// Root-mean-square error between target darkness (from grayscale data) and a rendered darkness buffer.
+// With an importance map (0-255 per pixel) each pixel's error is weighted by its importance.
+double computeReconstructionRMSE(const ImageData& target, const std::vector<float>& renderedDarkness,
+                                 const unsigned char* importance = nullptr);
+
+// Convenience: render and score a sequence in one call
+double computeReconstructionRMSE(const ImageData& target, const std::vector<int>& sequence,
+                                 const std::vector<std::pair<double, double>>& nails, double threadOpacity = DEFAULT_THREAD_OPACITY,
+                                 const unsigned char* importance = nullptr);
+
+// Full metrics between two 8-bit images of the same size (channels: 1 = gray, 3 = RGB; SSIM uses luminance)
+ReconstructionMetrics computeReconstructionMetrics(const std::vector<unsigned char>& target, const std::vector<unsigned char>& rendered,
+                                                   int width, int height, int channels);
+
+// Write a preview image, format chosen by extension (.png, .pgm/.ppm)
+bool writePreviewImage(const std::string& filename, const std::vector<unsigned char>& pixels, int width, int height, int channels);
+
+// Write metrics as simple "key: value" lines
+bool writeMetricsFile(const std::string& filename, const ReconstructionMetrics& metrics, int numStrings, double threadOpacity);
@@ -0,0 +1,274 @@
+#include "result_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+
+const char* ENTRY_MAGIC = "string-art-result 1";
+const char* ENTRY_EXTENSION = ".result";
+
+const uint64_t LANE_A_MUL = 0x9E3779B97F4A7C15ull;
+const uint64_t LANE_B_MUL = 0xC2B2AE3D27D4EB4Full;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t finalMix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+void writeList(std::ostream& out, const std::vector<int>& values) {
+    out << values.size();
+    for (int value : values) out << ' ' << value;
+    out << '\n';
+}
+
+bool readList(std::istringstream& in, std::vector<int>& values) {
+    size_t count = 0;
+    if (!(in >> count)) return false;
+    values.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        if (!(in >> values[i])) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+ContentHash::ContentHash() : m_a(0x243F6A8885A308D3ull), m_b(0x13198A2E03707344ull) {}
+
+void ContentHash::mixWord(uint64_t word) {
+    m_a = rotl(m_a ^ word, 31) * LANE_A_MUL;
+    m_b = rotl(m_b + word, 27) * LANE_B_MUL;
+}
+
+void ContentHash::add(const void* data, size_t bytes) {
+    mixWord((uint64_t)bytes);
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    size_t words = bytes / 8;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        std::memcpy(&word, p + i * 8, 8);
+        mixWord(word);
+    }
+    if (bytes % 8) {
+        uint64_t tail = 0;
+        std::memcpy(&tail, p + words * 8, bytes % 8);
+        mixWord(tail);
+    }
+}
+
+void ContentHash::add(const std::string& text) {
+    add(text.data(), text.size());
+}
+
+void ContentHash::add(int64_t value) {
+    add(&value, sizeof(value));
+}
+
+void ContentHash::add(double value) {
+    add(&value, sizeof(value));
+}
+
+std::string ContentHash::hex() const {
+    char buffer[33];
+    std::snprintf(buffer, sizeof(buffer), "%016llx%016llx", (unsigned long long)finalMix(m_a ^ rotl(m_b, 17)),
+                  (unsigned long long)finalMix(m_b ^ m_a));
+    return buffer;
+}
+
+CachedResult::CachedResult() : kind(GRAYSCALE) {}
+
+ResultCache::ResultCache() : m_maxBytes(DEFAULT_MAX_BYTES), m_hits(0), m_misses(0) {}
+
+void ResultCache::configure(const std::string& dir, size_t maxBytes) {
+    m_dir = dir;
+    m_maxBytes = maxBytes;
+    if (!m_dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(m_dir, ec);
+    }
+}
+
+bool ResultCache::enabled() const {
+    return !m_dir.empty();
+}
+
+long long ResultCache::hits() const {
+    return m_hits;
+}
+
+long long ResultCache::misses() const {
+    return m_misses;
+}
+
+std::string ResultCache::entryPath(const std::string& key) const {
+    return (std::filesystem::path(m_dir) / (key + ENTRY_EXTENSION)).string();
+}
+
+bool ResultCache::load(const std::string& key, CachedResult& result) {
+    if (!enabled()) return false;
+
+    std::ifstream file(entryPath(key));
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line) || line != ENTRY_MAGIC) {
+        m_misses++;
+        return false;
+    }
+
+    CachedResult entry;
+    bool complete = false;
+    bool ok = true;
+    while (ok && std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string tag;
+        in >> tag;
+        if (tag == "kind") {
+            std::string kind;
+            in >> kind;
+            entry.kind = kind == "palette" ? CachedResult::PALETTE : kind == "cmyk" ? CachedResult::CMYK : CachedResult::GRAYSCALE;
+        } else if (tag == "sequence") {
+            ok = readList(in, entry.sequence);
+        } else if (tag == "C") {
+            ok = readList(in, entry.colorSequences.cyanSequence);
+        } else if (tag == "M") {
+            ok = readList(in, entry.colorSequences.magentaSequence);
+        } else if (tag == "Y") {
+            ok = readList(in, entry.colorSequences.yellowSequence);
+        } else if (tag == "K") {
+            ok = readList(in, entry.colorSequences.blackSequence);
+        } else if (tag == "W") {
+            ok = readList(in, entry.colorSequences.windingOrder);
+        } else if (tag == "thread") {
+            // thread <r> <g> <b> <name or -> <count> <nails...>
+            int r, g, b;
+            std::string name;
+            std::vector<int> sequence;
+            ok = (bool)(in >> r >> g >> b >> name) && readList(in, sequence);
+            entry.paletteSequences.colors.emplace_back((unsigned char)r, (unsigned char)g, (unsigned char)b, name == "-" ? "" : name);
+            entry.paletteSequences.sequences.push_back(sequence);
+        } else if (tag == "end") {
+            complete = true;
+            break;
+        }
+    }
+    if (!ok || !complete) {
+        m_misses++;
+        return false;   // Truncated or damaged; the next store replaces it
+    }
+
+    StringArtGenerator::ColorStringSequences& color = entry.colorSequences;
+    color.totalStrings = (int)(color.cyanSequence.size() + color.magentaSequence.size() + color.yellowSequence.size() +
+                               color.blackSequence.size());
+    for (const std::vector<int>& sequence : entry.paletteSequences.sequences) {
+        entry.paletteSequences.totalStrings += (int)sequence.size();
+    }
+
+    // Refresh the entry's age for eviction
+    std::error_code ec;
+    std::filesystem::last_write_time(entryPath(key), std::filesystem::file_time_type::clock::now(), ec);
+
+    result = std::move(entry);
+    m_hits++;
+    return true;
+}
+
+bool ResultCache::store(const std::string& key, const CachedResult& result) {
+    if (!enabled()) return false;
+
+    std::string filename = entryPath(key);
+    // Unique temp name so concurrent writers of the same key cannot interleave
+    std::string tempName = filename + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+                           "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(tempName);
+        if (!file.is_open()) return false;
+
+        file << ENTRY_MAGIC << '\n';
+        if (result.kind == CachedResult::PALETTE) {
+            file << "kind palette\n";
+            const StringArtGenerator::PaletteStringSequences& palette = result.paletteSequences;
+            for (size_t c = 0; c < palette.colors.size() && c < palette.sequences.size(); c++) {
+                const ThreadColor& color = palette.colors[c];
+                file << "thread " << (int)color.r << ' ' << (int)color.g << ' ' << (int)color.b << ' '
+                     << (color.name.empty() ? "-" : color.name) << ' ';
+                writeList(file, palette.sequences[c]);
+            }
+        } else if (result.kind == CachedResult::CMYK) {
+            file << "kind cmyk\n";
+            const StringArtGenerator::ColorStringSequences& color = result.colorSequences;
+            file << "C ";
+            writeList(file, color.cyanSequence);
+            file << "M ";
+            writeList(file, color.magentaSequence);
+            file << "Y ";
+            writeList(file, color.yellowSequence);
+            file << "K ";
+            writeList(file, color.blackSequence);
+            file << "W ";
+            writeList(file, color.windingOrder);
+        } else {
+            file << "kind gray\n";
+            file << "sequence ";
+            writeList(file, result.sequence);
+        }
+        file << "end\n";
+
+        if (!file.good()) {
+            file.close();
+            std::remove(tempName.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempName, filename, ec);
+    if (ec) {
+        std::remove(tempName.c_str());
+        return false;
+    }
+    evict();
+    return true;
+}
+
+void ResultCache::evict() {
+    struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(m_dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ENTRY_EXTENSION) continue;
+        std::error_code entryError;
+        Entry entry = {it->path(), it->last_write_time(entryError), it->file_size(entryError)};
+        if (entryError) continue;
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    if (total <= m_maxBytes) return;
+
+    // Oldest first; another process may already have removed some of them
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (const Entry& entry : entries) {
+        if (total <= m_maxBytes) break;
+        std::filesystem::remove(entry.path, ec);
+        total -= entry.size;
+    }
+}
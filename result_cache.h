@@ -0,0 +1,70 @@
+#pragma once
+
+#include "string_art_generator.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// 128-bit content hash for cache keys: two multiply-rotate lanes over 8-byte words, so hashing
+// a processing-size image takes a fraction of a millisecond. Every add() is length-prefixed, so
+// ("ab", "c") and ("a", "bc") hash differently. Not cryptographic.
+class ContentHash {
+public:
+    ContentHash();
+
+    void add(const void* data, size_t bytes);
+    void add(const std::string& text);
+    void add(int64_t value);
+    void add(double value);
+
+    std::string hex() const;   // 32 hex digits
+
+private:
+    void mixWord(uint64_t word);
+
+    uint64_t m_a, m_b;
+};
+
+// Sequences of one finished run: grayscale, CMYK or palette
+struct CachedResult {
+    enum Kind { GRAYSCALE, CMYK, PALETTE };
+
+    Kind kind;
+    std::vector<int> sequence;
+    StringArtGenerator::ColorStringSequences colorSequences;
+    StringArtGenerator::PaletteStringSequences paletteSequences;
+
+    CachedResult();
+};
+
+// Content-addressed result cache on local disk. Each entry is one small text file named after its
+// key (a ContentHash of the processed pixels and every setting that changes the result). Entries
+// are written under a temporary name and renamed into place, so several processes or server
+// workers can share a directory. A hit refreshes the entry's modification time; when the
+// directory grows past maxBytes the least recently used entries are deleted.
+class ResultCache {
+public:
+    ResultCache();   // Disabled until configured
+
+    // Empty directory disables the cache; the directory is created if needed
+    void configure(const std::string& dir, size_t maxBytes);
+    bool enabled() const;
+
+    bool load(const std::string& key, CachedResult& result);
+    bool store(const std::string& key, const CachedResult& result);
+
+    long long hits() const;
+    long long misses() const;
+
+    static const size_t DEFAULT_MAX_BYTES = 256u * 1024u * 1024u;
+
+private:
+    std::string entryPath(const std::string& key) const;
+    void evict();
+
+    std::string m_dir;
+    size_t m_maxBytes;
+    long long m_hits;
+    long long m_misses;
+};
@@ -0,0 +1,153 @@
+#include "roi.h"
+#include "image_processing.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Gray-level distance from the background that marks a pixel as subject
+const int BACKGROUND_TOLERANCE = 24;
+// Central-difference gradient (sum of both axes) that marks an edge
+const int EDGE_THRESHOLD = 40;
+// Less than this share of the image important means the mask found nothing useful
+const double MIN_SUBJECT_SHARE = 0.02;
+// Subject pieces smaller than this share are background texture or noise
+const double MIN_PIECE_SHARE = 0.0025;
+
+int borderMedian(const std::vector<unsigned char>& gray, int width, int height) {
+    int histogram[256] = {0};
+    int count = 0;
+    for (int x = 0; x < width; x++) {
+        histogram[gray[x]]++;
+        histogram[gray[(height - 1) * width + x]]++;
+        count += 2;
+    }
+    for (int y = 1; y < height - 1; y++) {
+        histogram[gray[y * width]]++;
+        histogram[gray[y * width + width - 1]]++;
+        count += 2;
+    }
+    int seen = 0;
+    for (int v = 0; v < 256; v++) {
+        seen += histogram[v];
+        if (seen * 2 >= count) return v;
+    }
+    return 255;
+}
+
+// Box dilation of a 0/1 mask: a pixel is set when any pixel within radius (per axis) is set.
+// Separable running counts, so the cost does not depend on the radius.
+void dilate(std::vector<unsigned char>& mask, int width, int height, int radius) {
+    std::vector<int> prefix(std::max(width, height) + 1);
+    std::vector<unsigned char> line(std::max(width, height));
+
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = &mask[y * width];
+        for (int x = 0; x < width; x++) prefix[x + 1] = prefix[x] + row[x];
+        for (int x = 0; x < width; x++) {
+            line[x] = prefix[std::min(width, x + radius + 1)] - prefix[std::max(0, x - radius)] > 0;
+        }
+        std::copy(line.begin(), line.begin() + width, row);
+    }
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) prefix[y + 1] = prefix[y] + mask[y * width + x];
+        for (int y = 0; y < height; y++) {
+            mask[y * width + x] = prefix[std::min(height, y + radius + 1)] - prefix[std::max(0, y - radius)] > 0;
+        }
+    }
+}
+
+} // namespace
+
+std::vector<unsigned char> deriveImportanceMap(const std::vector<unsigned char>& gray, int width, int height) {
+    size_t total = (size_t)width * height;
+    std::vector<unsigned char> importance(total, 255);
+    if (width < 3 || height < 3 || gray.size() != total) {
+        return importance;
+    }
+
+    int background = borderMedian(gray, width, height);
+
+    // 1 = subject candidate: off the background level or on an edge
+    std::vector<unsigned char> subject(total, 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int i = y * width + x;
+            int gx = x > 0 && x < width - 1 ? std::abs(gray[i + 1] - gray[i - 1]) : 0;
+            int gy = y > 0 && y < height - 1 ? std::abs(gray[i + width] - gray[i - width]) : 0;
+            subject[i] = std::abs(gray[i] - background) > BACKGROUND_TOLERANCE || gx + gy > EDGE_THRESHOLD;
+        }
+    }
+
+    // Flood the background in from the border; what it cannot reach belongs to the subject
+    std::vector<unsigned char> reached(total, 0);
+    std::vector<int> stack;
+    auto seed = [&](int i) {
+        if (!subject[i] && !reached[i]) {
+            reached[i] = 1;
+            stack.push_back(i);
+        }
+    };
+    for (int x = 0; x < width; x++) {
+        seed(x);
+        seed((height - 1) * width + x);
+    }
+    for (int y = 1; y < height - 1; y++) {
+        seed(y * width);
+        seed(y * width + width - 1);
+    }
+    while (!stack.empty()) {
+        int i = stack.back();
+        stack.pop_back();
+        int x = i % width;
+        if (x > 0) seed(i - 1);
+        if (x < width - 1) seed(i + 1);
+        if (i >= width) seed(i - width);
+        if (i + width < (int)total) seed(i + width);
+    }
+
+    // Keep the unreached pieces that are large enough; reached doubles as the visited flag
+    std::vector<unsigned char> mask(total, 0);
+    std::vector<int> piece;
+    size_t kept = 0;
+    for (size_t start = 0; start < total; start++) {
+        if (reached[start]) continue;
+        piece.assign(1, (int)start);
+        reached[start] = 1;
+        for (size_t next = 0; next < piece.size(); next++) {
+            int i = piece[next];
+            int x = i % width;
+            auto visit = [&](int j) {
+                if (!reached[j]) {
+                    reached[j] = 1;
+                    piece.push_back(j);
+                }
+            };
+            if (x > 0) visit(i - 1);
+            if (x < width - 1) visit(i + 1);
+            if (i >= width) visit(i - width);
+            if (i + width < (int)total) visit(i + width);
+        }
+        if (piece.size() >= total * MIN_PIECE_SHARE) {
+            for (int i : piece) mask[i] = 1;
+            kept += piece.size();
+        }
+    }
+    if (kept < total * MIN_SUBJECT_SHARE) {
+        return importance;   // Nothing stands out from the background: keep the whole image
+    }
+
+    dilate(mask, width, height, std::max(2, std::min(width, height) / 40));
+    for (size_t i = 0; i < total; i++) {
+        importance[i] = mask[i] ? 255 : 0;
+    }
+    return importance;
+}
+
+std::vector<unsigned char> fitImportanceMap(const std::vector<unsigned char>& mask, int maskWidth, int maskHeight,
+                                            int width, int height) {
+    if (maskWidth == width && maskHeight == height) {
+        return mask;
+    }
+    return resampleImage(mask, maskWidth, maskHeight, 1, width, height, RESAMPLE_BOX);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+// Region of interest: a per-pixel importance map (0 = ignore, 255 = full weight) at the processing
+// size, which the solver multiplies into the darkness it aims for (see
+// StringArtGenerator::setImportanceMap). Thread spent on a plain background is thread the subject
+// does not get.
+
+// Automatic subject mask for a grayscale image: the border ring's median is taken as the
+// background, pixels that differ from it or sit on a strong edge are foreground, and whatever the
+// background cannot reach from the border (the subject and the holes inside it) is kept, slightly
+// grown so its outline is not cut. Returns 255 inside, 0 outside; all 255 when no subject stands out.
+std::vector<unsigned char> deriveImportanceMap(const std::vector<unsigned char>& gray, int width, int height);
+
+// A mask image (gray, white = important) resampled to width x height
+std::vector<unsigned char> fitImportanceMap(const std::vector<unsigned char>& mask, int maskWidth, int maskHeight,
+                                            int width, int height);
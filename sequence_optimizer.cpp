@@ -0,0 +1,187 @@
+#include "sequence_optimizer.h"
+#include "reconstruction.h"
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+SequenceOptimizerOptions::SequenceOptimizerOptions()
+    : maxMoves(0), timeBudgetSeconds(0.0), threadOpacity(DEFAULT_THREAD_OPACITY), candidatesPerMove(16), allowRemoval(true), seed(12345), verbose(true) {}
+
+SequenceOptimizerStats::SequenceOptimizerStats()
+    : movesTried(0), reroutes(0), removals(0), swaps(0), initialRMSE(0.0), finalRMSE(0.0), elapsedSeconds(0.0), clockLimited(false) {}
+
+namespace {
+
+// Render state kept as per-pixel log-transmittance so a chord can be added and removed exactly
+class IncrementalRender {
+public:
+    IncrementalRender(const std::vector<std::pair<double, double>>& nails, const std::vector<unsigned char>& targetGray,
+                      int width, int height, double opacity)
+        : m_nails(nails), m_width(width), m_height(height), m_opacity(opacity),
+          m_logTransmittance(width * height, 0.0), m_darkness(width * height, 0.0), m_target(width * height) {
+        for (int i = 0; i < width * height; i++) {
+            m_target[i] = (255.0 - targetGray[i]) / 255.0;
+        }
+    }
+
+    // Add (sign = +1) or remove (sign = -1) the chord a-b; returns the change in squared error
+    double applyChord(int a, int b, int sign) {
+        m_footprint.clear();
+        traceChordAA(m_nails[a].first, m_nails[a].second, m_nails[b].first, m_nails[b].second, m_width, m_height, m_footprint);
+
+        double delta = 0.0;
+        for (const std::pair<int, float>& px : m_footprint) {
+            int idx = px.first;
+            double pass = std::log(std::max(1e-6, 1.0 - m_opacity * px.second));
+            double oldDarkness = m_darkness[idx];
+
+            m_logTransmittance[idx] += sign * pass;
+            double newDarkness = 1.0 - std::exp(std::min(0.0, m_logTransmittance[idx]));
+            m_darkness[idx] = newDarkness;
+
+            double oldErr = m_target[idx] - oldDarkness;
+            double newErr = m_target[idx] - newDarkness;
+            delta += newErr * newErr - oldErr * oldErr;
+        }
+        return delta;
+    }
+
+    double rmse() const {
+        double sumSq = 0.0;
+        for (size_t i = 0; i < m_darkness.size(); i++) {
+            double diff = m_target[i] - m_darkness[i];
+            sumSq += diff * diff;
+        }
+        return m_darkness.empty() ? 0.0 : std::sqrt(sumSq / m_darkness.size());
+    }
+
+private:
+    const std::vector<std::pair<double, double>>& m_nails;
+    int m_width, m_height;
+    double m_opacity;
+    std::vector<double> m_logTransmittance;
+    std::vector<double> m_darkness;
+    std::vector<double> m_target;
+    std::vector<std::pair<int, float>> m_footprint;
+};
+
+} // namespace
+
+SequenceOptimizerStats optimizeSequence(std::vector<int>& sequence, const std::vector<std::pair<double, double>>& nails,
+                                        const std::vector<unsigned char>& allowedPairs,
+                                        const std::vector<unsigned char>& targetGray, int width, int height,
+                                        const SequenceOptimizerOptions& options) {
+    SequenceOptimizerStats stats;
+    auto startTime = std::chrono::steady_clock::now();
+    auto deadline = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(options.timeBudgetSeconds));
+
+    int numNails = (int)nails.size();
+    long long maxMoves = options.maxMoves > 0 ? options.maxMoves : (long long)DEFAULT_REFINE_MOVES_PER_STRING * sequence.size();
+    bool clockCap = options.timeBudgetSeconds > 0.0;
+    auto allowed = [&](int a, int b) {
+        return a != b && (allowedPairs.empty() || allowedPairs[a * numNails + b]);
+    };
+
+    if (sequence.size() < 4 || numNails < 4 || targetGray.size() < (size_t)width * height) {
+        return stats;
+    }
+
+    IncrementalRender render(nails, targetGray, width, height, options.threadOpacity);
+    for (size_t i = 0; i + 1 < sequence.size(); i++) {
+        render.applyChord(sequence[i], sequence[i + 1], +1);
+    }
+    stats.initialRMSE = render.rmse();
+
+    std::mt19937 rng(options.seed);
+    const double minGain = 1e-9;  // Ignore float noise so moves do not cycle
+
+    while (stats.movesTried < maxMoves) {
+        if (clockCap && std::chrono::steady_clock::now() >= deadline) {
+            stats.clockLimited = true;
+            break;
+        }
+        int n = (int)sequence.size();
+        if (n < 4) break;
+
+        // Interior nail i: its chords are (prev, cur) and (cur, next)
+        int i = 1 + (int)(rng() % (n - 2));
+        int prev = sequence[i - 1];
+        int cur = sequence[i];
+        int next = sequence[i + 1];
+        int moveType = (int)(rng() % 3);
+        stats.movesTried++;
+
+        if (moveType == 0) {
+            // Re-route: replace cur with the best of a few candidate nails
+            double removed = render.applyChord(prev, cur, -1) + render.applyChord(cur, next, -1);
+
+            int bestNail = -1;
+            double bestDelta = 0.0;
+            for (int c = 0; c < options.candidatesPerMove; c++) {
+                int candidate = (int)(rng() % numNails);
+                if (candidate == cur || !allowed(prev, candidate) || !allowed(candidate, next)) continue;
+
+                double added = render.applyChord(prev, candidate, +1) + render.applyChord(candidate, next, +1);
+                if (removed + added < bestDelta - minGain) {
+                    bestDelta = removed + added;
+                    bestNail = candidate;
+                }
+                render.applyChord(prev, candidate, -1);
+                render.applyChord(candidate, next, -1);
+            }
+
+            int keep = bestNail >= 0 ? bestNail : cur;
+            render.applyChord(prev, keep, +1);
+            render.applyChord(keep, next, +1);
+            if (bestNail >= 0) {
+                sequence[i] = bestNail;
+                stats.reroutes++;
+            }
+        } else if (moveType == 1) {
+            // Remove: drop cur and connect prev straight to next
+            if (!options.allowRemoval || !allowed(prev, next)) continue;
+
+            double delta = render.applyChord(prev, cur, -1) + render.applyChord(cur, next, -1) + render.applyChord(prev, next, +1);
+            if (delta < -minGain) {
+                sequence.erase(sequence.begin() + i);
+                stats.removals++;
+            } else {
+                render.applyChord(prev, next, -1);
+                render.applyChord(prev, cur, +1);
+                render.applyChord(cur, next, +1);
+            }
+        } else {
+            // Swap: exchange cur and next, (prev,cur,next,after) -> (prev,next,cur,after)
+            if (i + 2 >= n) continue;
+            int after = sequence[i + 2];
+            if (!allowed(prev, next) || !allowed(cur, after)) continue;
+
+            double delta = render.applyChord(prev, cur, -1) + render.applyChord(next, after, -1)
+                         + render.applyChord(prev, next, +1) + render.applyChord(cur, after, +1);
+            // The middle chord cur-next is shared by both orders, so it never needs touching
+            if (delta < -minGain) {
+                std::swap(sequence[i], sequence[i + 1]);
+                stats.swaps++;
+            } else {
+                render.applyChord(prev, next, -1);
+                render.applyChord(cur, after, -1);
+                render.applyChord(prev, cur, +1);
+                render.applyChord(next, after, +1);
+            }
+        }
+    }
+
+    stats.finalRMSE = render.rmse();
+    stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (options.verbose) {
+        std::cout << "Refinement: " << stats.movesTried << " moves in " << stats.elapsedSeconds << "s"
+                  << (stats.clockLimited ? ", time cap reached" : "") << " ("
+                  << stats.reroutes << " re-routed, " << stats.removals << " removed, " << stats.swaps << " swapped), RMSE "
+                  << stats.initialRMSE << " -> " << stats.finalRMSE << std::endl;
+    }
+    return stats;
+}
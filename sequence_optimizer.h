@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+// Default refinement length, in moves per string of the sequence being refined
+const int DEFAULT_REFINE_MOVES_PER_STRING = 20;
+
+// Local-search refinement of a finished nail sequence. Moves are scored against the
+// anti-aliased reconstruction (see reconstruction.h) and applied incrementally: every move
+// only touches the pixels of the chords it removes and adds, so each trial is O(chord length).
+// The search is bounded by a move count, so a seed and a count always give the same sequence;
+// the wall clock is only a cap on top of it.
+struct SequenceOptimizerOptions {
+    long long maxMoves;         // Moves to try (0 = DEFAULT_REFINE_MOVES_PER_STRING per string)
+    double timeBudgetSeconds;   // Wall-clock cap on the whole refinement (0 = none)
+    double threadOpacity;       // Per-pass opacity of the render model
+    int candidatesPerMove;      // Alternative nails tried when re-routing
+    bool allowRemoval;          // Allow dropping strings that do not help
+    unsigned int seed;          // Fixed seed keeps refinement reproducible
+    bool verbose;               // Print a summary line on stdout when done
+
+    SequenceOptimizerOptions();
+};
+
+struct SequenceOptimizerStats {
+    long long movesTried;
+    int reroutes;
+    int removals;
+    int swaps;
+    double initialRMSE;
+    double finalRMSE;
+    double elapsedSeconds;
+    bool clockLimited;          // The time cap ended the search before its move count
+
+    SequenceOptimizerStats();
+};
+
+// Refine sequence in place against targetGray (8-bit, 255 = white) of size width x height.
+// allowedPairs is the layout's nails x nails pair mask (NailLayout::buildPairMask; empty = every
+// pair of distinct nails): no move creates a chord the mask rules out.
+SequenceOptimizerStats optimizeSequence(std::vector<int>& sequence, const std::vector<std::pair<double, double>>& nails,
+                                        const std::vector<unsigned char>& allowedPairs,
+                                        const std::vector<unsigned char>& targetGray, int width, int height,
+                                        const SequenceOptimizerOptions& options);
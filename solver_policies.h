@@ -0,0 +1,231 @@
+#pragma once
+
+#include "chord_table.h"
+#include "coverage_grid.h"
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+// Policies for StringArtGenerator's greedy engine. The engine is one template instantiated per
+// (scoring model, coverage strategy) pair and picked once per solve, so the per-candidate loop holds
+// no runtime checks of either: a strategy's distance bonus is a compile-time flag and each scoring
+// model's kernel is called directly. A new strategy or model is a new type, and the instantiations
+// that do not use it compile exactly as before.
+//
+// Scoring model: score<DistanceBonus>(from, to) rates a candidate chord, and
+// mark(from, to, strategy, stringIdx, span) lays the chosen string down, with the strategy's
+// strength where the model has a schedule. INTEGER_THRESHOLD says whether the dynamic stopping
+// threshold is computed in Q24.
+//
+// Coverage strategy: DISTANCE_BONUS, strength() and fixedStrength() (the schedule in double and
+// Q12), and threshold(), the score below which the solve stops. span is the schedule's progress
+// denominator, 0 when the strings are unlimited.
+
+// Exploration bonus of the floating-point models: up to 0.1 for the longest chord
+class DistanceBonus {
+public:
+    DistanceBonus(const std::vector<std::pair<double, double>>& nails, double maxDistance)
+        : m_nails(nails), m_maxDistance(maxDistance) {}
+
+    double operator()(int from, int to) const {
+        double dx = m_nails[to].first - m_nails[from].first;
+        double dy = m_nails[to].second - m_nails[from].second;
+        double distance = sqrt(dx*dx + dy*dy);
+        return 0.1 * (distance / m_maxDistance);
+    }
+
+private:
+    const std::vector<std::pair<double, double>>& m_nails;
+    double m_maxDistance;
+};
+
+// ---- Scoring models ----
+
+// Per-pixel heuristic: darkness times max(0.1, 1 - coverage / 6), in double, over the line
+// sampler's footprint (ChordTable::forEachSample), duplicate samples included
+class HeuristicScoring {
+public:
+    static const bool INTEGER_THRESHOLD = false;
+
+    HeuristicScoring(const std::vector<double>& darkness, const ChordTable& chords, const DistanceBonus& bonus)
+        : m_darkness(darkness), m_coverage(darkness.size(), 0.0), m_chords(chords), m_bonus(bonus) {}
+
+    // Mean over the chord's samples, so long and short chords compete on darkness rather than length
+    template <bool WithBonus>
+    double score(int from, int to) const {
+        const double* dark = m_darkness.data();
+        const double* cov = m_coverage.data();
+        double totalScore = 0.0;
+        int validSamples = 0;
+
+        m_chords.forEachSample(from, to, ChordTable::SCORE_SAMPLES, [&](int idx) {
+            double coverageFactor = std::max(0.1, 1.0 - cov[idx] / 6.0);
+            totalScore += dark[idx] * coverageFactor;
+            validSamples++;
+        });
+
+        double score = validSamples > 0 ? totalScore / validSamples : 0.0;
+        if (WithBonus) {
+            score += m_bonus(from, to);
+        }
+        return score;
+    }
+
+    // Each sample adds 0.8 of the strength, so a pixel sampled twice gets it twice
+    template <typename Strategy>
+    void mark(int from, int to, const Strategy& strategy, int stringIdx, int span) {
+        double amount = strategy.strength(stringIdx, span) * 0.8;
+        double* cov = m_coverage.data();
+        m_chords.forEachSample(from, to, ChordTable::MARK_SAMPLES, [&](int idx) {
+            cov[idx] += amount;
+        });
+    }
+
+private:
+    const std::vector<double>& m_darkness;
+    std::vector<double> m_coverage;
+    const ChordTable& m_chords;
+    DistanceBonus m_bonus;
+};
+
+// The same heuristic in integers (see FixedPointCoverage); the bonus is added in Q24 too
+class FixedPointScoring {
+public:
+    static const bool INTEGER_THRESHOLD = true;
+
+    explicit FixedPointScoring(FixedPointCoverage& coverage) : m_coverage(coverage) {}
+
+    // Integer score and bonus; their sum converts to double exactly
+    template <bool WithBonus>
+    double score(int from, int to) const {
+        int64_t fixedScore = m_coverage.scoreChord(from, to);
+        if (WithBonus) {
+            fixedScore += (int64_t)1677722 * m_coverage.chordLength(from, to) / m_coverage.longestChord();
+        }
+        return FixedPointCoverage::toDouble(fixedScore);
+    }
+
+    template <typename Strategy>
+    void mark(int from, int to, const Strategy& strategy, int stringIdx, int span) {
+        m_coverage.markChord(from, to, strategy.fixedStrength(stringIdx, span));
+    }
+
+private:
+    FixedPointCoverage& m_coverage;
+};
+
+// Physical models: a string always darkens by its real width, so they ignore the strength schedule
+template <typename Coverage>
+class PhysicalScoring {
+public:
+    static const bool INTEGER_THRESHOLD = false;
+
+    PhysicalScoring(Coverage& coverage, const DistanceBonus& bonus) : m_coverage(coverage), m_bonus(bonus) {}
+
+    template <bool WithBonus>
+    double score(int from, int to) const {
+        double score = toDouble(m_coverage.scoreChord(from, to));
+        if (WithBonus) {
+            score += m_bonus(from, to);
+        }
+        return score;
+    }
+
+    template <typename Strategy>
+    void mark(int from, int to, const Strategy&, int, int) {
+        m_coverage.markChord(from, to);
+    }
+
+private:
+    static double toDouble(double score) { return score; }
+    static double toDouble(int64_t score) { return FixedPointCoverage::toDouble(score); }
+
+    Coverage& m_coverage;
+    DistanceBonus m_bonus;
+};
+
+typedef PhysicalScoring<SupersampledCoverage> SupersampledScoring;
+typedef PhysicalScoring<ResidualCoverage> ResidualScoring;
+
+// ---- Coverage strategies ----
+
+// generateStringArt's schedule: strength falls from 1.0 to 0.5 over the span, 0.6 when unlimited
+struct GreedySchedule {
+    static const bool DISTANCE_BONUS = false;
+    static const int ID = -1;
+    static const char* name() { return nullptr; }   // Not announced
+
+    double strength(int stringIdx, int span) const {
+        return span > 0 ? 1.0 - (double)stringIdx / (span * 2.0) : 0.6;
+    }
+    int32_t fixedStrength(int stringIdx, int span) const {
+        const int32_t one = FixedPointCoverage::ONE;
+        return span > 0 ? one - one * stringIdx / (2 * span) : 2458;
+    }
+    double threshold(int, int, bool) const { return 0.01; }
+};
+
+// Experimental strategy 0: full strength throughout
+struct ConstantStrength {
+    static const bool DISTANCE_BONUS = false;
+    static const int ID = 0;
+    static const char* name() { return "Default"; }
+
+    double strength(int, int) const { return 1.0; }
+    int32_t fixedStrength(int, int) const { return FixedPointCoverage::ONE; }
+    double threshold(int, int, bool) const { return 0.01; }
+};
+
+// Strategy 1: strength decays gently (1.0 to 0.7) to spread strings
+struct AdaptiveCoverage {
+    static const bool DISTANCE_BONUS = false;
+    static const int ID = 1;
+    static const char* name() { return "Adaptive Coverage"; }
+
+    double strength(int stringIdx, int span) const {
+        if (span == 0) return 0.8;
+        double progress = (double)stringIdx / span;
+        return 1.0 - 0.3 * progress;
+    }
+    int32_t fixedStrength(int stringIdx, int span) const {
+        return span > 0 ? FixedPointCoverage::ONE - 1229 * stringIdx / span : 3277;
+    }
+    double threshold(int, int, bool) const { return 0.01; }
+};
+
+// Strategy 2: constant moderate strength, stopping threshold rising from 0.01 to 0.03
+struct DynamicThreshold {
+    static const bool DISTANCE_BONUS = false;
+    static const int ID = 2;
+    static const char* name() { return "Dynamic Threshold"; }
+
+    double strength(int, int) const { return 0.9; }
+    int32_t fixedStrength(int, int) const { return 3686; }
+    double threshold(int stringIdx, int span, bool integerScores) const {
+        if (span == 0) return 0.01;
+        if (integerScores) {
+            // A multiply-add the compiler may or may not fuse; keep it integer
+            return FixedPointCoverage::toDouble(167772 + (int64_t)335544 * stringIdx / span);
+        }
+        double progress = (double)stringIdx / span;
+        return 0.01 + 0.02 * progress;
+    }
+};
+
+// Strategy 3: bonus for long chords, strength rising from 0.5 to 0.9
+struct ExplorationBoost {
+    static const bool DISTANCE_BONUS = true;
+    static const int ID = 3;
+    static const char* name() { return "Exploration Boost"; }
+
+    double strength(int stringIdx, int span) const {
+        if (span == 0) return 0.7;
+        double progress = (double)stringIdx / span;
+        return 0.5 + 0.4 * progress;
+    }
+    int32_t fixedStrength(int stringIdx, int span) const {
+        return span > 0 ? 2048 + 1638 * stringIdx / span : 2867;
+    }
+    double threshold(int, int, bool) const { return 0.01; }
+};
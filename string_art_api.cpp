@@ -0,0 +1,377 @@
+#include "string_art_api.h"
+#include "sequence_optimizer.h"
+#include "roi.h"
+#include <chrono>
+#include <algorithm>
+
+StringArtRequest::StringArtRequest()
+    : width(0), height(0), channels(0), layoutSpec("circle"), numNails(400), maxStrings(0), coverageStrategy(0),
+      contrastFactor(0.5), threadThickness("0.1mm"), paperWidth(609.6), paperHeight(914.4), colorMode(false),
+      stringsPerColor(2500), colorOrder("CMYK"), restarts(1), numThreads(0), refineSeconds(0.0), refineMoves(0), timeBudgetSeconds(0.0),
+      supersample(-1), fixedPoint(false), residual(false), lazyEvaluation(false), jointColor(false), workSize(DEFAULT_WORK_SIZE), resampleFilter(RESAMPLE_BOX), maxMemoryBytes(0),
+      resultCacheBytes(ResultCache::DEFAULT_MAX_BYTES), progressInterval(0), verbose(false) {}
+
+int StringArtRequest::effectiveCoverageStrategy() const {
+    if (maxStrings == 0 && coverageStrategy != 0) {
+        return 0;
+    }
+    if (maxStrings > 0 && coverageStrategy == 0) {
+        return 1;
+    }
+    return coverageStrategy;
+}
+
+int StringArtRequest::scheduleHorizon() const {
+    if (colorMode || snapshotStrings.empty()) {
+        return 0;
+    }
+    return *std::min_element(snapshotStrings.begin(), snapshotStrings.end());
+}
+
+bool StringArtRequest::refines() const {
+    return refineSeconds > 0.0 || refineMoves > 0;
+}
+
+StringArtResponse::StringArtResponse()
+    : success(false), cancelled(false), timedOut(false), cacheHit(false), width(0), height(0), threadOpacity(DEFAULT_THREAD_OPACITY), previewChannels(1),
+      paletteSeconds(0.0), elapsedSeconds(0.0) {}
+
+StringArtEngine::StringArtEngine() {}
+
+void StringArtEngine::configure(const StringArtRequest& request) {
+    // Cache directory and budget only drop the warm chord table when they change
+    m_generator.setVerbose(request.verbose);
+    m_generator.setContrastFactor(request.contrastFactor);
+    m_generator.setChordCacheDir(request.chordCacheDir);
+    m_generator.setMemoryBudget(request.maxMemoryBytes);
+    m_generator.setWorkSize(request.workSize, request.resampleFilter);
+    m_resultCache.configure(request.resultCacheDir, request.resultCacheBytes);
+}
+
+// Everything that changes the sequences: the processed pixels, the nail positions and the settings
+// the solver reads. Thread thickness and paper size enter through the thread opacity. The color
+// order, thread count and lazy evaluation are left out - they do not change the sequences - and so
+// are the time budget and the refinement time cap, because a run that hits either is never stored.
+static std::string resultKey(const ImageData& img, const NailLayout& layout, const StringArtRequest& request, double threadOpacity,
+                             const std::vector<unsigned char>* importance) {
+    ContentHash hash;
+    hash.add(std::string("solver 2"));   // Bump when a solver change alters its output
+    hash.add((int64_t)img.width);
+    hash.add((int64_t)img.height);
+    hash.add(img.data.data(), img.data.size());
+    if (request.colorMode) {
+        hash.add(img.colorData.data(), img.colorData.size());
+    }
+    const std::vector<std::pair<double, double>>& nails = layout.positions();
+    hash.add(nails.data(), nails.size() * sizeof(nails[0]));
+
+    hash.add((int64_t)request.colorMode);
+    if (request.colorMode) {
+        hash.add((int64_t)request.stringsPerColor);
+        hash.add(request.palette);
+        hash.add((int64_t)request.jointColor);
+    } else {
+        hash.add((int64_t)request.maxStrings);
+        hash.add((int64_t)request.effectiveCoverageStrategy());
+        hash.add((int64_t)request.restarts);
+        // Only snapshot runs change the schedule; other keys stay as they were
+        if (request.scheduleHorizon() > 0) {
+            hash.add(std::string("horizon"));
+            hash.add((int64_t)request.scheduleHorizon());
+        }
+    }
+    hash.add(request.contrastFactor);
+    hash.add(threadOpacity);
+    hash.add((int64_t)request.supersample);
+    hash.add((int64_t)request.fixedPoint);
+    // Refinement is keyed by its move count; the default count follows the sequence length
+    hash.add((int64_t)request.refines());
+    hash.add((int64_t)request.refineMoves);
+    if (request.residual) {
+        hash.add(std::string("residual"));
+    }
+    // The weights themselves, not the roi setting: an edited mask file is a different result
+    if (importance) {
+        hash.add(std::string("roi"));
+        hash.add(importance->data(), importance->size());
+    }
+    return hash.hex();
+}
+
+bool StringArtEngine::buildImportanceMap(const ImageData& img, const StringArtRequest& request, std::vector<unsigned char>& importance) {
+    if (request.roi == "auto") {
+        importance = deriveImportanceMap(img.data, img.width, img.height);
+        return true;
+    }
+    ImageData mask;
+    if (!m_generator.loadImage(request.roi, mask, false)) {
+        return false;
+    }
+    importance = fitImportanceMap(mask.data, mask.width, mask.height, img.width, img.height);
+    return true;
+}
+
+bool StringArtEngine::loadImage(const std::string& filename, const StringArtRequest& request, ImageData& img) {
+    configure(request);
+    return m_generator.loadImage(filename, img, request.colorMode);
+}
+
+StringArtResponse StringArtEngine::run(const StringArtRequest& request, StringArtProgressCallback progress,
+                                       const CancellationToken* cancel) {
+    configure(request);
+
+    ImageData img;
+    if (!m_generator.loadImage(request.pixels, request.width, request.height, request.channels, img, request.colorMode)) {
+        StringArtResponse response;
+        response.error = "Invalid image buffer (expected width x height x channels bytes, channels 1, 3 or 4)";
+        return response;
+    }
+    return run(img, request, progress, cancel);
+}
+
+StringArtResponse StringArtEngine::run(const ImageData& img, const StringArtRequest& request, StringArtProgressCallback progress,
+                                       const CancellationToken* cancel) {
+    auto startTime = std::chrono::steady_clock::now();
+    StringArtResponse response;
+    response.width = img.width;
+    response.height = img.height;
+
+    if (request.colorMode && !img.isColorMode) {
+        response.error = "Color mode needs an image loaded in color mode";
+        return response;
+    }
+
+    configure(request);
+
+    if (!NailLayout::fromSpec(request.layoutSpec, img.width, img.height, request.numNails, response.layout)) {
+        response.error = "Cannot build nail layout: " + request.layoutSpec;
+        return response;
+    }
+    const std::vector<std::pair<double, double>>& nails = response.layout.positions();
+
+    response.threadOpacity = threadOpacityForPaper(request.threadThickness, img.width, img.height,
+                                                   request.paperWidth, request.paperHeight);
+
+    // The thread's width in processing pixels is the same quantity the preview uses as opacity
+    if (request.supersample >= 0) {
+        int factor = request.supersample > 0 ? request.supersample : SupersampledCoverage::factorForThreadWidth(response.threadOpacity);
+        m_generator.setSupersampling(factor, response.threadOpacity);
+    } else {
+        m_generator.setSupersampling(0, response.threadOpacity);
+    }
+    m_generator.setFixedPoint(request.fixedPoint);
+    m_generator.setResidualModel(request.residual);
+    m_generator.setLazyEvaluation(request.lazyEvaluation);
+    m_generator.setJointColor(request.jointColor);
+    m_generator.setScheduleHorizon(request.scheduleHorizon());
+    std::shared_ptr<std::vector<unsigned char>> importance;
+    if (!request.roi.empty()) {
+        importance = std::make_shared<std::vector<unsigned char>>();
+        if (!buildImportanceMap(img, request, *importance)) {
+            m_generator.setImportanceMap(nullptr);
+            response.error = "Cannot load region of interest: " + request.roi;
+            return response;
+        }
+    }
+    m_generator.setImportanceMap(importance);
+    bool paletteMode = request.colorMode && !request.palette.empty();
+
+    auto notify = [&](StringArtStage stage, const std::vector<int>* sequence, int snapshotStrings = 0) {
+        if (progress) {
+            StringArtProgress update;
+            update.stage = stage;
+            update.response = &response;
+            update.sequence = sequence;
+            update.snapshotStrings = snapshotStrings;
+            progress(update);
+        }
+    };
+
+    // Snapshot counts the solver reached while running; the rest are cut from the final sequence
+    std::vector<int> snapshotsSent;
+    auto sendRemainingSnapshots = [&]() {
+        if (request.colorMode) return;
+        std::vector<int> counts = request.snapshotStrings;
+        std::sort(counts.begin(), counts.end());
+        for (int count : counts) {
+            if (std::find(snapshotsSent.begin(), snapshotsSent.end(), count) != snapshotsSent.end()) continue;
+            // A solve that stopped on its own before the count is what a run of that length returns
+            std::vector<int> prefix(response.sequence.begin(), response.sequence.begin() + std::min((size_t)count, response.sequence.size()));
+            notify(STAGE_SNAPSHOT, &prefix, count);
+        }
+    };
+
+    // A cached result skips solving and refinement; only the preview and metrics are rebuilt. A
+    // refined entry cannot supply greedy snapshots, so snapshot runs with refinement bypass the cache.
+    bool useResultCache = m_resultCache.enabled() && !(request.scheduleHorizon() > 0 && request.refines());
+    if (useResultCache) {
+        response.cacheKey = resultKey(img, response.layout, request, response.threadOpacity, importance.get());
+        CachedResult cached;
+        if (m_resultCache.load(response.cacheKey, cached)) {
+            response.cacheHit = true;
+            response.sequence = std::move(cached.sequence);
+            response.colorSequences = std::move(cached.colorSequences);
+            response.paletteSequences = std::move(cached.paletteSequences);
+            sendRemainingSnapshots();
+            notify(STAGE_RENDERING, nullptr);
+            render(img, request, response);
+            response.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            return response;
+        }
+    }
+
+    notify(STAGE_SOLVING, nullptr);
+    m_generator.setProgressCallback(request.progressInterval, [&](const std::vector<int>& sequence) {
+        notify(STAGE_SOLVING, &sequence);
+    });
+    m_generator.setSnapshotCallback(request.colorMode ? std::vector<int>() : request.snapshotStrings, [&](const std::vector<int>& sequence) {
+        snapshotsSent.push_back((int)sequence.size());
+        notify(STAGE_SNAPSHOT, &sequence, (int)sequence.size());
+    });
+    m_generator.setCancellation(cancel);
+    // The budget counts from the start of the run and covers solving and refinement
+    auto deadline = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(request.timeBudgetSeconds));
+    m_generator.clearDeadline();
+    if (request.timeBudgetSeconds > 0.0) {
+        m_generator.setDeadline(deadline);
+    }
+
+    if (paletteMode) {
+        std::vector<ThreadColor> palette;
+        int autoColors = 0;
+        if (!parsePalette(request.palette, palette, autoColors)) {
+            response.error = "Invalid palette: " + request.palette;
+            return response;
+        }
+        if (autoColors > 0) {
+            auto paletteStart = std::chrono::steady_clock::now();
+            palette = extractPalette(img.colorData, autoColors);
+            response.paletteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - paletteStart).count();
+        }
+        response.paletteSequences = m_generator.generatePaletteStringArt(img, response.layout, palette, request.stringsPerColor,
+                                                                         request.numThreads);
+    } else if (request.colorMode) {
+        response.colorSequences = m_generator.generateColorStringArt(img, response.layout, request.stringsPerColor);
+    } else {
+        int strategy = request.effectiveCoverageStrategy();
+        if (request.restarts > 1) {
+            response.sequence = m_generator.generateStringArtMultiStart(img, response.layout, request.maxStrings, strategy,
+                                                                        request.restarts, request.numThreads).sequence;
+        } else if (strategy == 0) {
+            response.sequence = m_generator.generateStringArt(img, response.layout, request.maxStrings);
+        } else {
+            response.sequence = m_generator.generateStringArtExperimental(img, response.layout, request.maxStrings, strategy);
+        }
+    }
+
+    m_generator.setProgressCallback(0, nullptr);
+    m_generator.setSnapshotCallback(std::vector<int>(), nullptr);
+    m_generator.setCancellation(nullptr);
+    response.cancelled = cancel && cancel->isCancelled();
+    response.timedOut = m_generator.deadlineHit();
+    m_generator.clearDeadline();
+
+    StringArtGenerator::ColorStringSequences& colorSequences = response.colorSequences;
+    StringArtGenerator::PaletteStringSequences& paletteSequences = response.paletteSequences;
+    if (paletteMode ? paletteSequences.totalStrings == 0 :
+        request.colorMode ? colorSequences.totalStrings == 0 : response.sequence.empty()) {
+        response.error = request.colorMode ? "Failed to generate color string art" : "Failed to generate string art";
+        return response;
+    }
+
+    // Snapshots are greedy prefixes: a multi-start run or one that stopped early sends them now
+    if (!response.cancelled && !response.timedOut) {
+        sendRemainingSnapshots();
+    }
+
+    // Refinement runs its move count, capped by --refine and by whatever is left of the time
+    // budget; a cancelled or timed-out run skips it
+    double refineSeconds = request.refineSeconds;
+    bool refine = request.refines() && !response.cancelled && !response.timedOut;
+    if (refine && request.timeBudgetSeconds > 0.0) {
+        double remaining = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+        refineSeconds = refineSeconds > 0.0 ? std::min(refineSeconds, remaining) : remaining;
+        refine = refineSeconds > 0.0;
+    }
+    // A refinement the clock cut short, or had no time left for, depends on the machine
+    bool refineComplete = refine || !request.refines();
+    if (refine) {
+        notify(STAGE_REFINING, nullptr);
+
+        SequenceOptimizerOptions refineOptions;
+        refineOptions.threadOpacity = response.threadOpacity;
+        refineOptions.verbose = request.verbose;
+        std::vector<unsigned char> allowedPairs = response.layout.buildPairMask();
+        auto refineSequence = [&](std::vector<int>& sequence, const std::vector<unsigned char>& target) {
+            if (optimizeSequence(sequence, nails, allowedPairs, target, img.width, img.height, refineOptions).clockLimited) {
+                refineComplete = false;
+            }
+        };
+        if (paletteMode) {
+            // Each thread is refined against its own plane, sharing the moves and the time cap
+            std::vector<std::vector<unsigned char>> planes = separatePalette(img.colorData, paletteSequences.colors);
+            refineOptions.maxMoves = request.refineMoves > 0 ? std::max(1LL, request.refineMoves / (long long)planes.size()) : 0;
+            refineOptions.timeBudgetSeconds = refineSeconds / planes.size();
+            paletteSequences.totalStrings = 0;
+            for (size_t c = 0; c < planes.size(); c++) {
+                refineSequence(paletteSequences.sequences[c], planes[c]);
+                paletteSequences.totalStrings += (int)paletteSequences.sequences[c].size();
+            }
+        } else if (request.colorMode) {
+            // Each channel is refined against its own separation, sharing the moves and the time cap
+            refineOptions.maxMoves = request.refineMoves > 0 ? std::max(1LL, request.refineMoves / 4) : 0;
+            refineOptions.timeBudgetSeconds = refineSeconds / 4.0;
+            refineSequence(colorSequences.cyanSequence, img.cyanData);
+            refineSequence(colorSequences.magentaSequence, img.magentaData);
+            refineSequence(colorSequences.yellowSequence, img.yellowData);
+            refineSequence(colorSequences.blackSequence, img.blackData);
+            size_t before = colorSequences.totalStrings;
+            colorSequences.totalStrings = colorSequences.cyanSequence.size() + colorSequences.magentaSequence.size() +
+                                          colorSequences.yellowSequence.size() + colorSequences.blackSequence.size();
+            // Removed strings leave the joint winding order pointing past the end of a channel
+            if ((size_t)colorSequences.totalStrings != before) {
+                colorSequences.windingOrder.clear();
+            }
+        } else {
+            refineOptions.maxMoves = request.refineMoves;
+            refineOptions.timeBudgetSeconds = refineSeconds;
+            refineSequence(response.sequence, img.data);
+        }
+    }
+
+    // Only complete runs are cached; a cancelled, timed-out or clock-capped one would replay the
+    // cut-short result
+    if (useResultCache && !response.cancelled && !response.timedOut && refineComplete) {
+        CachedResult entry;
+        entry.kind = paletteMode ? CachedResult::PALETTE : request.colorMode ? CachedResult::CMYK : CachedResult::GRAYSCALE;
+        entry.sequence = response.sequence;
+        entry.colorSequences = colorSequences;
+        entry.paletteSequences = paletteSequences;
+        m_resultCache.store(response.cacheKey, entry);
+    }
+
+    notify(STAGE_RENDERING, nullptr);
+    render(img, request, response);
+    response.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return response;
+}
+
+// Render the result and measure how well it reproduces the image
+void StringArtEngine::render(const ImageData& img, const StringArtRequest& request, StringArtResponse& response) const {
+    const std::vector<std::pair<double, double>>& nails = response.layout.positions();
+    if (request.colorMode && !request.palette.empty()) {
+        response.preview = renderPalettePreview(response.paletteSequences, nails, img.width, img.height, response.threadOpacity);
+        response.previewChannels = 3;
+        response.metrics = computeReconstructionMetrics(img.colorData, response.preview, img.width, img.height, 3);
+    } else if (request.colorMode) {
+        response.preview = renderColorPreview(response.colorSequences, request.colorOrder, nails, img.width, img.height, response.threadOpacity);
+        response.previewChannels = 3;
+        response.metrics = computeReconstructionMetrics(img.colorData, response.preview, img.width, img.height, 3);
+    } else {
+        response.preview = darknessToGray(renderSequenceDarkness(response.sequence, nails, img.width, img.height, response.threadOpacity));
+        response.previewChannels = 1;
+        response.metrics = computeReconstructionMetrics(img.data, response.preview, img.width, img.height, 1);
+    }
+    response.success = true;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "string_art_generator.h"
+#include "reconstruction.h"
+#include "result_cache.h"
+#include <vector>
+#include <string>
+#include <functional>
+
+// In-process API: one request in, sequences and metrics out, no files and no console output.
+// The command line tool is a thin client of it; services embed it the same way.
+
+// Everything a run needs. Defaults match the command line defaults.
+struct StringArtRequest {
+    // Decoded input image: interleaved 8-bit pixels, channels 1 (gray), 3 (RGB) or 4 (RGBA, alpha ignored).
+    // Only used by StringArtEngine::run(request); the ImageData overload takes an already loaded image.
+    std::vector<unsigned char> pixels;
+    int width, height, channels;
+
+    std::string layoutSpec;         // circle, rectangle, ellipse, polygon[:sides], csv:<file>
+    int numNails;                   // Ignored for csv layouts
+    int maxStrings;                 // 0 = unlimited (grayscale)
+    std::vector<int> snapshotStrings;  // Grayscale: smaller string counts reported as STAGE_SNAPSHOT prefixes
+                                       // of the same run (non-empty switches to the open-ended schedule)
+    int coverageStrategy;           // 0-3; see effectiveCoverageStrategy
+    double contrastFactor;
+    std::string threadThickness;
+    double paperWidth, paperHeight; // mm
+    bool colorMode;
+    int stringsPerColor;
+    std::string colorOrder;         // Layering order of the color preview
+    int restarts;                   // Grayscale multi-start (1 = single solve)
+    int numThreads;                 // 0 = all cores
+    double refineSeconds;           // Wall-clock cap on local search (0 = none)
+    long long refineMoves;          // Local-search length (0 = per-string default); refinement runs
+                                    // when either refine field is set
+    double timeBudgetSeconds;       // Wall-clock limit for solving and refining (0 = none)
+    int supersample;                // -1 = off, 0 = factor from thread width, else 1, 2, 4 or 8
+    bool fixedPoint;                // Integer scoring: the same sequences on every machine (not with supersample)
+    bool residual;                  // Residual-image model (see ResidualCoverage; not with supersample or fixedPoint)
+    bool lazyEvaluation;            // Lazy candidate selection: same sequences, fewer chords scored
+    bool jointColor;                // Color: one engine for all four threads, strings interleaved (windingOrder)
+    std::string palette;            // Color: thread palette instead of CMYK, see parsePalette (empty = CMYK)
+    std::string roi;                // Region of interest: empty = whole image, "auto" = derived subject mask,
+                                    // else a mask image file (white = important, see roi.h)
+    int workSize;
+    ResampleFilter resampleFilter;
+    std::string chordCacheDir;      // Empty = no persistent chord cache
+    size_t maxMemoryBytes;          // Chord geometry budget (0 = unlimited)
+    std::string resultCacheDir;     // Empty = no result cache (see ResultCache)
+    size_t resultCacheBytes;        // Size bound of the result cache directory
+    int progressInterval;           // Strings between solver snapshots (0 = stage changes only)
+    bool verbose;                   // Solver log on stdout, as the command line tool prints it
+
+    StringArtRequest();
+
+    // Strategy the grayscale solver actually runs: unlimited strings force strategy 0,
+    // a string limit turns the default 0 into the adaptive strategy 1
+    int effectiveCoverageStrategy() const;
+
+    // Strength schedule horizon for snapshot runs (see StringArtGenerator::setScheduleHorizon):
+    // the smallest requested count, 0 without snapshots
+    int scheduleHorizon() const;
+
+    // Whether the finished sequences are refined (refineSeconds or refineMoves set)
+    bool refines() const;
+};
+
+struct StringArtResponse {
+    bool success;
+    bool cancelled;                 // Stopped by the token; sequences hold what was built so far
+    bool timedOut;                  // Stopped by the time budget, likewise
+    bool cacheHit;                  // Sequences came from the result cache; nothing was solved
+    std::string cacheKey;           // Result cache key (empty when the cache is off)
+    std::string error;              // Set when success is false
+
+    int width, height;              // Processing resolution all coordinates refer to
+    NailLayout layout;
+    double threadOpacity;           // Per-pass opacity used for the preview and metrics
+
+    std::vector<int> sequence;                                // Grayscale result
+    StringArtGenerator::ColorStringSequences colorSequences;  // Color result
+    StringArtGenerator::PaletteStringSequences paletteSequences;  // Color result with a palette
+
+    std::vector<unsigned char> preview;   // Rendered result: gray, or RGB in color mode
+    int previewChannels;
+    ReconstructionMetrics metrics;
+    double paletteSeconds;          // Time spent extracting an automatic palette
+    double elapsedSeconds;
+
+    StringArtResponse();
+};
+
+enum StringArtStage {
+    STAGE_SOLVING,      // Layout is ready; snapshots follow every progressInterval strings
+    STAGE_SNAPSHOT,     // The sequence reached one of snapshotStrings; sequence is that prefix
+    STAGE_REFINING,
+    STAGE_RENDERING
+};
+
+struct StringArtProgress {
+    StringArtStage stage;
+    const StringArtResponse* response;    // Size, layout and thread opacity are filled in
+    const std::vector<int>* sequence;     // Solver snapshot or snapshot prefix, or null on a stage change
+    int snapshotStrings;                  // STAGE_SNAPSHOT: the requested count (the prefix is shorter if the solve stopped first)
+};
+
+// Called on the thread that runs the request; keep it cheap
+typedef std::function<void(const StringArtProgress&)> StringArtProgressCallback;
+
+// Runs requests one after another. The engine keeps its generator between runs, so chord
+// geometry stays warm while the layout and processing size repeat.
+class StringArtEngine {
+public:
+    StringArtEngine();
+
+    // Decode-free entry point: the image comes from request.pixels
+    StringArtResponse run(const StringArtRequest& request, StringArtProgressCallback progress = nullptr,
+                          const CancellationToken* cancel = nullptr);
+
+    // Same for an image already loaded and resized (see loadImage)
+    StringArtResponse run(const ImageData& img, const StringArtRequest& request, StringArtProgressCallback progress = nullptr,
+                          const CancellationToken* cancel = nullptr);
+
+    // Load and resize an image file with the request's processing size and color mode
+    bool loadImage(const std::string& filename, const StringArtRequest& request, ImageData& img);
+
+private:
+    void configure(const StringArtRequest& request);
+    void render(const ImageData& img, const StringArtRequest& request, StringArtResponse& response) const;
+    bool buildImportanceMap(const ImageData& img, const StringArtRequest& request, std::vector<unsigned char>& importance);
+
+    StringArtGenerator m_generator;
+    ResultCache m_resultCache;
+};
@@ -1,11 +1,212 @@
 #include "string_art_generator.h"
+#include "reconstruction.h"
+#include "thread_pool.h"
+#include "lazy_selection.h"
+#include "solver_policies.h"
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <iomanip>
 #include <filesystem>
 
-StringArtGenerator::StringArtGenerator(double contrastFactor) : m_contrastFactor(contrastFactor) {}
+StringArtGenerator::StringArtGenerator(double contrastFactor) : m_contrastFactor(contrastFactor), m_verbose(true), m_maxMemoryBytes(0),
+                                                                     m_supersample(0), m_threadWidth(1.0), m_fixedPoint(false), m_residualModel(false), m_lazy(false), m_jointColor(false),
+                                                                     m_workSize(DEFAULT_WORK_SIZE), m_resampleFilter(RESAMPLE_BOX),
+                                                                     m_progressInterval(0), m_scheduleHorizon(0), m_cancellation(nullptr),
+                                                                     m_hasDeadline(false), m_deadlineHit(false) {}
+
+CancellationToken::CancellationToken() : m_cancelled(false) {}
+
+void CancellationToken::cancel() {
+    m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::isCancelled() const {
+    return m_cancelled.load(std::memory_order_relaxed);
+}
+
+void StringArtGenerator::setVerbose(bool verbose) {
+    m_verbose = verbose;
+}
+
+void StringArtGenerator::setContrastFactor(double contrastFactor) {
+    m_contrastFactor = contrastFactor;
+}
+
+void StringArtGenerator::setCancellation(const CancellationToken* token) {
+    m_cancellation = token;
+}
+
+bool StringArtGenerator::cancelled() const {
+    return m_cancellation && m_cancellation->isCancelled();
+}
+
+void StringArtGenerator::setDeadline(std::chrono::steady_clock::time_point deadline) {
+    m_deadline = deadline;
+    m_hasDeadline = true;
+}
+
+void StringArtGenerator::setTimeBudget(double seconds) {
+    if (seconds > 0.0) {
+        setDeadline(std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+    } else {
+        clearDeadline();
+    }
+}
+
+void StringArtGenerator::clearDeadline() {
+    m_hasDeadline = false;
+    m_deadlineHit = false;
+}
+
+bool StringArtGenerator::deadlineReached() const {
+    return m_hasDeadline && std::chrono::steady_clock::now() >= m_deadline;
+}
+
+bool StringArtGenerator::deadlineHit() const {
+    return m_deadlineHit;
+}
+
+void StringArtGenerator::setChordCacheDir(const std::string& dir) {
+    if (dir == m_chordCacheDir) return;  // Keep the current table
+    m_chordCacheDir = dir;
+    m_chordTable.reset();
+}
+
+void StringArtGenerator::setMemoryBudget(size_t maxBytes) {
+    if (maxBytes == m_maxMemoryBytes) return;
+    m_maxMemoryBytes = maxBytes;
+    m_chordTable.reset();
+}
+
+void StringArtGenerator::setProgressCallback(int interval, std::function<void(const std::vector<int>&)> callback) {
+    m_progressInterval = callback ? interval : 0;
+    m_progressCallback = callback;
+}
+
+void StringArtGenerator::setSnapshotCallback(const std::vector<int>& counts, std::function<void(const std::vector<int>&)> callback) {
+    m_snapshotCounts = callback ? counts : std::vector<int>();
+    std::sort(m_snapshotCounts.begin(), m_snapshotCounts.end());
+    m_snapshotCallback = callback;
+}
+
+void StringArtGenerator::setImportanceMap(std::shared_ptr<const std::vector<unsigned char>> importance) {
+    m_importance = importance;
+}
+
+const unsigned char* StringArtGenerator::importanceFor(const ImageData& img) const {
+    if (!m_importance || m_importance->size() != (size_t)img.width * img.height) {
+        return nullptr;
+    }
+    return m_importance->data();
+}
+
+void StringArtGenerator::setScheduleHorizon(int strings) {
+    m_scheduleHorizon = std::max(0, strings);
+}
+
+void StringArtGenerator::reportProgress(const std::vector<int>& sequence) const {
+    if (m_progressInterval > 0 && (int)sequence.size() % m_progressInterval == 0) {
+        m_progressCallback(sequence);
+    }
+    if (!m_snapshotCounts.empty() && std::binary_search(m_snapshotCounts.begin(), m_snapshotCounts.end(), (int)sequence.size())) {
+        m_snapshotCallback(sequence);
+    }
+}
+
+int StringArtGenerator::scheduleSpan(int stringIdx, int targetStrings) const {
+    return m_scheduleHorizon > 0 ? stringIdx + m_scheduleHorizon : targetStrings;
+}
+
+void StringArtGenerator::setWorkSize(int shortSide, ResampleFilter filter) {
+    m_workSize = shortSide;
+    m_resampleFilter = filter;
+}
+
+void StringArtGenerator::setSupersampling(int factor, double threadWidth) {
+    m_supersample = factor;
+    m_threadWidth = threadWidth;
+}
+
+void StringArtGenerator::setFixedPoint(bool enabled) {
+    m_fixedPoint = enabled;
+}
+
+void StringArtGenerator::setResidualModel(bool enabled) {
+    m_residualModel = enabled;
+}
+
+void StringArtGenerator::setLazyEvaluation(bool enabled) {
+    m_lazy = enabled;
+}
+
+void StringArtGenerator::setJointColor(bool enabled) {
+    m_jointColor = enabled;
+}
+
+std::unique_ptr<LazyChordSelector> StringArtGenerator::makeLazySelector(int numNails, bool symmetricScores) const {
+    if (!m_lazy) {
+        return nullptr;
+    }
+    if (m_supersample > 0) {
+        log() << "Lazy evaluation: off (supersampled scores can rise again, so old scores are no bound)" << std::endl;
+        return nullptr;
+    }
+    return std::unique_ptr<LazyChordSelector>(new LazyChordSelector(numNails, symmetricScores));
+}
+
+void StringArtGenerator::logLazySelector(const LazyChordSelector* lazy) const {
+    if (!lazy) return;
+    log() << "Lazy evaluation: skipped " << std::fixed << std::setprecision(1) << lazy->skippedFraction() * 100.0 << std::defaultfloat
+          << "% of " << lazy->evaluations() + lazy->skipped() << " candidate chords (" << lazy->evaluations() << " scored)" << std::endl;
+}
+
+std::unique_ptr<FixedPointCoverage> StringArtGenerator::makeFixedCoverage(const ChordTable& chords, const ImageData& img) const {
+    if (!m_fixedPoint || m_supersample > 0 || m_residualModel) {
+        return nullptr;
+    }
+    
+    std::unique_ptr<FixedPointCoverage> fixed(new FixedPointCoverage(chords, img.data, m_contrastFactor, importanceFor(img)));
+    log() << "Coverage model: fixed point (" << fixed->memoryBytes() / 1024 << " KB)" << std::endl;
+    return fixed;
+}
+
+std::unique_ptr<ResidualCoverage> StringArtGenerator::makeResidualCoverage(const ChordTable& chords, const std::vector<double>& darkness) const {
+    if (!m_residualModel || m_supersample > 0) {
+        return nullptr;
+    }
+    
+    std::unique_ptr<ResidualCoverage> residual(new ResidualCoverage(chords, darkness, m_threadWidth));
+    log() << "Coverage model: residual image (" << residual->memoryBytes() / 1024 << " KB), a string lays down "
+          << (int)(residual->threadDarkness() * 100.0 / ResidualCoverage::ONE + 0.5) << "% darkness per pixel" << std::endl;
+    return residual;
+}
+
+std::unique_ptr<SupersampledCoverage> StringArtGenerator::makeFineCoverage(const NailLayout& layout, const std::vector<double>& darkness,
+                                                                           int width, int height) const {
+    if (m_supersample <= 0) {
+        return nullptr;
+    }
+    
+    std::unique_ptr<SupersampledCoverage> fine(new SupersampledCoverage(layout, darkness, width, height, m_supersample, m_threadWidth));
+    log() << "Coverage model: " << fine->factor() << "x" << fine->factor() << " subpixels per pixel, thread covers "
+          << (int)(fine->subpixelOpacity() * 100 + 0.5) << "% of a subpixel per pass ("
+          << fine->memoryBytes() / (1024 * 1024) << " MB)" << std::endl;
+    return fine;
+}
+
+std::ostream& StringArtGenerator::log() const {
+    // Per-thread null stream: writes to it only touch its own state flags
+    static thread_local std::ostream nullStream(nullptr);
+    return m_verbose ? std::cout : nullStream;
+}
+
+std::vector<std::pair<double, double>> StringArtGenerator::getNailPositions(int width, int height, int numNails, bool isCircular) {
+    NailLayout layout = isCircular ? NailLayout::circle(width, height, numNails) : NailLayout::rectangle(width, height, numNails);
+    return layout.positions();
+}
 
 // Grayscale image loading (backward compatibility)
 bool StringArtGenerator::loadImage(const std::string& filename, ImageData& img) {
@@ -62,51 +263,146 @@ bool StringArtGenerator::loadImage(const std::string& filename, ImageData& img,
     
     // Resize image for optimal processing if loading was successful
     if (loadSuccess) {
-        img.resizeForProcessing();
+        img.resizeForProcessing(m_workSize, m_resampleFilter);
     }
     
     return loadSuccess;
 }
 
-std::vector<int> StringArtGenerator::generateStringArt(const ImageData& img, int numNails, bool isCircular, int maxStrings) {
-    std::cout << "Analyzing image (" << img.width << "x" << img.height << ") with contrast factor " << m_contrastFactor << std::endl;
+bool StringArtGenerator::loadImage(const std::vector<unsigned char>& pixels, int width, int height, int channels, ImageData& img, bool colorMode) {
+    if (!imageFromPixels(pixels, width, height, channels, colorMode, img)) {
+        return false;
+    }
     
+    img.resizeForProcessing(m_workSize, m_resampleFilter);
+    return true;
+}
+
+std::vector<int> StringArtGenerator::generateStringArt(const ImageData& img, int numNails, bool isCircular, int maxStrings, int startNail) {
     if (!isCircular) {
-        return generateRectangularStringArt(img, numNails, maxStrings);
+        log() << "Analyzing image (" << img.width << "x" << img.height << ") with contrast factor " << m_contrastFactor << std::endl;
+        return generateRectangularStringArt(img, numNails, maxStrings, startNail);
+    }
+    
+    return generateStringArt(img, NailLayout::circle(img.width, img.height, numNails), maxStrings, startNail);
+}
+
+std::vector<int> StringArtGenerator::generateStringArt(const ImageData& img, const NailLayout& layout, int maxStrings, int startNail) {
+    log() << "Analyzing image (" << img.width << "x" << img.height << ") with contrast factor " << m_contrastFactor << std::endl;
+    logLayout(img, layout);
+    
+    return solveGreedy(img, layout, maxStrings, startNail);
+}
+
+void StringArtGenerator::logLayout(const ImageData& img, const NailLayout& layout) const {
+    if (layout.shape() == NailLayout::CIRCLE) {
+        double radius = std::min(img.width, img.height) / 2.0 - 10;
+        log() << "Placed " << layout.size() << " nails around circle (radius: " << radius << ")" << std::endl;
+    } else {
+        log() << "Placed " << layout.size() << " nails (" << layout.displayName() << " layout)" << std::endl;
+    }
+}
+
+const ChordTable& StringArtGenerator::chordTableFor(const NailLayout& layout, int width, int height) {
+    if (m_chordTable && m_chordTable->matches(layout, width, height)) {
+        return *m_chordTable;
     }
     
-    // Generate nail positions around circle
-    std::vector<std::pair<double, double>> nails;
-    int centerX = img.width / 2;
-    int centerY = img.height / 2;
-    double radius = std::min(img.width, img.height) / 2.0 - 10;
+    auto startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<ChordTable> table = std::make_shared<ChordTable>();
+    table->loadOrBuild(m_chordCacheDir, layout, width, height, m_maxMemoryBytes);
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
     
-    for (int i = 0; i < numNails; i++) {
-        double angle = 2.0 * M_PI * i / numNails;
-        double x = centerX + radius * cos(angle);
-        double y = centerY + radius * sin(angle);
-        nails.push_back({x, y});
+    if (table->isPacked()) {
+        log() << "Chord geometry: " << (table->isMapped() ? "mapped from cache" : "rasterized") << ", "
+              << table->memoryBytes() / 1024 << " KB in " << elapsedMs << " ms" << std::endl;
+    } else {
+        // Trade-off: no table memory or build time, but every candidate chord is re-traced while scoring
+        log() << "Chord geometry: packed table needs " << ChordTable::estimateBytes(layout, width, height) / 1024
+              << " KB, over the " << m_maxMemoryBytes / 1024 << " KB budget; tracing chords on demand ("
+              << table->memoryBytes() / 1024 << " KB, no cache file)" << std::endl;
     }
     
-    std::cout << "Placed " << numNails << " nails around circle (radius: " << radius << ")" << std::endl;
+    m_chordTable = table;
+    return *m_chordTable;
+}
+
+// Shared greedy engine for every nail layout, coverage strategy and scoring model. Hot-loop inputs
+// are flat arrays: the contrast-enhanced darkness is computed once per pixel, coverage is one
+// contiguous buffer, recent-nail checks are a single array lookup, excluded pairs are skipped up
+// front, and chord pixels come from the precomputed ChordTable instead of being resampled for every
+// candidate. The strategy and model are picked here, once; runGreedy is instantiated for each pair
+// (see solver_policies.h), so its loops test neither.
+std::vector<int> StringArtGenerator::solveGreedy(const ImageData& img, const NailLayout& layout, int maxStrings, int startNail,
+                                                 int coverageStrategy) {
+    const std::vector<std::pair<double, double>>& nails = layout.positions();
+    int numNails = layout.size();
+    const ChordTable& chords = chordTableFor(layout, img.width, img.height);
+    std::vector<unsigned char> allowedPairs = allowedPairsFor(img, layout, chords);
+    std::vector<double> darkness = buildEnhancedDarkness(img);
+    std::unique_ptr<SupersampledCoverage> fineCoverage = makeFineCoverage(layout, darkness, img.width, img.height);
+    std::unique_ptr<FixedPointCoverage> fixedCoverage = makeFixedCoverage(chords, img);
+    std::unique_ptr<ResidualCoverage> residualCoverage = makeResidualCoverage(chords, darkness);
+    std::unique_ptr<LazyChordSelector> lazy = makeLazySelector(numNails, fixedCoverage || residualCoverage);
+    DistanceBonus bonus(nails, layout.diameter());
+    
+    auto withScoring = [&](const auto& strategy) {
+        if (fineCoverage) {
+            SupersampledScoring scoring(*fineCoverage, bonus);
+            return runGreedy(scoring, strategy, allowedPairs, numNails, maxStrings, startNail, lazy.get());
+        }
+        if (residualCoverage) {
+            ResidualScoring scoring(*residualCoverage, bonus);
+            return runGreedy(scoring, strategy, allowedPairs, numNails, maxStrings, startNail, lazy.get());
+        }
+        if (fixedCoverage) {
+            FixedPointScoring scoring(*fixedCoverage);
+            return runGreedy(scoring, strategy, allowedPairs, numNails, maxStrings, startNail, lazy.get());
+        }
+        HeuristicScoring scoring(darkness, chords, bonus);
+        return runGreedy(scoring, strategy, allowedPairs, numNails, maxStrings, startNail, lazy.get());
+    };
     
-    // Greedy algorithm
+    switch (coverageStrategy) {
+        case GREEDY_SCHEDULE: return withScoring(GreedySchedule());
+        case 1: return withScoring(AdaptiveCoverage());
+        case 2: return withScoring(DynamicThreshold());
+        case 3: return withScoring(ExplorationBoost());
+        default: return withScoring(ConstantStrength());
+    }
+}
+
+template <typename Scoring, typename Strategy>
+std::vector<int> StringArtGenerator::runGreedy(Scoring& scoring, const Strategy& strategy, const std::vector<unsigned char>& allowedPairs,
+                                               int numNails, int maxStrings, int startNail, LazyChordSelector* lazy) {
+    auto scoreCandidate = [&](int currentNail, int nextNail) {
+        return scoring.template score<Strategy::DISTANCE_BONUS>(currentNail, nextNail);
+    };
+    std::vector<int> candidates;
     std::vector<int> sequence;
-    std::vector<std::vector<double>> coverage(img.height, std::vector<double>(img.width, 0.0));
     
-    int currentNail = 0;
+    // Position of each nail's latest use in the sequence, for the lookback window
+    const int lookbackWindow = 7;
+    std::vector<int> lastUsed(numNails, -lookbackWindow - 1);
+    
+    int currentNail = startNail % numNails;
     sequence.push_back(currentNail);
+    lastUsed[currentNail] = 0;
     
     int targetStrings = maxStrings;
     if (targetStrings > 0) {
-        std::cout << "Target strings: " << targetStrings << std::endl;
+        log() << "Target strings: " << targetStrings << std::endl;
     } else {
-        std::cout << "Target strings: unlimited (will stop when no improvement)" << std::endl;
+        log() << "Target strings: unlimited (will stop when no improvement)" << std::endl;
     }
     
     // Internal safety limit to prevent infinite loops
     int internalLimit = (targetStrings > 0) ? targetStrings : 10000;
     
+    if (Strategy::name()) {
+        log() << "Coverage strategy: " << Strategy::name() << " (" << Strategy::ID << ")" << std::endl;
+    }
+    
     double lastBestScore = 1.0;
     int stagnantCount = 0;
     double lastScore = -1.0;
@@ -114,36 +410,48 @@ std::vector<int> StringArtGenerator::generateStringArt(const ImageData& img, int
     int alternatingCount = 0;
     
     for (int stringIdx = 0; stringIdx < internalLimit - 1; stringIdx++) {
+        if (cancelled()) {
+            log() << "Stopping: Cancelled after " << sequence.size() << " nails" << std::endl;
+            break;
+        }
+        if (deadlineReached()) {
+            log() << "Stopping: Time budget reached after " << sequence.size() << " nails" << std::endl;
+            m_deadlineHit = true;
+            break;
+        }
+        
         int bestNextNail = -1;
         double bestScore = -1.0;
+        int seqLen = (int)sequence.size();
+        const unsigned char* allowedFromCurrent = &allowedPairs[currentNail * numNails];
         
-        // Try all other nails
-        for (int nextNail = 0; nextNail < numNails; nextNail++) {
-            if (nextNail == currentNail) continue;
-            
-            // Avoid recent nails
-            bool skipRecent = false;
-            int lookbackLimit = std::min(7, (int)sequence.size());
-            for (int lookback = 1; lookback <= lookbackLimit; lookback++) {
-                if (sequence.size() >= lookback && sequence[sequence.size() - lookback] == nextNail) {
-                    skipRecent = true;
-                    break;
-                }
+        // Try all other nails, skipping excluded pairs and recent nails
+        if (lazy) {
+            candidates.clear();
+            for (int nextNail = 0; nextNail < numNails; nextNail++) {
+                if (!allowedFromCurrent[nextNail] || seqLen - lastUsed[nextNail] <= lookbackWindow) continue;
+                candidates.push_back(nextNail);
             }
-            if (skipRecent) continue;
-            
-            double score = calculateLineScore(img, coverage, nails[currentNail], nails[nextNail]);
-            
-            if (score > bestScore) {
-                bestScore = score;
-                bestNextNail = nextNail;
+            bestNextNail = lazy->selectBest(currentNail, candidates, [&](int nextNail) { return scoreCandidate(currentNail, nextNail); }, bestScore);
+        } else {
+            for (int nextNail = 0; nextNail < numNails; nextNail++) {
+                if (!allowedFromCurrent[nextNail] || seqLen - lastUsed[nextNail] <= lookbackWindow) continue;
+                
+                double score = scoreCandidate(currentNail, nextNail);
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestNextNail = nextNail;
+                }
             }
         }
         
+        int span = targetStrings > 0 ? scheduleSpan(stringIdx, targetStrings) : 0;
+        double scoreThreshold = strategy.threshold(stringIdx, span, Scoring::INTEGER_THRESHOLD);
+        
         // Only break if no valid nail found OR score becomes negligible
-        if (bestNextNail == -1 || bestScore < 0.01) {
-            if (bestScore < 0.01) {
-                std::cout << "Stopping: Score too low (" << bestScore << "), no more meaningful connections" << std::endl;
+        if (bestNextNail == -1 || bestScore < scoreThreshold) {
+            if (bestScore < scoreThreshold) {
+                log() << "Stopping: Score too low (" << bestScore << "), no more meaningful connections" << std::endl;
             }
             break;
         }
@@ -154,7 +462,7 @@ std::vector<int> StringArtGenerator::generateStringArt(const ImageData& img, int
             if (abs(bestScore - secondLastScore) < 0.000001 && abs(bestScore - lastScore) > 0.000001) {
                 alternatingCount++;
                 if (alternatingCount >= 20) {
-                    std::cout << "Stopping: Detected alternating pattern between scores " << bestScore << " and " << lastScore << std::endl;
+                    log() << "Stopping: Detected alternating pattern between scores " << bestScore << " and " << lastScore << std::endl;
                     break;
                 }
             } else {
@@ -169,330 +477,353 @@ std::vector<int> StringArtGenerator::generateStringArt(const ImageData& img, int
             stagnantCount = 0;
         }
         
-        
         // Force exploration if stagnant
         if (stagnantCount > 30) {
             int offset = 1 + (stringIdx % 11) + (stringIdx / 100);
             bestNextNail = (currentNail + offset) % numNails;
             
-            while (bestNextNail == currentNail) {
+            // Never escape along an excluded pair (e.g. the same side of a rectangle)
+            while (!allowedFromCurrent[bestNextNail]) {
                 bestNextNail = (bestNextNail + 1) % numNails;
             }
             
             stagnantCount = 0;
         }
         
-        // Mark coverage
-        double coverageStrength = 1.0;
-        if (targetStrings > 0) {
-            coverageStrength = 1.0 - (double)stringIdx / (targetStrings * 2.0);
-        } else {
-            // For unlimited strings, use constant moderate coverage to avoid artificial limits
-            coverageStrength = 0.6;
-        }
-        markLineCoverage(coverage, nails[currentNail], nails[bestNextNail], coverageStrength);
+        scoring.mark(currentNail, bestNextNail, strategy, stringIdx, span);
         
         sequence.push_back(bestNextNail);
+        lastUsed[bestNextNail] = (int)sequence.size() - 1;
+        reportProgress(sequence);
         currentNail = bestNextNail;
         secondLastScore = lastScore;
         lastScore = bestScore;
         lastBestScore = bestScore;
         
         if ((stringIdx + 1) % 100 == 0) {
-            std::cout << "Generated " << (stringIdx + 1) << " strings, last score: " << bestScore << std::endl;
+            log() << "Generated " << (stringIdx + 1) << " strings, last score: " << bestScore << std::endl;
         }
     }
     
-    std::cout << "Generated " << sequence.size() << " total strings" << std::endl;
+    logLazySelector(lazy);
+    log() << "Generated " << sequence.size() << " total strings" << std::endl;
     return sequence;
 }
 
 // EXPERIMENTAL coverage strategies - DO NOT modify original generateStringArt
-std::vector<int> StringArtGenerator::generateStringArtExperimental(const ImageData& img, int numNails, bool isCircular, int maxStrings, int coverageStrategy) {
-    std::cout << "Analyzing image (" << img.width << "x" << img.height << ") with contrast factor " << m_contrastFactor << std::endl;
-    
+std::vector<int> StringArtGenerator::generateStringArtExperimental(const ImageData& img, int numNails, bool isCircular, int maxStrings, int coverageStrategy, int startNail) {
     if (!isCircular) {
-        return generateRectangularStringArt(img, numNails, maxStrings);
+        // The requested strategy runs on the rectangle too, with same-side pairs masked out
+        log() << "Analyzing image (" << img.width << "x" << img.height << ") with contrast factor " << m_contrastFactor << std::endl;
+        log() << "Generating rectangular layout with " << numNails << " nails" << std::endl;
+        NailLayout layout = NailLayout::rectangle(img.width, img.height, numNails);
+        return solveGreedy(img, layout, maxStrings, startNail, coverageStrategy);
     }
     
-    // Generate nail positions around circle
-    std::vector<std::pair<double, double>> nails;
-    int centerX = img.width / 2;
-    int centerY = img.height / 2;
-    double radius = std::min(img.width, img.height) / 2.0 - 10;
+    return generateStringArtExperimental(img, NailLayout::circle(img.width, img.height, numNails), maxStrings, coverageStrategy, startNail);
+}
+
+std::vector<int> StringArtGenerator::generateStringArtExperimental(const ImageData& img, const NailLayout& layout, int maxStrings, int coverageStrategy, int startNail) {
+    log() << "Analyzing image (" << img.width << "x" << img.height << ") with contrast factor " << m_contrastFactor << std::endl;
+    logLayout(img, layout);
+    
+    return solveGreedy(img, layout, maxStrings, startNail, coverageStrategy);
+}
+
+std::vector<int> StringArtGenerator::generateRectangularStringArt(const ImageData& img, int numNails, int maxStrings, int startNail) {
+    log() << "Generating rectangular layout with " << numNails << " nails" << std::endl;
+    
+    // Same engine as the circular layout, with same-side pairs masked out
+    NailLayout layout = NailLayout::rectangle(img.width, img.height, numNails);
+    return solveGreedy(img, layout, maxStrings, startNail);
+}
+
+StringArtGenerator::MultiStartResult::MultiStartResult() : startNail(0), reconstructionError(0.0), restartsRun(0) {}
+
+StringArtGenerator::MultiStartResult StringArtGenerator::generateStringArtMultiStart(const ImageData& img, int numNails, bool isCircular, int maxStrings,
+                                                                                     int coverageStrategy, int restarts, int numThreads) {
+    NailLayout layout = isCircular ? NailLayout::circle(img.width, img.height, numNails) : NailLayout::rectangle(img.width, img.height, numNails);
+    return generateStringArtMultiStart(img, layout, maxStrings, coverageStrategy, restarts, numThreads);
+}
+
+StringArtGenerator::MultiStartResult StringArtGenerator::generateStringArtMultiStart(const ImageData& img, const NailLayout& layout, int maxStrings,
+                                                                                     int coverageStrategy, int restarts, int numThreads) {
+    MultiStartResult best;
+    if (restarts < 1) restarts = 1;
     
-    for (int i = 0; i < numNails; i++) {
-        double angle = 2.0 * M_PI * i / numNails;
-        double x = centerX + radius * cos(angle);
-        double y = centerY + radius * sin(angle);
-        nails.push_back({x, y});
+    // Read-only inputs shared by every worker; each solve owns its coverage grid
+    const std::vector<std::pair<double, double>>& nails = layout.positions();
+    int nailCount = layout.size();
+    
+    std::vector<std::vector<int>> sequences(restarts);
+    std::vector<double> errors(restarts, 0.0);
+    std::vector<int> startNails(restarts);
+    for (int r = 0; r < restarts; r++) {
+        // Spread start nails evenly around the layout
+        startNails[r] = (int)((long long)r * nailCount / restarts);
     }
     
-    std::cout << "Placed " << numNails << " nails around circle (radius: " << radius << ")" << std::endl;
+    // Build (or map) the chord table once; worker copies share it read-only
+    chordTableFor(layout, img.width, img.height);
     
-    // Greedy algorithm
-    std::vector<int> sequence;
-    std::vector<std::vector<double>> coverage(img.height, std::vector<double>(img.width, 0.0));
+    log() << "Multi-start: " << restarts << " independent solves";
     
-    int currentNail = 0;
-    sequence.push_back(currentNail);
+    {
+        ThreadPool pool(std::min(numThreads > 0 ? numThreads : (int)std::thread::hardware_concurrency(), restarts));
+        log() << " on " << pool.size() << " threads" << std::endl;
+        
+        for (int r = 0; r < restarts; r++) {
+            pool.submit([&, r]() {
+                StringArtGenerator worker(*this);
+                worker.setVerbose(false);
+                worker.setProgressCallback(0, nullptr);
+                worker.setSnapshotCallback(std::vector<int>(), nullptr);
+                
+                // Each task writes only its own slot, so no synchronization is needed
+                if (coverageStrategy == 0) {
+                    sequences[r] = worker.generateStringArt(img, layout, maxStrings, startNails[r]);
+                } else {
+                    sequences[r] = worker.generateStringArtExperimental(img, layout, maxStrings, coverageStrategy, startNails[r]);
+                }
+                // Ranked at the preview's opacity and on the region of interest, like the solve itself
+                errors[r] = computeReconstructionRMSE(img, sequences[r], nails, m_threadWidth, importanceFor(img));
+            });
+        }
+        pool.waitAll();
+    }
     
-    int targetStrings = maxStrings;
-    if (targetStrings > 0) {
-        std::cout << "Target strings: " << targetStrings << std::endl;
-    } else {
-        std::cout << "Target strings: unlimited (will stop when no improvement)" << std::endl;
+    // Workers are copies; a deadline that cut them short is recorded here
+    if (deadlineReached()) {
+        m_deadlineHit = true;
     }
     
-    // Internal safety limit to prevent infinite loops
+    int bestIdx = 0;
+    for (int r = 0; r < restarts; r++) {
+        log() << "  Start nail " << startNails[r] << ": " << sequences[r].size() << " strings, RMSE " << errors[r] << std::endl;
+        if (errors[r] < errors[bestIdx]) {
+            bestIdx = r;
+        }
+    }
+    
+    best.sequence = std::move(sequences[bestIdx]);
+    best.startNail = startNails[bestIdx];
+    best.reconstructionError = errors[bestIdx];
+    best.restartsRun = restarts;
+    
+    log() << "Best start nail: " << best.startNail << " (RMSE " << best.reconstructionError << ")" << std::endl;
+    return best;
+}
+
+// ColorStringSequences implementation
+namespace {
+
+// One thread's greedy state in the joint color solver - the locals of solveGreedy's loop
+struct ColorChannelState {
+    std::vector<int> sequence;
+    std::vector<int> lastUsed;
+    int currentNail;
+    int stringIdx;
+    double lastBestScore;
+    double lastScore;
+    double secondLastScore;
+    int stagnantCount;
+    int alternatingCount;
+    bool active;
+    bool stale;             // Moved since its best next string was found
+    int bestNextNail;
+    double bestScore;
+};
+
+}
+
+// Joint engine for the four CMYK threads. The threads' coverage never interacts, so each keeps the
+// exact decisions of its own solveGreedy run (same scores, stop rules and stagnation escapes); what
+// changes is that only the thread that just moved needs a new scan, scans read precomputed weights,
+// and the strings come out interleaved best-first across the threads.
+StringArtGenerator::ColorStringSequences StringArtGenerator::solveColorJoint(const ImageData& img, const NailLayout& layout, int stringsPerColor, int startNail) {
+    static const char* channelNames[] = {"CYAN", "MAGENTA", "YELLOW", "BLACK"};
+    const int channels = JointColorCoverage::CHANNELS;
+    
+    log() << "Analyzing image (" << img.width << "x" << img.height << ") with contrast factor " << m_contrastFactor << std::endl;
+    logLayout(img, layout);
+    
+    int numNails = layout.size();
+    const ChordTable& chords = chordTableFor(layout, img.width, img.height);
+    std::vector<unsigned char> allowedPairs = allowedPairsFor(img, layout, chords);
+    JointColorCoverage coverage(chords, {&img.cyanData, &img.magentaData, &img.yellowData, &img.blackData}, m_contrastFactor,
+                                importanceFor(img));
+    log() << "Joint color solver: C, M, Y, K weight planes (" << coverage.memoryBytes() / (1024 * 1024)
+          << " MB), best thread and nail each step" << std::endl;
+    
+    const GreedySchedule schedule;
+    const int lookbackWindow = 7;
+    int targetStrings = stringsPerColor;
     int internalLimit = (targetStrings > 0) ? targetStrings : 10000;
     
-    // Display coverage strategy info
-    std::string strategyName[] = {"Default", "Adaptive Coverage", "Dynamic Threshold", "Exploration Boost"};
-    std::cout << "Coverage strategy: " << strategyName[coverageStrategy] << " (" << coverageStrategy << ")" << std::endl;
+    ColorChannelState state[channels];
+    std::unique_ptr<LazyChordSelector> lazy[channels];
+    for (int c = 0; c < channels; c++) {
+        ColorChannelState& ch = state[c];
+        ch.lastUsed.assign(numNails, -lookbackWindow - 1);
+        ch.currentNail = startNail % numNails;
+        ch.sequence.push_back(ch.currentNail);
+        ch.lastUsed[ch.currentNail] = 0;
+        ch.stringIdx = 0;
+        ch.lastBestScore = 1.0;
+        ch.lastScore = -1.0;
+        ch.secondLastScore = -1.0;
+        ch.stagnantCount = 0;
+        ch.alternatingCount = 0;
+        ch.active = true;
+        ch.stale = true;
+        ch.bestNextNail = -1;
+        ch.bestScore = -1.0;
+        lazy[c] = makeLazySelector(numNails, false);
+    }
     
-    double lastBestScore = 1.0;
-    int stagnantCount = 0;
-    double lastScore = -1.0;
-    double secondLastScore = -1.0;
-    int alternatingCount = 0;
+    ColorStringSequences result;
+    std::vector<int> candidates;
     
-    for (int stringIdx = 0; stringIdx < internalLimit - 1; stringIdx++) {
-        int bestNextNail = -1;
-        double bestScore = -1.0;
+    while (true) {
+        if (cancelled()) {
+            log() << "Stopping: Cancelled after " << result.windingOrder.size() << " strings" << std::endl;
+            break;
+        }
+        if (deadlineReached()) {
+            log() << "Stopping: Time budget reached after " << result.windingOrder.size() << " strings" << std::endl;
+            m_deadlineHit = true;
+            break;
+        }
         
-        // Try all other nails
-        for (int nextNail = 0; nextNail < numNails; nextNail++) {
-            if (nextNail == currentNail) continue;
-            
-            // Avoid recent nails
-            bool skipRecent = false;
-            int lookbackLimit = std::min(7, (int)sequence.size());
-            for (int lookback = 1; lookback <= lookbackLimit; lookback++) {
-                if (sequence.size() >= lookback && sequence[sequence.size() - lookback] == nextNail) {
-                    skipRecent = true;
-                    break;
-                }
+        // Rescan the thread that moved; the others' coverage is untouched, so their best moves stand
+        for (int c = 0; c < channels; c++) {
+            ColorChannelState& ch = state[c];
+            if (!ch.active || !ch.stale) continue;
+            if (ch.stringIdx >= internalLimit - 1) {
+                ch.active = false;
+                continue;
             }
-            if (skipRecent) continue;
             
-            double score = calculateLineScore(img, coverage, nails[currentNail], nails[nextNail]);
+            int seqLen = (int)ch.sequence.size();
+            const unsigned char* allowedFromCurrent = &allowedPairs[ch.currentNail * numNails];
+            ch.bestNextNail = -1;
+            ch.bestScore = -1.0;
             
-            // Strategy 3: Exploration boost - bonus for longer distances
-            if (coverageStrategy == 3) {
-                double dx = nails[nextNail].first - nails[currentNail].first;
-                double dy = nails[nextNail].second - nails[currentNail].second;
-                double distance = sqrt(dx*dx + dy*dy);
-                double maxDistance = 2.0 * radius; // Approximate max distance
-                double distanceBonus = 0.1 * (distance / maxDistance); // Small bonus for distance
-                score += distanceBonus;
+            candidates.clear();
+            for (int nextNail = 0; nextNail < numNails; nextNail++) {
+                if (!allowedFromCurrent[nextNail]) continue;
+                if (seqLen - ch.lastUsed[nextNail] <= lookbackWindow) continue;
+                
+                if (lazy[c]) {
+                    candidates.push_back(nextNail);
+                    continue;
+                }
+                
+                double score = coverage.scoreChord(c, ch.currentNail, nextNail);
+                if (score > ch.bestScore) {
+                    ch.bestScore = score;
+                    ch.bestNextNail = nextNail;
+                }
+            }
+            if (lazy[c]) {
+                ch.bestNextNail = lazy[c]->selectBest(ch.currentNail, candidates, [&](int nextNail) {
+                    return coverage.scoreChord(c, ch.currentNail, nextNail);
+                }, ch.bestScore);
             }
+            ch.stale = false;
             
-            if (score > bestScore) {
-                bestScore = score;
-                bestNextNail = nextNail;
+            int span = targetStrings > 0 ? scheduleSpan(ch.stringIdx, targetStrings) : 0;
+            double scoreThreshold = schedule.threshold(ch.stringIdx, span, false);
+            if (ch.bestNextNail == -1 || ch.bestScore < scoreThreshold) {
+                if (ch.bestScore < scoreThreshold) {
+                    log() << channelNames[c] << ": Stopping: Score too low (" << ch.bestScore << "), no more meaningful connections" << std::endl;
+                }
+                ch.active = false;
             }
         }
         
-        // Strategy 2: Dynamic threshold adjustment
-        double scoreThreshold = 0.01;
-        if (coverageStrategy == 2 && targetStrings > 0) {
-            double progress = (double)stringIdx / targetStrings;
-            scoreThreshold = 0.01 + 0.02 * progress; // Increase threshold as we progress
-        }
-        
-        // Only break if no valid nail found OR score becomes negligible
-        if (bestNextNail == -1 || bestScore < scoreThreshold) {
-            if (bestScore < scoreThreshold) {
-                std::cout << "Stopping: Score too low (" << bestScore << "), no more meaningful connections" << std::endl;
+        // Best move over all threads; a tie goes to the earlier channel
+        int channel = -1;
+        for (int c = 0; c < channels; c++) {
+            if (state[c].active && (channel == -1 || state[c].bestScore > state[channel].bestScore)) {
+                channel = c;
             }
-            break;
         }
+        if (channel == -1) break;
         
-        // Detect alternating pattern (oscillation between two scores)
+        ColorChannelState& ch = state[channel];
+        int bestNextNail = ch.bestNextNail;
+        double bestScore = ch.bestScore;
+        int stringIdx = ch.stringIdx;
+        const unsigned char* allowedFromCurrent = &allowedPairs[ch.currentNail * numNails];
+        ch.stale = true;
+        
+        // From here on, solveGreedy's per-string rules for this thread
         if (stringIdx > 100) {
-            // Check if current score equals score from 2 iterations ago AND differs from last score
-            if (abs(bestScore - secondLastScore) < 0.000001 && abs(bestScore - lastScore) > 0.000001) {
-                alternatingCount++;
-                if (alternatingCount >= 20) {
-                    std::cout << "Stopping: Detected alternating pattern between scores " << bestScore << " and " << lastScore << std::endl;
-                    break;
+            if (abs(bestScore - ch.secondLastScore) < 0.000001 && abs(bestScore - ch.lastScore) > 0.000001) {
+                ch.alternatingCount++;
+                if (ch.alternatingCount >= 20) {
+                    log() << channelNames[channel] << ": Stopping: Detected alternating pattern between scores " << bestScore
+                          << " and " << ch.lastScore << std::endl;
+                    ch.active = false;
+                    continue;
                 }
             } else {
-                alternatingCount = 0;
+                ch.alternatingCount = 0;
             }
         }
         
-        // Check for stagnation
-        if (bestScore >= lastBestScore - 0.0005) {
-            stagnantCount++;
+        if (bestScore >= ch.lastBestScore - 0.0005) {
+            ch.stagnantCount++;
         } else {
-            stagnantCount = 0;
+            ch.stagnantCount = 0;
         }
         
-        // Force exploration if stagnant
-        if (stagnantCount > 30) {
+        if (ch.stagnantCount > 30) {
             int offset = 1 + (stringIdx % 11) + (stringIdx / 100);
-            bestNextNail = (currentNail + offset) % numNails;
-            
-            while (bestNextNail == currentNail) {
+            bestNextNail = (ch.currentNail + offset) % numNails;
+            while (!allowedFromCurrent[bestNextNail]) {
                 bestNextNail = (bestNextNail + 1) % numNails;
             }
-            
-            stagnantCount = 0;
+            ch.stagnantCount = 0;
         }
         
-        // Mark coverage - different strategies
-        double coverageStrength = 1.0;
+        int span = targetStrings > 0 ? scheduleSpan(stringIdx, targetStrings) : 0;
+        coverage.markChord(channel, ch.currentNail, bestNextNail, schedule.strength(stringIdx, span));
         
-        if (coverageStrategy == 1) {
-            // Strategy 1: Adaptive coverage - decreases more gradually to spread strings
-            if (targetStrings > 0) {
-                double progress = (double)stringIdx / targetStrings;
-                coverageStrength = 1.0 - 0.3 * progress; // Less aggressive coverage decay
-            } else {
-                coverageStrength = 0.8; // Higher base coverage for spreading
-            }
-        } else if (coverageStrategy == 2) {
-            // Strategy 2: Dynamic threshold - adjust score threshold based on progress
-            if (targetStrings > 0) {
-                coverageStrength = 0.9; // Consistent moderate coverage
-            } else {
-                coverageStrength = 0.9;
-            }
-        } else if (coverageStrategy == 3) {
-            // Strategy 3: Exploration boost - encourage longer jumps
-            if (targetStrings > 0) {
-                double progress = (double)stringIdx / targetStrings;
-                coverageStrength = 0.5 + 0.4 * progress; // Increases coverage over time
-            } else {
-                coverageStrength = 0.7;
-            }
-        }
-        
-        markLineCoverage(coverage, nails[currentNail], nails[bestNextNail], coverageStrength);
+        ch.sequence.push_back(bestNextNail);
+        ch.lastUsed[bestNextNail] = (int)ch.sequence.size() - 1;
+        ch.currentNail = bestNextNail;
+        ch.secondLastScore = ch.lastScore;
+        ch.lastScore = bestScore;
+        ch.lastBestScore = bestScore;
+        ch.stringIdx++;
+        result.windingOrder.push_back(channel);
         
-        sequence.push_back(bestNextNail);
-        currentNail = bestNextNail;
-        secondLastScore = lastScore;
-        lastScore = bestScore;
-        lastBestScore = bestScore;
-        
-        if ((stringIdx + 1) % 100 == 0) {
-            std::cout << "Generated " << (stringIdx + 1) << " strings, last score: " << bestScore << std::endl;
+        if (result.windingOrder.size() % 1000 == 0) {
+            log() << "Generated " << result.windingOrder.size() << " strings (C " << state[0].stringIdx << ", M " << state[1].stringIdx
+                  << ", Y " << state[2].stringIdx << ", K " << state[3].stringIdx << "), last score: " << bestScore << std::endl;
         }
     }
     
-    std::cout << "Generated " << sequence.size() << " total strings" << std::endl;
-    return sequence;
-}
-
-std::vector<int> StringArtGenerator::generateRectangularStringArt(const ImageData& img, int numNails, int maxStrings) {
-    std::cout << "Generating rectangular layout with " << numNails << " nails" << std::endl;
-    
-    std::vector<std::pair<double, double>> nails;
-    int margin = 15;
-    int nailsPerSide = numNails / 4;
-    
-    // Top side
-    for (int i = 0; i < nailsPerSide && nails.size() < numNails; i++) {
-        double x = margin + (double)i * (img.width - 2 * margin) / std::max(1, nailsPerSide - 1);
-        nails.push_back({x, margin});
-    }
-    
-    // Right side  
-    for (int i = 1; i < nailsPerSide && nails.size() < numNails; i++) {
-        double y = margin + (double)i * (img.height - 2 * margin) / std::max(1, nailsPerSide - 1);
-        nails.push_back({img.width - margin, y});
-    }
-    
-    // Bottom side
-    for (int i = nailsPerSide - 2; i >= 0 && nails.size() < numNails; i--) {
-        double x = margin + (double)i * (img.width - 2 * margin) / std::max(1, nailsPerSide - 1);
-        nails.push_back({x, img.height - margin});
-    }
-    
-    // Left side
-    for (int i = nailsPerSide - 2; i > 0 && nails.size() < numNails; i--) {
-        double y = margin + (double)i * (img.height - 2 * margin) / std::max(1, nailsPerSide - 1);
-        nails.push_back({margin, y});
-    }
-    
-    // Use similar algorithm as circular
-    std::vector<int> sequence;
-    std::vector<std::vector<double>> coverage(img.height, std::vector<double>(img.width, 0.0));
-    
-    int currentNail = 0;
-    sequence.push_back(currentNail);
-    
-    int targetStrings = maxStrings;
-    if (targetStrings > 0) {
-        std::cout << "Target strings: " << targetStrings << std::endl;
-    } else {
-        std::cout << "Target strings: unlimited (will stop when no improvement)" << std::endl;
-    }
-    
-    // Internal safety limit to prevent infinite loops
-    int internalLimit = (targetStrings > 0) ? targetStrings : 10000;
-    
-    double lastScore = -1.0;
-    int sameScoreCount = 0;
-    const int maxSameScoreCount = 1500; // Stop after 1500 identical scores for rectangular
-    
-    for (int stringIdx = 0; stringIdx < internalLimit - 1; stringIdx++) {
-        int bestNextNail = -1;
-        double bestScore = -1.0;
-        
-        for (int nextNail = 0; nextNail < nails.size(); nextNail++) {
-            if (nextNail == currentNail) continue;
-            
-            bool skipRecent = false;
-            for (int lookback = 1; lookback <= 5 && lookback <= sequence.size(); lookback++) {
-                if (sequence[sequence.size() - lookback] == nextNail) {
-                    skipRecent = true;
-                    break;
-                }
-            }
-            if (skipRecent) continue;
-            
-            double score = calculateLineScore(img, coverage, nails[currentNail], nails[nextNail]);
-            
-            if (score > bestScore) {
-                bestScore = score;
-                bestNextNail = nextNail;
-            }
-        }
-        
-        if (bestNextNail == -1) break;
-        
-        // Check for score stagnation (same exact score repeatedly)
-        // Only activate after minimum strings to avoid premature stopping
-        if (stringIdx >= 2000) { // Only check stagnation after 2000 strings for rectangular
-            if (abs(bestScore - lastScore) < 0.000001) { // Essentially identical scores
-                sameScoreCount++;
-                if (sameScoreCount >= maxSameScoreCount) {
-                    std::cout << "Stopping: Score has not changed for " << maxSameScoreCount << " iterations (score: " << bestScore << ")" << std::endl;
-                    break;
-                }
-            } else {
-                sameScoreCount = 0;
-            }
-        }
-        lastScore = bestScore;
-        
-        markLineCoverage(coverage, nails[currentNail], nails[bestNextNail], 1.0);
-        sequence.push_back(bestNextNail);
-        currentNail = bestNextNail;
-        
-        if ((stringIdx + 1) % 50 == 0) {
-            std::cout << "Generated " << (stringIdx + 1) << " strings, last score: " << bestScore << std::endl;
+    if (lazy[0]) {
+        int64_t evaluations = 0, skipped = 0;
+        for (int c = 0; c < channels; c++) {
+            evaluations += lazy[c]->evaluations();
+            skipped += lazy[c]->skipped();
         }
+        log() << "Lazy evaluation: skipped " << std::fixed << std::setprecision(1)
+              << (evaluations + skipped > 0 ? 100.0 * skipped / (evaluations + skipped) : 0.0) << std::defaultfloat << "% of "
+              << evaluations + skipped << " candidate chords (" << evaluations << " scored)" << std::endl;
     }
     
-    return sequence;
+    result.cyanSequence = state[0].sequence;
+    result.magentaSequence = state[1].sequence;
+    result.yellowSequence = state[2].sequence;
+    result.blackSequence = state[3].sequence;
+    return result;
 }
 
-// ColorStringSequences implementation
 StringArtGenerator::ColorStringSequences::ColorStringSequences() : totalStrings(0) {}
 
 // Static helper function to get color sequence by letter
@@ -507,6 +838,11 @@ const std::vector<int>& StringArtGenerator::getSequenceForColor(char colorLetter
 }
 
 StringArtGenerator::ColorStringSequences StringArtGenerator::generateColorStringArt(const ImageData& img, int numNails, bool isCircular, int stringsPerColor) {
+    NailLayout layout = isCircular ? NailLayout::circle(img.width, img.height, numNails) : NailLayout::rectangle(img.width, img.height, numNails);
+    return generateColorStringArt(img, layout, stringsPerColor);
+}
+
+StringArtGenerator::ColorStringSequences StringArtGenerator::generateColorStringArt(const ImageData& img, const NailLayout& layout, int stringsPerColor) {
     ColorStringSequences result;
     
     if (!img.isColorMode) {
@@ -514,105 +850,204 @@ StringArtGenerator::ColorStringSequences StringArtGenerator::generateColorString
         return result;
     }
     
-    std::cout << "Generating color string art with " << stringsPerColor << " strings per color channel" << std::endl;
+    log() << "Generating color string art with " << stringsPerColor << " strings per color channel" << std::endl;
+    
+    bool joint = m_jointColor;
+    if (joint && (m_supersample > 0 || m_fixedPoint || m_residualModel)) {
+        log() << "Joint color solver: off (it runs the per-pixel model only)" << std::endl;
+        joint = false;
+    }
+    
+    if (joint) {
+        result = solveColorJoint(img, layout, stringsPerColor, 0);
+    } else {
+        // Create temporary ImageData objects for each channel
+        ImageData cyanImg(img.width, img.height, false);
+        ImageData magentaImg(img.width, img.height, false);
+        ImageData yellowImg(img.width, img.height, false);
+        ImageData blackImg(img.width, img.height, false);
     
-    // Create temporary ImageData objects for each channel
-    ImageData cyanImg(img.width, img.height, false);
-    ImageData magentaImg(img.width, img.height, false);
-    ImageData yellowImg(img.width, img.height, false);
-    ImageData blackImg(img.width, img.height, false);
+        // Copy channel data to grayscale data for processing
+        cyanImg.data = img.cyanData;
+        magentaImg.data = img.magentaData;
+        yellowImg.data = img.yellowData;
+        blackImg.data = img.blackData;
     
-    // Copy channel data to grayscale data for processing
-    cyanImg.data = img.cyanData;
-    magentaImg.data = img.magentaData;
-    yellowImg.data = img.yellowData;
-    blackImg.data = img.blackData;
+        // A deadline is shared out: each channel gets an equal part of the time that is left, so a
+        // slow first channel cannot starve the others
+        const bool hasDeadline = m_hasDeadline;
+        const std::chrono::steady_clock::time_point deadline = m_deadline;
+        auto shareDeadline = [&](int channelsLeft) {
+            if (hasDeadline) {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                setDeadline(deadline > now ? now + (deadline - now) / channelsLeft : deadline);
+            }
+        };
     
-    std::cout << "Processing CYAN channel..." << std::endl;
-    result.cyanSequence = generateStringArt(cyanImg, numNails, isCircular, stringsPerColor);
+        log() << "Processing CYAN channel..." << std::endl;
+        shareDeadline(4);
+        result.cyanSequence = generateStringArt(cyanImg, layout, stringsPerColor);
     
-    std::cout << "Processing MAGENTA channel..." << std::endl;
-    result.magentaSequence = generateStringArt(magentaImg, numNails, isCircular, stringsPerColor);
+        log() << "Processing MAGENTA channel..." << std::endl;
+        shareDeadline(3);
+        result.magentaSequence = generateStringArt(magentaImg, layout, stringsPerColor);
     
-    std::cout << "Processing YELLOW channel..." << std::endl;
-    result.yellowSequence = generateStringArt(yellowImg, numNails, isCircular, stringsPerColor);
+        log() << "Processing YELLOW channel..." << std::endl;
+        shareDeadline(2);
+        result.yellowSequence = generateStringArt(yellowImg, layout, stringsPerColor);
     
-    std::cout << "Processing BLACK channel..." << std::endl;
-    result.blackSequence = generateStringArt(blackImg, numNails, isCircular, stringsPerColor);
+        log() << "Processing BLACK channel..." << std::endl;
+        shareDeadline(1);
+        result.blackSequence = generateStringArt(blackImg, layout, stringsPerColor);
+        m_deadline = deadline;
+    }
     
     result.totalStrings = result.cyanSequence.size() + result.magentaSequence.size() + 
                          result.yellowSequence.size() + result.blackSequence.size();
     
-    std::cout << "Color generation complete:" << std::endl;
-    std::cout << "  Cyan: " << result.cyanSequence.size() << " strings" << std::endl;
-    std::cout << "  Magenta: " << result.magentaSequence.size() << " strings" << std::endl;
-    std::cout << "  Yellow: " << result.yellowSequence.size() << " strings" << std::endl;
-    std::cout << "  Black: " << result.blackSequence.size() << " strings" << std::endl;
-    std::cout << "  Total: " << result.totalStrings << " strings" << std::endl;
+    log() << "Color generation complete:" << std::endl;
+    log() << "  Cyan: " << result.cyanSequence.size() << " strings" << std::endl;
+    log() << "  Magenta: " << result.magentaSequence.size() << " strings" << std::endl;
+    log() << "  Yellow: " << result.yellowSequence.size() << " strings" << std::endl;
+    log() << "  Black: " << result.blackSequence.size() << " strings" << std::endl;
+    log() << "  Total: " << result.totalStrings << " strings" << std::endl;
     
     return result;
 }
 
-double StringArtGenerator::calculateLineScore(const ImageData& img, const std::vector<std::vector<double>>& coverage, 
-                         const std::pair<double, double>& nail1, const std::pair<double, double>& nail2) {
-    double x1 = nail1.first, y1 = nail1.second;
-    double x2 = nail2.first, y2 = nail2.second;
+StringArtGenerator::PaletteStringSequences::PaletteStringSequences() : totalStrings(0) {}
+
+StringArtGenerator::PaletteStringSequences StringArtGenerator::generatePaletteStringArt(const ImageData& img, const NailLayout& layout,
+                                                                                        const std::vector<ThreadColor>& palette,
+                                                                                        int stringsPerColor, int numThreads) {
+    PaletteStringSequences result;
     
-    double dx = x2 - x1;
-    double dy = y2 - y1;
-    double length = sqrt(dx*dx + dy*dy);
+    if (!img.isColorMode) {
+        std::cout << "Error: Image not loaded in color mode" << std::endl;
+        return result;
+    }
+    if (palette.empty()) {
+        std::cout << "Error: Empty thread palette" << std::endl;
+        return result;
+    }
     
-    if (length < 1.0) return 0.0;
+    int colors = (int)palette.size();
+    log() << "Generating palette string art with " << colors << " thread colors, "
+          << stringsPerColor << " strings per color" << std::endl;
     
-    int numSamples = (int)(length * 1.2);
-    if (numSamples < 2) numSamples = 2;
+    std::vector<std::vector<unsigned char>> planes = separatePalette(img.colorData, palette);
+    result.colors = palette;
+    result.sequences.resize(colors);
     
-    double totalScore = 0.0;
-    int validSamples = 0;
+    // Build (or map) the chord table once; worker copies share it read-only
+    chordTableFor(layout, img.width, img.height);
     
-    for (int i = 0; i < numSamples; i++) {
-        double t = (double)i / (numSamples - 1);
-        int x = (int)(x1 + t * dx);
-        int y = (int)(y1 + t * dy);
+    {
+        ThreadPool pool(std::min(numThreads > 0 ? numThreads : (int)std::thread::hardware_concurrency(), colors));
+        log() << "Solving " << colors << " planes on " << pool.size() << " threads" << std::endl;
         
-        if (x >= 0 && x < img.width && y >= 0 && y < img.height) {
-            double darkness = (255.0 - img.at(x, y)) / 255.0;
-            
-            // Use adjustable contrast enhancement
-            darkness = darkness * (1.0 + darkness * m_contrastFactor);
-            
-            double coverageFactor = std::max(0.1, 1.0 - coverage[y][x] / 6.0);
-            
-            totalScore += darkness * coverageFactor;
-            validSamples++;
+        for (int c = 0; c < colors; c++) {
+            pool.submit([&, c]() {
+                StringArtGenerator worker(*this);
+                worker.setVerbose(false);
+                worker.setProgressCallback(0, nullptr);
+                worker.setSnapshotCallback(std::vector<int>(), nullptr);
+                
+                ImageData plane(img.width, img.height, false);
+                plane.data = std::move(planes[c]);
+                // Each task writes only its own slot
+                result.sequences[c] = worker.generateStringArt(plane, layout, stringsPerColor);
+            });
         }
+        pool.waitAll();
+    }
+    
+    // Workers are copies; a deadline that cut them short is recorded here
+    if (deadlineReached()) {
+        m_deadlineHit = true;
     }
     
-    return validSamples > 0 ? totalScore / validSamples : 0.0;
+    log() << "Palette generation complete:" << std::endl;
+    for (int c = 0; c < colors; c++) {
+        result.totalStrings += (int)result.sequences[c].size();
+        log() << "  " << palette[c].label() << ": " << result.sequences[c].size() << " strings" << std::endl;
+    }
+    log() << "  Total: " << result.totalStrings << " strings" << std::endl;
+    
+    return result;
 }
 
-void StringArtGenerator::markLineCoverage(std::vector<std::vector<double>>& coverage, 
-                     const std::pair<double, double>& nail1, const std::pair<double, double>& nail2,
-                     double strength) {
-    double x1 = nail1.first, y1 = nail1.second;
-    double x2 = nail2.first, y2 = nail2.second;
+std::vector<double> StringArtGenerator::buildEnhancedDarkness(const ImageData& img) const {
+    std::vector<double> darkness(img.width * img.height);
+    for (size_t i = 0; i < darkness.size(); i++) {
+        double d = (255.0 - img.data[i]) / 255.0;
+        darkness[i] = d * (1.0 + d * m_contrastFactor);
+    }
     
-    double dx = x2 - x1;
-    double dy = y2 - y1;
-    double length = sqrt(dx*dx + dy*dy);
+    // Importance scales the target: a zero-weight pixel asks for no thread at all
+    if (const unsigned char* importance = importanceFor(img)) {
+        for (size_t i = 0; i < darkness.size(); i++) {
+            darkness[i] *= importance[i] / 255.0;
+        }
+    }
+    return darkness;
+}
+
+std::vector<unsigned char> StringArtGenerator::allowedPairsFor(const ImageData& img, const NailLayout& layout, const ChordTable& chords) const {
+    std::vector<unsigned char> allowedPairs = layout.buildPairMask();
+    int numNails = layout.size();
+    int totalPairs = numNails * (numNails - 1) / 2;
     
-    if (length < 1.0) return;
+    int excludedPairs = 0;
+    for (unsigned char allowed : allowedPairs) {
+        if (!allowed) excludedPairs++;
+    }
+    excludedPairs -= numNails;  // self-pairs are always excluded
+    if (excludedPairs > 0) {
+        log() << "Excluded " << excludedPairs / 2 << " of " << totalPairs << " nail pairs that run along the frame" << std::endl;
+    }
     
-    int numSamples = (int)(length * 1.5);
-    if (numSamples < 2) numSamples = 2;
+    const unsigned char* importance = importanceFor(img);
+    if (!importance) {
+        return allowedPairs;
+    }
     
-    for (int i = 0; i < numSamples; i++) {
-        double t = (double)i / (numSamples - 1);
-        int x = (int)(x1 + t * dx);
-        int y = (int)(y1 + t * dy);
-        
-        if (x >= 0 && x < coverage[0].size() && y >= 0 && y < coverage.size()) {
-            coverage[y][x] += strength * 0.8;
+    // A chord with no weighted pixel scores zero for the whole solve; drop it once instead of
+    // scoring it at every step. Its pixels are those of every model: the Bresenham line and the
+    // heuristic's samples from either nail
+    std::vector<unsigned char> pruned(allowedPairs.size(), 0);
+    std::vector<int> partners(numNails, 0);
+    for (int a = 0; a < numNails; a++) {
+        for (int b = a + 1; b < numNails; b++) {
+            if (!allowedPairs[a * numNails + b]) continue;
+            
+            bool weighted = false;
+            auto check = [&](int idx) {
+                weighted |= importance[idx] != 0;
+            };
+            chords.forEachPixel(a, b, check);
+            chords.forEachSample(a, b, ChordTable::SCORE_SAMPLES, check);
+            chords.forEachSample(b, a, ChordTable::SCORE_SAMPLES, check);
+            if (weighted) {
+                partners[a]++;
+                partners[b]++;
+            } else {
+                pruned[a * numNails + b] = pruned[b * numNails + a] = 1;
+            }
+        }
+    }
+    
+    // A nail left without any partner keeps its pairs, so the stagnation escape always has a way out
+    int prunedPairs = 0;
+    for (int a = 0; a < numNails; a++) {
+        for (int b = a + 1; b < numNails; b++) {
+            if (pruned[a * numNails + b] && partners[a] > 0 && partners[b] > 0) {
+                allowedPairs[a * numNails + b] = allowedPairs[b * numNails + a] = 0;
+                prunedPairs++;
+            }
         }
     }
+    log() << "Region of interest: pruned " << prunedPairs << " of " << totalPairs
+          << " nail pairs that cross no weighted pixel" << std::endl;
+    return allowedPairs;
 }
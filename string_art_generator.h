@@ -1,28 +1,167 @@
 #pragma once
 
 #include "image_processing.h"
+#include "nail_layout.h"
+#include "chord_table.h"
+#include "coverage_grid.h"
+#include "lazy_selection.h"
+#include "palette.h"
 #include <vector>
 #include <string>
+#include <ostream>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <chrono>
+
+// Cooperative cancellation shared between a caller and a running solve. The greedy loops check
+// it once per string and return the sequence built so far; cancel() may be called from any thread.
+class CancellationToken {
+public:
+    CancellationToken();
+    
+    void cancel();
+    bool isCancelled() const;
+    
+private:
+    std::atomic<bool> m_cancelled;
+};
 
 class StringArtGenerator {
 private:
     double m_contrastFactor;
+    bool m_verbose;
+    std::string m_chordCacheDir;
+    size_t m_maxMemoryBytes;                          // Budget for chord geometry (0 = unlimited)
+    int m_supersample;                                // Subpixel factor of the physical coverage model (0 = off)
+    double m_threadWidth;                             // Thread width in processing pixels for that model
+    bool m_fixedPoint;                                // Integer scoring for bit-identical results everywhere
+    bool m_residualModel;                             // Single residual-darkness plane (ResidualCoverage)
+    bool m_lazy;                                      // Lazy (CELF) candidate selection
+    bool m_jointColor;                                // One engine for all four CMYK threads
+    int m_workSize;                                   // Short side of the processing image
+    ResampleFilter m_resampleFilter;
+    int m_progressInterval;                           // Strings between progress callbacks (0 = off)
+    std::function<void(const std::vector<int>&)> m_progressCallback;
+    std::vector<int> m_snapshotCounts;                // Sequence lengths that trigger m_snapshotCallback, ascending
+    std::function<void(const std::vector<int>&)> m_snapshotCallback;
+    int m_scheduleHorizon;                            // Open-ended strength schedule (0 = spans the target)
+    const CancellationToken* m_cancellation;          // Not owned (null = never cancelled)
+    bool m_hasDeadline;
+    bool m_deadlineHit;                               // A solve stopped at the deadline since clearDeadline
+    std::chrono::steady_clock::time_point m_deadline;
+    std::shared_ptr<const ChordTable> m_chordTable;   // Shared read-only with copies (multi-start workers)
+    std::shared_ptr<const std::vector<unsigned char>> m_importance;   // Per-pixel weight 0-255 (null = whole image)
     
 public:
     StringArtGenerator(double contrastFactor = 0.5);
     
+    // Progress output on stdout (enabled by default, disabled for parallel workers)
+    void setVerbose(bool verbose);
+    
+    void setContrastFactor(double contrastFactor);
+    
+    // Token checked once per string by every solver; it must outlive the solves that use it
+    void setCancellation(const CancellationToken* token);
+    bool cancelled() const;
+    
+    // Wall-clock limit for every solve that follows: a solve that reaches it returns the sequence
+    // built so far. Checked once per string, like the cancellation token.
+    void setDeadline(std::chrono::steady_clock::time_point deadline);
+    void setTimeBudget(double seconds);   // Deadline this many seconds from now (0 = none)
+    void clearDeadline();
+    bool deadlineReached() const;
+    bool deadlineHit() const;             // Some solve was cut short by it (sticky until clearDeadline)
+    
+    // Directory for persistent chord geometry caches (empty = rasterize in memory every run)
+    void setChordCacheDir(const std::string& dir);
+    
+    // Memory budget for chord geometry; above it chords are traced per candidate instead of stored
+    void setMemoryBudget(size_t maxBytes);
+    
+    // Score against a supersampled coverage grid matched to the physical thread width
+    // (see SupersampledCoverage); factor 0 restores the per-pixel heuristic. The width is kept either
+    // way: it is the opacity multi-start restarts are ranked at.
+    void setSupersampling(int factor, double threadWidth);
+    
+    // Score with the integer coverage model (see FixedPointCoverage): the same sequence on every
+    // compiler, CPU and thread count. Ignored while supersampling is on.
+    void setFixedPoint(bool enabled);
+    
+    // Score against one residual-darkness image (see ResidualCoverage): a string subtracts its real
+    // darkness, so there is no coverage strength schedule. Integer, so also bit-identical everywhere;
+    // replaces fixed-point scoring, and is ignored while supersampling is on.
+    void setResidualModel(bool enabled);
+    
+    // Pick each next nail lazily from upper bounds on chord scores (see LazyChordSelector): the same
+    // sequence as the full scan with most candidate chords never scored. Not used while supersampling.
+    void setLazyEvaluation(bool enabled);
+    
+    // Solve the four CMYK threads together (see JointColorCoverage): every step lays the best string
+    // of any thread, so the threads interleave; each thread's sequence is the one its own solve would
+    // give. Per-pixel model only - off with supersampling, fixed-point or residual scoring.
+    void setJointColor(bool enabled);
+    
+    // Region of interest: per-pixel importance at the processing size (0 = ignore, 255 = full weight,
+    // see roi.h) scaling the darkness every scoring model aims for. Chords that cross no weighted
+    // pixel are dropped from the candidate set before solving. Null restores the whole image; a map
+    // whose size does not match the image being solved is ignored.
+    void setImportanceMap(std::shared_ptr<const std::vector<unsigned char>> importance);
+    
+    // Called from the solving thread with the sequence so far every `interval` strings.
+    // Keep it cheap (copy and hand off); multi-start workers never call it.
+    void setProgressCallback(int interval, std::function<void(const std::vector<int>&)> callback);
+    
+    // Called from the solving thread when the sequence reaches each of `counts` nails: the prefix a
+    // run stopped there would return, given an open-ended schedule (setScheduleHorizon). Multi-start
+    // workers never call it.
+    void setSnapshotCallback(const std::vector<int>& counts, std::function<void(const std::vector<int>&)> callback);
+    
+    // Coverage-strength schedule that does not depend on the string limit: progress runs as
+    // i / (i + horizon) instead of i / maxStrings, so every prefix of a long run is the sequence a
+    // shorter run would give. 0 restores the schedules that span the limit.
+    void setScheduleHorizon(int strings);
+    
+    // Processing resolution used by loadImage (short side in pixels) and its downscaling filter
+    void setWorkSize(int shortSide, ResampleFilter filter = RESAMPLE_BOX);
+    
     // Grayscale image loading (backward compatibility)
     bool loadImage(const std::string& filename, ImageData& img);
     
     // Enhanced image loading with color mode support
     bool loadImage(const std::string& filename, ImageData& img, bool colorMode);
     
-    std::vector<int> generateStringArt(const ImageData& img, int numNails, bool isCircular, int maxStrings = 0);
+    // Image already decoded in memory (see imageFromPixels), resized like a loaded file
+    bool loadImage(const std::vector<unsigned char>& pixels, int width, int height, int channels, ImageData& img, bool colorMode);
+    
+    std::vector<int> generateStringArt(const ImageData& img, int numNails, bool isCircular, int maxStrings = 0, int startNail = 0);
+    std::vector<int> generateStringArt(const ImageData& img, const NailLayout& layout, int maxStrings = 0, int startNail = 0);
     
     // EXPERIMENTAL coverage strategies - DO NOT modify original generateStringArt
-    std::vector<int> generateStringArtExperimental(const ImageData& img, int numNails, bool isCircular, int maxStrings = 0, int coverageStrategy = 1);
+    std::vector<int> generateStringArtExperimental(const ImageData& img, int numNails, bool isCircular, int maxStrings = 0, int coverageStrategy = 1, int startNail = 0);
+    std::vector<int> generateStringArtExperimental(const ImageData& img, const NailLayout& layout, int maxStrings = 0, int coverageStrategy = 1, int startNail = 0);
     
-    std::vector<int> generateRectangularStringArt(const ImageData& img, int numNails, int maxStrings);
+    std::vector<int> generateRectangularStringArt(const ImageData& img, int numNails, int maxStrings, int startNail = 0);
+    
+    // Nail coordinates in image space for the circular/rectangular layouts (see NailLayout for others)
+    static std::vector<std::pair<double, double>> getNailPositions(int width, int height, int numNails, bool isCircular);
+    
+    // Multi-start generation - independent greedy solves from spread-out start nails run on a
+    // thread pool, each scored by reconstruction error against the image (at the supersampling
+    // thread width, weighted by the importance map); the best one is kept
+    struct MultiStartResult {
+        std::vector<int> sequence;
+        int startNail;
+        double reconstructionError;
+        int restartsRun;
+        
+        MultiStartResult();
+    };
+    
+    MultiStartResult generateStringArtMultiStart(const ImageData& img, int numNails, bool isCircular, int maxStrings,
+                                                 int coverageStrategy, int restarts, int numThreads = 0);
+    MultiStartResult generateStringArtMultiStart(const ImageData& img, const NailLayout& layout, int maxStrings,
+                                                 int coverageStrategy, int restarts, int numThreads = 0);
     
     // Color string art generation - generates separate sequences for each CMYK channel
     struct ColorStringSequences {
@@ -31,6 +170,7 @@ public:
         std::vector<int> yellowSequence;
         std::vector<int> blackSequence;
         int totalStrings;
+        std::vector<int> windingOrder;   // Joint solver: channel (0-3 = C, M, Y, K) of each string laid, in order
         
         ColorStringSequences();
     };
@@ -39,12 +179,73 @@ public:
     static const std::vector<int>& getSequenceForColor(char colorLetter, const ColorStringSequences& sequences);
     
     ColorStringSequences generateColorStringArt(const ImageData& img, int numNails, bool isCircular, int stringsPerColor);
+    ColorStringSequences generateColorStringArt(const ImageData& img, const NailLayout& layout, int stringsPerColor);
+    
+    // Palette string art - one sequence per thread color (see palette.h), for the threads on hand
+    // instead of CMYK
+    struct PaletteStringSequences {
+        std::vector<ThreadColor> colors;           // Winding and layering order
+        std::vector<std::vector<int>> sequences;   // sequences[i] is wound with colors[i]
+        int totalStrings;
+        
+        PaletteStringSequences();
+    };
+    
+    // Separates the image into one density plane per color and solves the planes in parallel on a
+    // thread pool, each like a CMYK channel (numThreads 0 = all cores)
+    PaletteStringSequences generatePaletteStringArt(const ImageData& img, const NailLayout& layout,
+                                                    const std::vector<ThreadColor>& palette, int stringsPerColor,
+                                                    int numThreads = 0);
 
 private:
-    double calculateLineScore(const ImageData& img, const std::vector<std::vector<double>>& coverage, 
-                             const std::pair<double, double>& nail1, const std::pair<double, double>& nail2);
+    // Solver progress stream - std::cout, or a discarding stream when not verbose
+    std::ostream& log() const;
+    void logLayout(const ImageData& img, const NailLayout& layout) const;
+    
+    // Chord footprints for a layout: reused while the layout and image size stay the same
+    const ChordTable& chordTableFor(const NailLayout& layout, int width, int height);
+    
+    // All four CMYK threads in one greedy loop over a JointColorCoverage, each on generateStringArt's
+    // schedule (GreedySchedule, scheduleSpan) from startNail
+    ColorStringSequences solveColorJoint(const ImageData& img, const NailLayout& layout, int stringsPerColor, int startNail);
+    
+    // Shared greedy engine used by every layout (circular, rectangular, ...): generateStringArt's
+    // schedule, or one of the experimental coverage strategies 0-3
+    static const int GREEDY_SCHEDULE = -1;
+    std::vector<int> solveGreedy(const ImageData& img, const NailLayout& layout, int maxStrings, int startNail,
+                                 int coverageStrategy = GREEDY_SCHEDULE);
+    
+    // The greedy loop for one scoring model and coverage strategy (see solver_policies.h)
+    template <typename Scoring, typename Strategy>
+    std::vector<int> runGreedy(Scoring& scoring, const Strategy& strategy, const std::vector<unsigned char>& allowedPairs,
+                               int numNails, int maxStrings, int startNail, LazyChordSelector* lazy);
+    
+    // Physical coverage model for one solve, or null when supersampling is off
+    std::unique_ptr<SupersampledCoverage> makeFineCoverage(const NailLayout& layout, const std::vector<double>& darkness,
+                                                           int width, int height) const;
+    
+    // Lazy selector for one solve, or null when lazy evaluation is off or cannot be exact;
+    // symmetricScores when the model scores a chord the same from either nail (the integer models)
+    std::unique_ptr<LazyChordSelector> makeLazySelector(int numNails, bool symmetricScores) const;
+    void logLazySelector(const LazyChordSelector* lazy) const;
+    
+    // Integer coverage model for one solve, or null when fixed-point scoring is off
+    std::unique_ptr<FixedPointCoverage> makeFixedCoverage(const ChordTable& chords, const ImageData& img) const;
+    
+    // Residual-image model for one solve, or null when it is off
+    std::unique_ptr<ResidualCoverage> makeResidualCoverage(const ChordTable& chords, const std::vector<double>& darkness) const;
+    
+    void reportProgress(const std::vector<int>& sequence) const;
+    
+    // Denominator of the strength schedule's progress at string stringIdx (see setScheduleHorizon)
+    int scheduleSpan(int stringIdx, int targetStrings) const;
+    
+    // Contrast-enhanced darkness per pixel, computed once per solve
+    std::vector<double> buildEnhancedDarkness(const ImageData& img) const;
+    
+    // Importance map for img, or null when there is none or its size differs
+    const unsigned char* importanceFor(const ImageData& img) const;
     
-    void markLineCoverage(std::vector<std::vector<double>>& coverage, 
-                         const std::pair<double, double>& nail1, const std::pair<double, double>& nail2,
-                         double strength);
+    // The layout's pair mask minus the chords that cross no weighted pixel of the importance map
+    std::vector<unsigned char> allowedPairsFor(const ImageData& img, const NailLayout& layout, const ChordTable& chords) const;
 };
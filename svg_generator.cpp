@@ -35,56 +35,42 @@ std::vector<ColorOrderInfo> getColorOrderSequence(const std::string& colorOrder)
     return sequence;
 }
 
-void generateColorSVG(const std::string& filename, const StringArtGenerator::ColorStringSequences& colorSequences, 
+bool generateColorSVG(const std::string& filename, const StringArtGenerator::ColorStringSequences& colorSequences, 
                      int numNails, bool isCircular, int imgWidth, int imgHeight, const std::string& threadThickness, const std::string& colorOrder, double paperWidth, double paperHeight) {
+    NailLayout layout = isCircular ? NailLayout::circle(imgWidth, imgHeight, numNails) : NailLayout::rectangle(imgWidth, imgHeight, numNails);
+    return generateColorSVG(filename, colorSequences, layout, imgWidth, imgHeight, threadThickness, colorOrder, paperWidth, paperHeight);
+}
+
+namespace {
+
+// One colored thread of a multi-thread SVG: its own group, stroked in the thread's color
+struct SvgThreadGroup {
+    std::string displayName;   // Comment and group id
+    std::string stroke;
+    const std::vector<int>* sequence;
+};
+
+bool writeThreadGroupsSVG(const std::string& filename, const std::vector<SvgThreadGroup>& groups, int totalStrings,
+                          const std::string& modeName, const NailLayout& layout, int imgWidth, int imgHeight,
+                          const std::string& threadThickness, double paperWidth, double paperHeight) {
     std::ofstream svgFile(filename);
     if (!svgFile.is_open()) {
         std::cout << "Warning: Could not create SVG file: " << filename << std::endl;
-        return;
+        return false;
     }
     
     int svgWidth = imgWidth + 40;
     int svgHeight = imgHeight + 40;
     int offsetX = 20, offsetY = 20;
     
-    std::vector<std::pair<int, int>> nails;
-    
-    if (isCircular) {
-        int centerX = imgWidth / 2;
-        int centerY = imgHeight / 2;
-        int radius = std::min(imgWidth, imgHeight) / 2 - 10;
-        
-        for (int i = 0; i < numNails; i++) {
-            double angle = 2.0 * M_PI * i / numNails;
-            int x = centerX + (int)(radius * cos(angle));
-            int y = centerY + (int)(radius * sin(angle));
-            nails.push_back({x + offsetX, y + offsetY});
-        }
-    } else {
-        // Rectangular nail positions
-        int margin = 15;
-        int nailsPerSide = numNails / 4;
-        
-        for (int i = 0; i < nailsPerSide && nails.size() < numNails; i++) {
-            int x = margin + i * (imgWidth - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({x + offsetX, margin + offsetY});
-        }
-        
-        for (int i = 1; i < nailsPerSide && nails.size() < numNails; i++) {
-            int y = margin + i * (imgHeight - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({imgWidth - margin + offsetX, y + offsetY});
-        }
-        
-        for (int i = nailsPerSide - 2; i >= 0 && nails.size() < numNails; i--) {
-            int x = margin + i * (imgWidth - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({x + offsetX, imgHeight - margin + offsetY});
-        }
-        
-        for (int i = nailsPerSide - 2; i > 0 && nails.size() < numNails; i--) {
-            int y = margin + i * (imgHeight - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({margin + offsetX, y + offsetY});
-        }
+    // Nail positions come from the same layout the solver used, shifted into the SVG border
+    std::vector<std::pair<double, double>> nails;
+    for (const std::pair<double, double>& nail : layout.positions()) {
+        nails.push_back({nail.first + offsetX, nail.second + offsetY});
     }
+    int numNails = layout.size();
+    std::string layoutName = layout.displayName();
+    std::transform(layoutName.begin(), layoutName.end(), layoutName.begin(), ::tolower);
     
     // Scale to fit paper size
     double paperWidthMM = paperWidth;
@@ -115,21 +101,19 @@ void generateColorSVG(const std::string& filename, const StringArtGenerator::Col
     svgFile << "<svg xmlns=\"http://www.w3.org/2000/svg\" ";
     svgFile << "width=\"" << svgWidth << "mm\" height=\"" << svgHeight << "mm\" ";
     svgFile << "viewBox=\"0 0 " << (imgWidth + 40) << " " << (imgHeight + 40) << "\">\n";
-    svgFile << "  <title>Color String Art - " << colorSequences.totalStrings << " total connections</title>\n";
+    svgFile << "  <title>Color String Art - " << totalStrings << " total connections</title>\n";
     svgFile << "  <desc>Generated color string art with " << numNails << " nails in " 
-            << (isCircular ? "circular" : "rectangular") << " layout (CMYK mode)</desc>\n\n";
+            << layoutName << " layout (" << modeName << ")</desc>\n\n";
     
     // No background - paper is already white and background interferes with CNC machines
     
-    // Generate color threads in user-specified order
-    std::vector<ColorOrderInfo> orderSequence = getColorOrderSequence(colorOrder);
-    
-    for (const ColorOrderInfo& colorInfo : orderSequence) {
-        const std::vector<int>& sequence = StringArtGenerator::getSequenceForColor(colorInfo.letter, colorSequences);
+    // Threads in winding order
+    for (const SvgThreadGroup& group : groups) {
+        const std::vector<int>& sequence = *group.sequence;
         
         if (!sequence.empty()) {
-            svgFile << "  <!-- " << colorInfo.displayName << " threads -->\n";
-            svgFile << "  <g id=\"" << colorInfo.displayName << "\" stroke=\"" << colorInfo.svgColor << "\" stroke-width=\"" << strokeWidth << "\" stroke-opacity=\"0.8\">\n";
+            svgFile << "  <!-- " << group.displayName << " threads -->\n";
+            svgFile << "  <g id=\"" << group.displayName << "\" stroke=\"" << group.stroke << "\" stroke-width=\"" << strokeWidth << "\" stroke-opacity=\"0.8\">\n";
             
             for (size_t i = 0; i < sequence.size() - 1; i++) {
                 int nail1 = sequence[i];
@@ -160,59 +144,70 @@ void generateColorSVG(const std::string& filename, const StringArtGenerator::Col
     svgFile << "</svg>\n";
     
     svgFile.close();
+    if (svgFile.fail()) {
+        std::cout << "Warning: Could not write SVG file: " << filename << std::endl;
+        return false;
+    }
     std::cout << "[+] Color SVG visualization saved to: " << filename << std::endl;
+    return true;
+}
+
+} // namespace
+
+bool generateColorSVG(const std::string& filename, const StringArtGenerator::ColorStringSequences& colorSequences, 
+                     const NailLayout& layout, int imgWidth, int imgHeight, const std::string& threadThickness, const std::string& colorOrder, double paperWidth, double paperHeight) {
+    // Generate color threads in user-specified order
+    std::vector<SvgThreadGroup> groups;
+    for (const ColorOrderInfo& colorInfo : getColorOrderSequence(colorOrder)) {
+        groups.push_back({colorInfo.displayName, colorInfo.svgColor,
+                          &StringArtGenerator::getSequenceForColor(colorInfo.letter, colorSequences)});
+    }
+    return writeThreadGroupsSVG(filename, groups, colorSequences.totalStrings, "CMYK mode", layout, imgWidth, imgHeight,
+                                threadThickness, paperWidth, paperHeight);
+}
+
+bool generatePaletteSVG(const std::string& filename, const StringArtGenerator::PaletteStringSequences& paletteSequences,
+                        const NailLayout& layout, int imgWidth, int imgHeight, const std::string& threadThickness, double paperWidth, double paperHeight) {
+    // Groups are stroked with the real thread colors and named after them
+    std::vector<SvgThreadGroup> groups;
+    std::string modeName = "palette mode";
+    for (size_t c = 0; c < paletteSequences.colors.size() && c < paletteSequences.sequences.size(); c++) {
+        const ThreadColor& color = paletteSequences.colors[c];
+        std::string id = "THREAD-" + std::to_string(c + 1) + "-" + color.hex().substr(1);
+        if (!color.name.empty()) id += "-" + color.name;
+        groups.push_back({id, color.hex(), &paletteSequences.sequences[c]});
+        modeName += (c == 0 ? ": " : ", ") + color.label();
+    }
+    return writeThreadGroupsSVG(filename, groups, paletteSequences.totalStrings, modeName, layout, imgWidth, imgHeight,
+                                threadThickness, paperWidth, paperHeight);
 }
 
-void generateSVG(const std::string& filename, const std::vector<int>& nailSequence, 
+bool generateSVG(const std::string& filename, const std::vector<int>& nailSequence, 
                  int numNails, bool isCircular, int imgWidth, int imgHeight, const std::string& threadThickness, double paperWidth, double paperHeight) {
+    NailLayout layout = isCircular ? NailLayout::circle(imgWidth, imgHeight, numNails) : NailLayout::rectangle(imgWidth, imgHeight, numNails);
+    return generateSVG(filename, nailSequence, layout, imgWidth, imgHeight, threadThickness, paperWidth, paperHeight);
+}
+
+bool generateSVG(const std::string& filename, const std::vector<int>& nailSequence, 
+                 const NailLayout& layout, int imgWidth, int imgHeight, const std::string& threadThickness, double paperWidth, double paperHeight) {
     std::ofstream svgFile(filename);
     if (!svgFile.is_open()) {
         std::cout << "Warning: Could not create SVG file: " << filename << std::endl;
-        return;
+        return false;
     }
     
     int svgWidth = imgWidth + 40;
     int svgHeight = imgHeight + 40;
     int offsetX = 20, offsetY = 20;
     
-    std::vector<std::pair<int, int>> nails;
-    
-    if (isCircular) {
-        int centerX = imgWidth / 2;
-        int centerY = imgHeight / 2;
-        int radius = std::min(imgWidth, imgHeight) / 2 - 10;
-        
-        for (int i = 0; i < numNails; i++) {
-            double angle = 2.0 * M_PI * i / numNails;
-            int x = centerX + (int)(radius * cos(angle));
-            int y = centerY + (int)(radius * sin(angle));
-            nails.push_back({x + offsetX, y + offsetY});
-        }
-    } else {
-        // Rectangular nail positions
-        int margin = 15;
-        int nailsPerSide = numNails / 4;
-        
-        for (int i = 0; i < nailsPerSide && nails.size() < numNails; i++) {
-            int x = margin + i * (imgWidth - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({x + offsetX, margin + offsetY});
-        }
-        
-        for (int i = 1; i < nailsPerSide && nails.size() < numNails; i++) {
-            int y = margin + i * (imgHeight - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({imgWidth - margin + offsetX, y + offsetY});
-        }
-        
-        for (int i = nailsPerSide - 2; i >= 0 && nails.size() < numNails; i--) {
-            int x = margin + i * (imgWidth - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({x + offsetX, imgHeight - margin + offsetY});
-        }
-        
-        for (int i = nailsPerSide - 2; i > 0 && nails.size() < numNails; i--) {
-            int y = margin + i * (imgHeight - 2 * margin) / std::max(1, nailsPerSide - 1);
-            nails.push_back({margin + offsetX, y + offsetY});
-        }
+    // Nail positions come from the same layout the solver used, shifted into the SVG border
+    std::vector<std::pair<double, double>> nails;
+    for (const std::pair<double, double>& nail : layout.positions()) {
+        nails.push_back({nail.first + offsetX, nail.second + offsetY});
     }
+    int numNails = layout.size();
+    std::string layoutName = layout.displayName();
+    std::transform(layoutName.begin(), layoutName.end(), layoutName.begin(), ::tolower);
     
     // Scale to fit paper size
     double paperWidthMM = paperWidth;
@@ -245,7 +240,7 @@ void generateSVG(const std::string& filename, const std::vector<int>& nailSequen
     svgFile << "viewBox=\"0 0 " << (imgWidth + 40) << " " << (imgHeight + 40) << "\">\n";
     svgFile << "  <title>String Art - " << nailSequence.size() << " connections</title>\n";
     svgFile << "  <desc>Generated string art with " << numNails << " nails in " 
-            << (isCircular ? "circular" : "rectangular") << " layout</desc>\n\n";
+            << layoutName << " layout</desc>\n\n";
     
     // No background - paper is already white and background interferes with CNC machines
     
@@ -279,5 +274,10 @@ void generateSVG(const std::string& filename, const std::vector<int>& nailSequen
     svgFile << "</svg>\n";
     
     svgFile.close();
+    if (svgFile.fail()) {
+        std::cout << "Warning: Could not write SVG file: " << filename << std::endl;
+        return false;
+    }
     std::cout << "[+] SVG visualization saved to: " << filename << std::endl;
+    return true;
 }
@@ -16,8 +16,16 @@ struct ColorOrderInfo {
 
 std::vector<ColorOrderInfo> getColorOrderSequence(const std::string& colorOrder);
 
-void generateColorSVG(const std::string& filename, const StringArtGenerator::ColorStringSequences& colorSequences, 
+bool generateColorSVG(const std::string& filename, const StringArtGenerator::ColorStringSequences& colorSequences, 
                      int numNails, bool isCircular, int imgWidth, int imgHeight, const std::string& threadThickness = "hairline", const std::string& colorOrder = "CMYK", double paperWidth = 609.6, double paperHeight = 914.4);
+bool generateColorSVG(const std::string& filename, const StringArtGenerator::ColorStringSequences& colorSequences, 
+                     const NailLayout& layout, int imgWidth, int imgHeight, const std::string& threadThickness = "hairline", const std::string& colorOrder = "CMYK", double paperWidth = 609.6, double paperHeight = 914.4);
 
-void generateSVG(const std::string& filename, const std::vector<int>& nailSequence, 
+// One group per palette thread, stroked with its real color and labeled with its hex code (and name)
+bool generatePaletteSVG(const std::string& filename, const StringArtGenerator::PaletteStringSequences& paletteSequences,
+                        const NailLayout& layout, int imgWidth, int imgHeight, const std::string& threadThickness = "hairline", double paperWidth = 609.6, double paperHeight = 914.4);
+
+bool generateSVG(const std::string& filename, const std::vector<int>& nailSequence, 
                  int numNails, bool isCircular, int imgWidth, int imgHeight, const std::string& threadThickness = "hairline", double paperWidth = 609.6, double paperHeight = 914.4);
+bool generateSVG(const std::string& filename, const std::vector<int>& nailSequence, 
+                 const NailLayout& layout, int imgWidth, int imgHeight, const std::string& threadThickness = "hairline", double paperWidth = 609.6, double paperHeight = 914.4);
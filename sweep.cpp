@@ -0,0 +1,187 @@
+#include "sweep.h"
+#include "thread_pool.h"
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// The request value an axis sets, as the table shows it
+std::string axisValue(const SweepAxis& axis, const StringArtRequest& request) {
+    std::ostringstream out;
+    if (axis.name == "contrast") {
+        out << std::fixed << std::setprecision(2) << request.contrastFactor;
+    } else if (axis.name == "strategy") {
+        out << request.effectiveCoverageStrategy();   // The one that runs, as in the file names
+    } else if (axis.name == "nails") {
+        out << request.numNails;
+    } else {
+        out << request.maxStrings;
+    }
+    return out.str();
+}
+
+void applyAxis(const SweepAxis& axis, double value, StringArtRequest& request) {
+    if (axis.name == "contrast") {
+        request.contrastFactor = value;
+    } else if (axis.name == "strategy") {
+        request.coverageStrategy = (int)value;
+    } else if (axis.name == "nails") {
+        request.numNails = (int)value;
+    } else {
+        request.maxStrings = (int)value;
+    }
+}
+
+} // namespace
+
+bool parseSweepAxis(const std::string& spec, SweepAxis& axis, std::string& error) {
+    size_t equals = spec.find('=');
+    if (equals == std::string::npos) {
+        error = "expected name=value,value,... in '" + spec + "'";
+        return false;
+    }
+    axis.name = spec.substr(0, equals);
+    axis.values.clear();
+
+    double low, high;
+    bool integer = true;
+    if (axis.name == "contrast") {
+        low = 0.0;
+        high = 2.0;
+        integer = false;
+    } else if (axis.name == "strategy") {
+        low = 0;
+        high = 3;
+    } else if (axis.name == "nails") {
+        low = 50;
+        high = 1000;
+    } else if (axis.name == "strings") {
+        low = 0;
+        high = 1e9;
+    } else {
+        error = "unknown parameter '" + axis.name + "' (contrast, strategy, nails or strings)";
+        return false;
+    }
+
+    std::stringstream list(spec.substr(equals + 1));
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        char* end = nullptr;
+        double value = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || value < low || value > high || (integer && value != (int)value)) {
+            error = "invalid " + axis.name + " value '" + item + "'";
+            return false;
+        }
+        axis.values.push_back(value);
+    }
+    if (axis.values.empty()) {
+        error = "no values for " + axis.name;
+        return false;
+    }
+    return true;
+}
+
+std::vector<StringArtRequest> expandSweep(const StringArtRequest& base, const std::vector<SweepAxis>& axes) {
+    std::vector<StringArtRequest> requests(1, base);
+    for (const SweepAxis& axis : axes) {
+        std::vector<StringArtRequest> expanded;
+        expanded.reserve(requests.size() * axis.values.size());
+        for (const StringArtRequest& request : requests) {
+            for (double value : axis.values) {
+                expanded.push_back(request);
+                applyAxis(axis, value, expanded.back());
+            }
+        }
+        requests.swap(expanded);
+    }
+    return requests;
+}
+
+std::vector<StringArtResponse> runSweep(const ImageData& img, const std::vector<StringArtRequest>& requests, int numThreads) {
+    std::vector<StringArtResponse> responses(requests.size());
+
+    // At most one engine per pool thread is ever in use; an engine goes back to the idle list after
+    // each point, so the next point on that thread finds its chord geometry warm
+    std::mutex engineMutex;
+    std::vector<std::unique_ptr<StringArtEngine>> idleEngines;
+
+    {
+        ThreadPool pool(std::min(numThreads > 0 ? numThreads : (int)std::thread::hardware_concurrency(), (int)requests.size()));
+
+        for (size_t i = 0; i < requests.size(); i++) {
+            pool.submit([&, i]() {
+                std::unique_ptr<StringArtEngine> engine;
+                {
+                    std::lock_guard<std::mutex> lock(engineMutex);
+                    if (!idleEngines.empty()) {
+                        engine = std::move(idleEngines.back());
+                        idleEngines.pop_back();
+                    }
+                }
+                if (!engine) {
+                    engine.reset(new StringArtEngine());
+                }
+
+                StringArtRequest request = requests[i];
+                request.verbose = false;
+                request.numThreads = 1;      // The pool already fills the cores
+                request.progressInterval = 0;
+                responses[i] = engine->run(img, request);
+
+                std::lock_guard<std::mutex> lock(engineMutex);
+                idleEngines.push_back(std::move(engine));
+            });
+        }
+        pool.waitAll();
+    }
+    return responses;
+}
+
+int bestSweepPoint(const std::vector<StringArtResponse>& responses) {
+    int best = -1;
+    for (size_t i = 0; i < responses.size(); i++) {
+        if (!responses[i].success) continue;
+        if (best < 0 || responses[i].metrics.rmse < responses[best].metrics.rmse) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+void writeSweepTable(std::ostream& out, const std::vector<SweepAxis>& axes, const std::vector<StringArtRequest>& requests,
+                     const std::vector<StringArtResponse>& responses, int best) {
+    // Formatted in a local stream, so the caller's stream flags are left alone
+    const int width = 10;
+    std::ostringstream table;
+    table << std::left << std::setw(4) << "#";
+    for (const SweepAxis& axis : axes) {
+        table << std::setw(width) << axis.name;
+    }
+    table << std::setw(width) << "placed" << std::setw(width) << "rmse" << std::setw(width) << "psnr"
+          << std::setw(width) << "ssim" << "seconds" << "\n";
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        const StringArtResponse& response = responses[i];
+        std::ostringstream row;
+        row << std::left << std::setw(4) << (std::to_string(i + 1) + ((int)i == best ? "*" : ""));
+        for (const SweepAxis& axis : axes) {
+            row << std::setw(width) << axisValue(axis, requests[i]);
+        }
+        if (!response.success) {
+            row << "failed: " << response.error;
+        } else {
+            size_t placed = requests[i].colorMode ? (requests[i].palette.empty() ? response.colorSequences.totalStrings
+                                                                                 : response.paletteSequences.totalStrings)
+                                                  : response.sequence.size();
+            row << std::setw(width) << placed << std::fixed << std::setprecision(4) << std::setw(width) << response.metrics.rmse
+                << std::setprecision(2) << std::setw(width) << response.metrics.psnr << std::setprecision(4) << std::setw(width)
+                << response.metrics.ssim << std::setprecision(3) << response.elapsedSeconds;
+        }
+        table << row.str() << "\n";
+    }
+    out << table.str();
+}
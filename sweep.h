@@ -0,0 +1,34 @@
+#pragma once
+
+#include "string_art_api.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Parameter sweeps: every combination of a few grids run on one decoded image, so tuning an image
+// is one command instead of a CLI run (and a decode) per setting.
+
+// One swept parameter, from "name=v1,v2,...". Names: contrast (0.0-2.0), strategy (coverage
+// strategy 0-3), nails (50-1000) and strings (0+).
+struct SweepAxis {
+    std::string name;
+    std::vector<double> values;
+};
+
+bool parseSweepAxis(const std::string& spec, SweepAxis& axis, std::string& error);
+
+// Every combination of the axes applied to base, the last axis varying fastest
+std::vector<StringArtRequest> expandSweep(const StringArtRequest& base, const std::vector<SweepAxis>& axes);
+
+// Run every request on img concurrently on a thread pool (numThreads 0 = all cores). The image is
+// shared read-only; each worker thread reuses one engine, so chord geometry stays warm between
+// points on the same layout. Requests run quietly and single-threaded inside the pool.
+std::vector<StringArtResponse> runSweep(const ImageData& img, const std::vector<StringArtRequest>& requests, int numThreads = 0);
+
+// Point with the lowest reconstruction RMSE, or -1 when every point failed
+int bestSweepPoint(const std::vector<StringArtResponse>& responses);
+
+// Aligned text table: the swept values, strings placed, RMSE, PSNR, SSIM and seconds per point,
+// with the best one marked
+void writeSweepTable(std::ostream& out, const std::vector<SweepAxis>& axes, const std::vector<StringArtRequest>& requests,
+                     const std::vector<StringArtResponse>& responses, int best);
@@ -0,0 +1,432 @@
+// Regression tests for the whole pipeline. Each case runs the String_Art executable on a reference
+// image from images/ or on a synthetic pattern written here, then
+//   - compares every nail sequence in the instructions with the golden copy (first differing string),
+//   - compares the .txt (timestamp line skipped) and the .svg line by line,
+//   - fails when the run took longer than its entry in baseline_times.txt by more than the
+//     file's relative threshold.
+//
+// Usage (from the repository root):
+//   regression_tests [--exe <path>] [--root <dir>] [--work <dir>] [--runs <n>] [--update] [case ...]
+//
+// --update records the current outputs as the goldens and the current timings as the baseline;
+// only do that with a build whose output has been checked. --runs times each case n times and
+// keeps the fastest, which steadies the timing on a busy machine.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Pixel {
+    unsigned char r, g, b;
+};
+
+struct TestCase {
+    std::string name;
+    std::string input;      // images/<file>, or the name of a synthetic pattern
+    std::string args;       // Everything after the input file, except -o
+};
+
+// Reference images cover the three decoders (JPEG in grayscale only) and the color paths; the
+// synthetic patterns pin down scoring models and layouts on inputs whose shape is known exactly.
+// The integer models (--fixed-point, --residual) give the same goldens on every compiler; the
+// floating-point cases may need --update after a compiler change, once their output is checked.
+const TestCase CASES[] = {
+    {"gauss_default",   "images/CarlGauss.png",             "-n 200 -s 800"},
+    {"gauss_rect_cs3",  "images/CarlGauss.bmp",             "-n 240 -s 600 -r --coverage-strategy 3"},
+    {"gauss_fixed",     "images/GaussPNG-GaussStrings.png", "-n 200 -s 1000 --fixed-point"},
+    {"stripes_jpeg",    "images/cmyk_stripes.jpg",          "-n 160 -s 500 --coverage-strategy 1"},
+    {"squares_cmyk",    "images/cmyk_squares.png",          "--color -n 160 --strings-per-color 250"},
+    {"squares_joint",   "images/cmyk_squares.png",          "--color --joint-color -n 160 --strings-per-color 250"},
+    {"radial_residual", "radial",                           "-n 160 -s 0 --residual"},
+    {"checker_ellipse", "checker",                          "-n 180 -s 600 --layout ellipse --coverage-strategy 2 --fixed-point"},
+    {"stripes_refine",  "stripes",                          "-n 160 -s 500 --fixed-point --refine-moves 2000"},
+    {"rings_palette",   "rings",                            "--palette auto:3 -n 160 --strings-per-color 250"},
+};
+
+// ---- Synthetic inputs ----
+
+bool writeBMP(const fs::path& path, int width, int height, const std::function<Pixel(int, int)>& pixel) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    int rowBytes = (width * 3 + 3) & ~3;
+    uint32_t imageSize = (uint32_t)(rowBytes * height);
+    auto put16 = [&](uint16_t v) { file.put((char)(v & 0xFF)); file.put((char)(v >> 8)); };
+    auto put32 = [&](uint32_t v) { put16((uint16_t)(v & 0xFFFF)); put16((uint16_t)(v >> 16)); };
+
+    file.put('B'); file.put('M');
+    put32(54 + imageSize); put32(0); put32(54);
+    put32(40); put32((uint32_t)width); put32((uint32_t)height);
+    put16(1); put16(24); put32(0); put32(imageSize); put32(2835); put32(2835); put32(0); put32(0);
+
+    std::vector<char> row(rowBytes, 0);
+    for (int y = height - 1; y >= 0; y--) {   // Bottom-up rows
+        for (int x = 0; x < width; x++) {
+            Pixel p = pixel(x, y);
+            row[x * 3] = (char)p.b;
+            row[x * 3 + 1] = (char)p.g;
+            row[x * 3 + 2] = (char)p.r;
+        }
+        file.write(row.data(), rowBytes);
+    }
+    return file.good();
+}
+
+Pixel gray(double darkness) {
+    unsigned char v = (unsigned char)std::lround(255.0 * (1.0 - std::max(0.0, std::min(1.0, darkness))));
+    return {v, v, v};
+}
+
+// Writes the pattern as <name>.bmp in dir; false for an unknown name
+bool writePattern(const std::string& name, const fs::path& dir, std::string& filename) {
+    filename = name + ".bmp";
+    fs::path path = dir / filename;
+
+    if (name == "radial") {
+        // Dark centre fading to white at the rim
+        return writeBMP(path, 240, 240, [](int x, int y) {
+            double r = std::hypot(x - 119.5, y - 119.5) / 120.0;
+            return gray(1.0 - r);
+        });
+    }
+    if (name == "checker") {
+        // 32-pixel squares on a landscape frame
+        return writeBMP(path, 256, 192, [](int x, int y) {
+            return gray(((x / 32) + (y / 32)) % 2 ? 0.9 : 0.05);
+        });
+    }
+    if (name == "stripes") {
+        // Diagonal bands of three gray levels
+        return writeBMP(path, 240, 240, [](int x, int y) {
+            static const double levels[] = {0.1, 0.5, 0.95};
+            return gray(levels[((x + y) / 24) % 3]);
+        });
+    }
+    if (name == "rings") {
+        // Red, navy and black rings on white, for palette extraction
+        return writeBMP(path, 240, 240, [](int x, int y) {
+            double r = std::hypot(x - 119.5, y - 119.5);
+            if (r < 30) return Pixel{0, 0, 0};
+            if (r < 60) return Pixel{192, 57, 43};
+            if (r < 90) return Pixel{30, 58, 138};
+            return Pixel{255, 255, 255};
+        });
+    }
+    return false;
+}
+
+// ---- Comparison ----
+
+// getline that also drops a '\r', so goldens checked out with either line ending compare equal
+bool readLine(std::istream& in, std::string& line) {
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+// Every nail sequence of an instructions file, by its heading line
+std::vector<std::pair<std::string, std::vector<int>>> readSequences(const fs::path& path) {
+    std::vector<std::pair<std::string, std::vector<int>>> sequences;
+    std::ifstream file(path);
+    std::string line;
+    bool inSequence = false;
+
+    while (readLine(file, line)) {
+        if (line.find("Nail sequence") == 0 || line.find("Thread Sequence (") != std::string::npos) {
+            sequences.push_back({line.substr(0, line.find(" (")), {}});
+            inSequence = true;
+            continue;
+        }
+        if (!inSequence) continue;
+        if (line.empty() || line.find_first_not_of("0123456789,") != std::string::npos) {
+            inSequence = false;
+            continue;
+        }
+        std::stringstream ss(line);
+        std::string nail;
+        while (std::getline(ss, nail, ',')) {
+            if (!nail.empty()) sequences.back().second.push_back(std::atoi(nail.c_str()));
+        }
+    }
+    return sequences;
+}
+
+bool compareSequences(const fs::path& result, const fs::path& golden, std::string& detail) {
+    auto actual = readSequences(result);
+    auto expected = readSequences(golden);
+    if (actual.size() != expected.size()) {
+        detail = std::to_string(actual.size()) + " sequences, golden has " + std::to_string(expected.size());
+        return false;
+    }
+    for (size_t s = 0; s < actual.size(); s++) {
+        const std::vector<int>& a = actual[s].second;
+        const std::vector<int>& e = expected[s].second;
+        size_t common = std::min(a.size(), e.size());
+        for (size_t i = 0; i < common; i++) {
+            if (a[i] != e[i]) {
+                detail = expected[s].first + ": nail " + std::to_string(i) + " is " + std::to_string(a[i]) +
+                         ", golden " + std::to_string(e[i]);
+                return false;
+            }
+        }
+        if (a.size() != e.size()) {
+            detail = expected[s].first + ": " + std::to_string(a.size()) + " nails, golden " + std::to_string(e.size());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Line by line; the instructions' "Generated:" line carries the run's timestamp and is skipped
+bool compareLines(const fs::path& result, const fs::path& golden, std::string& detail) {
+    std::ifstream file(result);
+    std::ifstream expected(golden);
+    if (!expected.is_open()) {
+        detail = "no golden file " + golden.string();
+        return false;
+    }
+
+    std::string line, goldenLine;
+    for (int lineNumber = 1;; lineNumber++) {
+        bool more = readLine(file, line);
+        bool goldenMore = readLine(expected, goldenLine);
+        if (!more || !goldenMore) {
+            if (more != goldenMore) {
+                detail = "length differs at line " + std::to_string(lineNumber);
+                return false;
+            }
+            return true;
+        }
+        if (line != goldenLine && !(line.rfind("Generated: ", 0) == 0 && goldenLine.rfind("Generated: ", 0) == 0)) {
+            detail = "line " + std::to_string(lineNumber) + " differs";
+            return false;
+        }
+    }
+}
+
+// ---- Timing baseline ----
+
+struct Baseline {
+    double threshold = 1.0;                 // Allowed slowdown as a fraction of the baseline time
+    std::map<std::string, double> seconds;
+};
+
+Baseline readBaseline(const fs::path& path) {
+    Baseline baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::stringstream ss(line);
+        std::string key;
+        double value;
+        if (!(ss >> key >> value)) continue;
+        if (key == "threshold") {
+            baseline.threshold = value;
+        } else {
+            baseline.seconds[key] = value;
+        }
+    }
+    return baseline;
+}
+
+bool writeBaseline(const fs::path& path, const Baseline& baseline) {
+    std::ofstream file(path);
+    file << "# Wall-clock seconds per regression case (best of the recording runs), written by\n";
+    file << "# regression_tests --update. A case fails when it takes longer than its time\n";
+    file << "# multiplied by (1 + threshold).\n";
+    file << "threshold " << baseline.threshold << "\n";
+    for (const auto& entry : baseline.seconds) {
+        file << entry.first << " " << entry.second << "\n";
+    }
+    return file.good();
+}
+
+std::string quote(const std::string& text) {
+    return "\"" + text + "\"";
+}
+
+// Runs the executable in dir with its output captured in run.log; returns the exit code
+int runCase(const fs::path& exe, const fs::path& dir, const std::string& input, const TestCase& test) {
+    std::string command = quote(exe.string()) + " " + quote(input) + " " + test.args + " -o " + test.name + " > run.log 2>&1";
+#ifdef _WIN32
+    command = "\"" + command + "\"";   // cmd strips one pair of outer quotes
+#endif
+    fs::path previous = fs::current_path();
+    fs::current_path(dir);
+    int status = std::system(command.c_str());
+    fs::current_path(previous);
+    return status;
+}
+
+// The one result file of a case with the given extension (the run's name carries its parameters)
+fs::path findOutput(const fs::path& dir, const std::string& name, const std::string& extension) {
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::string file = entry.path().filename().string();
+        if (file.rfind(name + "-", 0) == 0 && entry.path().extension() == extension
+            && file.find("-metrics") == std::string::npos) {
+            return entry.path();
+        }
+    }
+    return fs::path();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    fs::path exe = "String_Art.exe";
+#else
+    fs::path exe = "./string_art";
+#endif
+    fs::path root = ".";
+    fs::path work;
+    int runs = 1;
+    bool update = false;
+    std::vector<std::string> selected;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--exe" && i + 1 < argc) {
+            exe = argv[++i];
+        } else if (arg == "--root" && i + 1 < argc) {
+            root = argv[++i];
+        } else if (arg == "--work" && i + 1 < argc) {
+            work = argv[++i];
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--update") {
+            update = true;
+        } else if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: regression_tests [--exe <path>] [--root <dir>] [--work <dir>] [--runs <n>] [--update] [case ...]" << std::endl;
+            return 0;
+        } else if (!arg.empty() && arg[0] != '-') {
+            selected.push_back(arg);
+        } else {
+            std::cout << "Error: Unknown option " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    exe = fs::absolute(exe);
+    root = fs::absolute(root);
+    if (work.empty()) work = root / "tests" / "out";
+    work = fs::absolute(work);
+    fs::path goldenDir = root / "tests" / "golden";
+    fs::path baselineFile = root / "tests" / "baseline_times.txt";
+
+    if (!fs::exists(exe)) {
+        std::cout << "Error: Executable not found: " << exe.string() << " (build it first or pass --exe)" << std::endl;
+        return 2;
+    }
+
+    Baseline baseline = readBaseline(baselineFile);
+    std::error_code ec;
+    fs::create_directories(work, ec);
+    if (update) fs::create_directories(goldenDir, ec);
+
+    int passed = 0, failed = 0;
+    for (const TestCase& test : CASES) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), test.name) == selected.end()) continue;
+
+        fs::path dir = work / test.name;
+        fs::remove_all(dir, ec);
+        fs::create_directories(dir, ec);
+
+        // The input sits next to the outputs, so the instructions name it without a path
+        std::string input;
+        if (test.input.rfind("images/", 0) == 0) {
+            input = fs::path(test.input).filename().string();
+            fs::copy_file(root / test.input, dir / input, fs::copy_options::overwrite_existing, ec);
+            if (ec) {
+                std::cout << "FAIL " << test.name << ": cannot copy " << test.input << std::endl;
+                failed++;
+                continue;
+            }
+        } else if (!writePattern(test.input, dir, input)) {
+            std::cout << "FAIL " << test.name << ": cannot write pattern " << test.input << std::endl;
+            failed++;
+            continue;
+        }
+
+        double seconds = 0.0;
+        int status = 0;
+        for (int r = 0; r < runs && status == 0; r++) {
+            auto start = std::chrono::steady_clock::now();
+            status = runCase(exe, dir, input, test);
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            seconds = r == 0 ? elapsed : std::min(seconds, elapsed);
+        }
+
+        fs::path txt = findOutput(dir, test.name, ".txt");
+        fs::path svg = findOutput(dir, test.name, ".svg");
+        std::vector<std::string> problems;
+        if (status != 0) problems.push_back("exit status " + std::to_string(status) + " (see " + (dir / "run.log").string() + ")");
+        if (txt.empty()) problems.push_back("no .txt written");
+        if (svg.empty()) problems.push_back("no .svg written");
+
+        if (update && problems.empty()) {
+            fs::copy_file(txt, goldenDir / (test.name + ".txt"), fs::copy_options::overwrite_existing, ec);
+            fs::copy_file(svg, goldenDir / (test.name + ".svg"), fs::copy_options::overwrite_existing, ec);
+            baseline.seconds[test.name] = std::round(seconds * 1000.0) / 1000.0;
+            std::cout << "RECORDED " << test.name << " (" << seconds << "s)" << std::endl;
+            passed++;
+            continue;
+        }
+
+        std::string detail;
+        if (problems.empty()) {
+            fs::path goldenTxt = goldenDir / (test.name + ".txt");
+            fs::path goldenSvg = goldenDir / (test.name + ".svg");
+            if (!compareSequences(txt, goldenTxt, detail)) problems.push_back("sequence: " + detail);
+            if (!compareLines(txt, goldenTxt, detail)) problems.push_back("txt: " + detail);
+            if (!compareLines(svg, goldenSvg, detail)) problems.push_back("svg: " + detail);
+
+            auto base = baseline.seconds.find(test.name);
+            if (base == baseline.seconds.end()) {
+                problems.push_back("no baseline time");
+            } else if (seconds > base->second * (1.0 + baseline.threshold)) {
+                std::ostringstream message;
+                message << "took " << seconds << "s, baseline " << base->second << "s (+" << baseline.threshold * 100.0 << "% allowed)";
+                problems.push_back(message.str());
+            }
+        }
+
+        if (problems.empty()) {
+            std::cout << "PASS " << test.name << " (" << seconds << "s)" << std::endl;
+            passed++;
+        } else {
+            std::cout << "FAIL " << test.name << std::endl;
+            for (const std::string& problem : problems) {
+                std::cout << "  " << problem << std::endl;
+            }
+            failed++;
+        }
+    }
+
+    if (update) {
+        if (!writeBaseline(baselineFile, baseline)) {
+            std::cout << "Error: Cannot write " << baselineFile.string() << std::endl;
+            return 1;
+        }
+        std::cout << "Recorded " << passed << " cases in " << goldenDir.string() << " and " << baselineFile.string() << std::endl;
+        return failed == 0 ? 0 : 1;
+    }
+
+    std::cout << passed << " passed, " << failed << " failed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int numThreads) : m_pending(0), m_queued(0), m_nextQueue(0), m_stop(false) {
+    if (numThreads <= 0) {
+        numThreads = (int)std::thread::hardware_concurrency();
+        if (numThreads <= 0) numThreads = 1;
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < numThreads; i++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // Count the task before any worker can see it, so a worker that finishes it at once
+    // never takes m_pending below zero or misses the notify for waitAll
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_pending++;
+        m_queued++;
+    }
+    // Distribute round-robin; idle workers steal whatever is left over
+    unsigned index = m_nextQueue.fetch_add(1) % m_queues.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_workAvailable.notify_one();
+}
+
+void ThreadPool::waitAll() {
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    m_allDone.wait(lock, [this] { return m_pending == 0; });
+}
+
+int ThreadPool::size() const {
+    return (int)m_workers.size();
+}
+
+// Own queue is LIFO (cache-warm), steals take the oldest task from a victim
+bool ThreadPool::popLocal(int index, std::function<void()>& task) {
+    WorkerQueue& queue = *m_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(int thief, std::function<void()>& task) {
+    int count = (int)m_queues.size();
+    for (int offset = 1; offset < count; offset++) {
+        WorkerQueue& victim = *m_queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int index) {
+    while (true) {
+        std::function<void()> task;
+        if (popLocal(index, task) || steal(index, task)) {
+            {
+                std::lock_guard<std::mutex> lock(m_stateMutex);
+                m_queued--;
+            }
+            task();
+
+            std::lock_guard<std::mutex> lock(m_stateMutex);
+            if (--m_pending == 0) {
+                m_allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_stateMutex);
+        // Re-check under the state lock so a submit between the failed pop and here is not missed
+        m_workAvailable.wait(lock, [this] { return m_stop || m_queued > 0; });
+        if (m_stop && m_queued == 0) return;
+    }
+}
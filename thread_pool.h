@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Work-stealing thread pool - each worker owns a task queue and steals from
+// the others when its own queue runs dry. Tasks must not share mutable state.
+class ThreadPool {
+public:
+    // numThreads <= 0 uses the hardware concurrency
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Block until every submitted task has finished
+    void waitAll();
+
+    int size() const;
+
+private:
+    struct WorkerQueue {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    void workerLoop(int index);
+    bool popLocal(int index, std::function<void()>& task);
+    bool steal(int thief, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    int m_pending;   // submitted but not yet finished
+    int m_queued;    // submitted but not yet picked up by a worker
+    std::atomic<unsigned> m_nextQueue;
+    bool m_stop;
+
+    std::mutex m_stateMutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_allDone;
+};